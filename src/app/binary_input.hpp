@@ -0,0 +1,145 @@
+#pragma once
+
+#include <bit>
+#include <span>
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+
+#include "indexed_triangle.hpp"
+#include "mapped_file.hpp"
+#include "point.hpp"
+
+namespace app {
+
+/**
+ * Binary triangle format, host byte order (little-endian only):
+ *
+ *   BinaryHeader, then count * 9 packed scalars (x y z of the three vertices of each triangle)
+ *
+ * Triangle ids are implicit, as in the text format: the i-th triangle gets id i.
+ */
+inline constexpr std::array<char, 8> kBinaryMagic {'T', 'R', 'I', '3', 'D', 'B', 'I', 'N'};
+inline constexpr uint32_t kBinaryVersion = 1;
+
+enum class ScalarType : uint32_t {
+    kFloat32 = 4,
+    kFloat64 = 8,
+};
+
+struct BinaryHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t scalar_size;
+    uint64_t count;
+};
+
+static_assert(sizeof(BinaryHeader) == 24);
+static_assert(std::endian::native == std::endian::little, "Binary input is defined as little-endian");
+
+namespace detail {
+
+template <typename Scalar, typename T>
+void ReadPacked(const std::byte* data, size_t count,
+                std::vector<geometry::acceleration::IndexedTriangle<T>>& triangles)
+{
+    std::array<Scalar, 9> v;
+    for (size_t i = 0; i != count; ++i) {
+        std::memcpy(v.data(), data + i * sizeof(v), sizeof(v));
+
+        triangles.emplace_back(
+            i,
+            geometry::Triangle{
+                geometry::Point<T>{static_cast<T>(v[0]), static_cast<T>(v[1]), static_cast<T>(v[2])},
+                geometry::Point<T>{static_cast<T>(v[3]), static_cast<T>(v[4]), static_cast<T>(v[5])},
+                geometry::Point<T>{static_cast<T>(v[6]), static_cast<T>(v[7]), static_cast<T>(v[8])}
+            }
+        );
+    }
+}
+
+template <typename Scalar, typename T>
+void WritePacked(std::ostream& stream, std::span<const geometry::acceleration::IndexedTriangle<T>> triangles) {
+    for (const auto& tr : triangles) {
+        std::array<Scalar, 9> v;
+        for (size_t i = 0; i != 3; ++i) {
+            for (size_t axis = 0; axis != 3; ++axis) {
+                v[i * 3 + axis] = static_cast<Scalar>(tr.triangle[i][axis]);
+            }
+        }
+        stream.write(reinterpret_cast<const char*>(v.data()), sizeof(v));
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief Reads triangles from a memory-mapped binary file
+ *
+ * @throw std::runtime_error if the file cannot be mapped or is not a valid binary input
+ */
+template <typename T>
+std::vector<geometry::acceleration::IndexedTriangle<T>> ReadBinaryInput(const std::string& filename) {
+    io::MappedFile file(filename);
+
+    BinaryHeader header;
+    if (file.Size() < sizeof(header)) {
+        throw std::runtime_error("Input error: binary header is truncated");
+    }
+    std::memcpy(&header, file.Data(), sizeof(header));
+
+    if (header.magic != kBinaryMagic) {
+        throw std::runtime_error("Input error: not a binary triangle file");
+    }
+    if (header.version != kBinaryVersion) {
+        throw std::runtime_error("Input error: unsupported binary format version");
+    }
+    if (header.scalar_size != static_cast<uint32_t>(ScalarType::kFloat32)
+        && header.scalar_size != static_cast<uint32_t>(ScalarType::kFloat64))
+    {
+        throw std::runtime_error("Input error: unsupported scalar size");
+    }
+    if ((file.Size() - sizeof(header)) / (9 * header.scalar_size) < header.count) {
+        throw std::runtime_error("Input error: binary data is truncated");
+    }
+
+    std::vector<geometry::acceleration::IndexedTriangle<T>> triangles;
+    triangles.reserve(header.count);
+
+    const std::byte* data = file.Data() + sizeof(header);
+    if (header.scalar_size == static_cast<uint32_t>(ScalarType::kFloat32)) {
+        detail::ReadPacked<float>(data, header.count, triangles);
+    } else {
+        detail::ReadPacked<double>(data, header.count, triangles);
+    }
+
+    return triangles;
+}
+
+/**
+ * @brief Writes triangles in the binary format; their ids are not stored
+ */
+template <typename T>
+void WriteBinaryInput(std::ostream& stream,
+                      std::span<const geometry::acceleration::IndexedTriangle<T>> triangles,
+                      ScalarType scalar_type = ScalarType::kFloat64)
+{
+    BinaryHeader header {kBinaryMagic, kBinaryVersion, static_cast<uint32_t>(scalar_type), triangles.size()};
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    if (scalar_type == ScalarType::kFloat32) {
+        detail::WritePacked<float>(stream, triangles);
+    } else {
+        detail::WritePacked<double>(stream, triangles);
+    }
+
+    if (!stream.good()) {
+        throw std::runtime_error("Output error: cannot write binary triangles");
+    }
+}
+
+} // namespace app
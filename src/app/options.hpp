@@ -0,0 +1,115 @@
+#pragma once
+
+#include <limits>
+#include <string>
+#include <vector>
+#include <format>
+#include <charconv>
+#include <stdexcept>
+
+namespace app {
+
+inline constexpr size_t kNoLimit = std::numeric_limits<size_t>::max();
+
+enum class PairsFormat {
+    kNone,
+    kText,
+    kBinary,
+};
+
+enum class Engine {
+    kBvh,
+    kGrid,
+    kSap,
+};
+
+/**
+ * @brief Command line options of triangles_3d
+ * 
+ * - --binary <file>: read the triangles from a binary file (see binary_input.hpp) instead of
+ *   the text format on the standard input
+ * - --pairs text|binary: print every intersecting pair of ids instead of the ids
+ *   (see pair_output.hpp)
+ * - --limit <k>: stop the query once k ids, or k pairs with --pairs, are found
+ * - --any: only print whether any two triangles intersect (1 or 0)
+ * - --save-tree <file>: save the built tree to the file (see bvh_file.hpp) before the query
+ * - --tree <file>: map a tree saved with --save-tree instead of reading any triangles
+ * - --engine bvh|grid|sap: broad phase of the query, the BVH by default, a uniform grid
+ *   (see uniform_grid.hpp) or sweep and prune (see sweep_and_prune.hpp); the last two only
+ *   print the ids
+ */
+struct Options {
+    std::string binary_input;
+    PairsFormat pairs = PairsFormat::kNone;
+    size_t limit = kNoLimit;
+    bool any = false;
+    std::string save_tree;
+    std::string tree;
+    Engine engine = Engine::kBvh;
+};
+
+inline Options ParseOptions(int argc, char** argv) {
+    std::vector<std::string> args(argv, argv + argc);
+    Options options;
+
+    auto Value = [&args](size_t& i) -> const std::string& {
+        if (i + 1 == args.size()) {
+            throw std::runtime_error(std::format("Option {} expects a value", args[i]));
+        }
+        return args[++i];
+    };
+
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i] == "--binary") {
+            options.binary_input = Value(i);
+        } else if (args[i] == "--pairs") {
+            const std::string& format = Value(i);
+            if (format == "text") {
+                options.pairs = PairsFormat::kText;
+            } else if (format == "binary") {
+                options.pairs = PairsFormat::kBinary;
+            } else {
+                throw std::runtime_error(std::format("Unknown pairs format: {}", format));
+            }
+        } else if (args[i] == "--limit") {
+            const std::string& value = Value(i);
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), options.limit);
+            if (ec != std::errc{} || ptr != value.data() + value.size() || options.limit == 0) {
+                throw std::runtime_error(std::format("Option --limit expects a positive number, got {}", value));
+            }
+        } else if (args[i] == "--any") {
+            options.any = true;
+        } else if (args[i] == "--save-tree") {
+            options.save_tree = Value(i);
+        } else if (args[i] == "--tree") {
+            options.tree = Value(i);
+        } else if (args[i] == "--engine") {
+            const std::string& engine = Value(i);
+            if (engine == "bvh") {
+                options.engine = Engine::kBvh;
+            } else if (engine == "grid") {
+                options.engine = Engine::kGrid;
+            } else if (engine == "sap") {
+                options.engine = Engine::kSap;
+            } else {
+                throw std::runtime_error(std::format("Unknown engine: {}", engine));
+            }
+        } else {
+            throw std::runtime_error(std::format("Unknown option: {}", args[i]));
+        }
+    }
+
+    if (!options.tree.empty() && !options.binary_input.empty()) {
+        throw std::runtime_error("Options --tree and --binary cannot be used together");
+    }
+    if (options.engine != Engine::kBvh
+        && (options.pairs != PairsFormat::kNone || options.limit != kNoLimit || options.any
+            || !options.tree.empty() || !options.save_tree.empty()))
+    {
+        throw std::runtime_error("Options --pairs, --limit, --any, --tree and --save-tree need --engine bvh");
+    }
+
+    return options;
+}
+
+} // namespace app
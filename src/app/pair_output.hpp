@@ -0,0 +1,55 @@
+#pragma once
+
+#include <bit>
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+
+#include "bvh.hpp"
+#include "options.hpp"
+
+namespace app {
+
+static_assert(std::endian::native == std::endian::little, "Binary pair output is defined as little-endian");
+
+/**
+ * @brief Streams the intersecting pairs of the tree to stream as they are found
+ *
+ * - PairsFormat::kText: one pair per line, "i j" with i < j
+ * - PairsFormat::kBinary: two little-endian uint64 per pair, i < j, no header
+ *
+ * Pairs come in traversal order, not sorted. The query stops after max_pairs pairs, or as soon
+ * as the stream fails.
+ *
+ * @return number of pairs written
+ * @throw std::runtime_error if the stream fails
+ */
+template <typename T>
+size_t WriteIntersectingPairs(const geometry::acceleration::BVH<T>& tree, std::ostream& stream, PairsFormat format,
+                              size_t max_pairs = kNoLimit)
+{
+    using geometry::acceleration::TrIndex;
+
+    size_t count = 0;
+    if (format == PairsFormat::kBinary) {
+        tree.ForEachIntersectingPair([&](TrIndex a, TrIndex b) {
+            std::array<uint64_t, 2> pair {a, b};
+            stream.write(reinterpret_cast<const char*>(pair.data()), sizeof(pair));
+            return ++count < max_pairs && stream;
+        });
+    } else {
+        tree.ForEachIntersectingPair([&](TrIndex a, TrIndex b) {
+            stream << a << ' ' << b << '\n';
+            return ++count < max_pairs && stream;
+        });
+    }
+
+    if (!stream.good()) {
+        throw std::runtime_error("Output error: cannot write intersecting pairs");
+    }
+
+    return count;
+}
+
+} // namespace app
@@ -1,40 +1,222 @@
 #pragma once
 
+#include <span>
+#include <string>
 #include <format>
 #include <vector>
+#include <istream>
+#include <numeric>
+#include <charconv>
 #include <stdexcept>
+#include <algorithm>
+#include <string_view>
 
 #include "indexed_triangle.hpp"
 #include "point.hpp"
+#include "thread_pool.hpp"
 
 namespace app {
 
+namespace detail {
+
+inline constexpr size_t kReadBlockSize = 1 << 20;
+inline constexpr size_t kParallelParseMinSize = 1 << 20;
+inline constexpr size_t kChunksPerThread = 4;
+inline constexpr size_t kNoError = static_cast<size_t>(-1);
+inline constexpr std::string_view kSpaces = " \n\t\r\v\f";
+
+inline bool IsSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+struct ChunkResult {
+    size_t end_token = 0;
+    size_t error_token = kNoError;
+};
+
+/**
+ * @brief Parses the whitespace-separated numbers of text into values
+ *
+ * The first token of text gets global index first_token; parsing stops at the end of the text
+ * or once values is full.
+ *
+ * @return global index past the last token read and of the first malformed token, if any
+ */
 template <typename T>
-std::vector<geometry::acceleration::IndexedTriangle<T>> ParseInput(std::istream& stream) {
-    size_t n = 0;
-    stream >> n;
+ChunkResult ParseTokens(std::string_view text, size_t first_token, std::span<T> values) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+
+    ChunkResult result{first_token};
+    while (result.end_token < values.size()) {
+        while (p != end && IsSpace(*p)) {
+            ++p;
+        }
+        if (p == end) {
+            break;
+        }
+
+        const char* token_end = std::find_if(p, end, IsSpace);
+        const char* first = (*p == '+' && token_end - p > 1) ? p + 1 : p;
+
+        auto [ptr, ec] = std::from_chars(first, token_end, values[result.end_token]);
+        if (ec != std::errc{} || ptr != token_end) {
+            result.error_token = result.end_token;
+            break;
+        }
+
+        ++result.end_token;
+        p = token_end;
+    }
+
+    return result;
+}
+
+inline size_t CountTokens(std::string_view text) {
+    size_t count = 0;
+    bool in_token = false;
+    for (char c : text) {
+        bool space = IsSpace(c);
+        count += (!space && !in_token);
+        in_token = !space;
+    }
+    return count;
+}
+
+/**
+ * @brief Splits text into about n pieces without cutting tokens
+ */
+inline std::vector<std::string_view> SplitIntoChunks(std::string_view text, size_t n) {
+    std::vector<std::string_view> chunks;
+    size_t chunk_size = text.size() / n + 1;
+
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = std::min(begin + chunk_size, text.size());
+        while (end < text.size() && !IsSpace(text[end])) {
+            ++end;
+        }
+        chunks.push_back(text.substr(begin, end - begin));
+        begin = end;
+    }
+
+    return chunks;
+}
+
+/**
+ * @brief Parses the coordinates in parallel: tokens are counted per chunk first, so every chunk
+ * knows the global index of its first token
+ */
+template <typename T>
+ChunkResult ParallelParseTokens(std::string_view text, std::span<T> values) {
+    concurrency::ThreadPool& pool = concurrency::DefaultPool();
+    auto chunks = SplitIntoChunks(text, kChunksPerThread * (pool.GetNumberOfThreads() + 1));
+
+    std::vector<size_t> offsets(chunks.size() + 1, 0);
+    {
+        concurrency::TaskGroup group(pool);
+        for (size_t i = 0; i != chunks.size(); ++i) {
+            group.Run([&, i] { offsets[i + 1] = CountTokens(chunks[i]); });
+        }
+        group.Wait();
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    std::vector<ChunkResult> results(chunks.size());
+    {
+        concurrency::TaskGroup group(pool);
+        for (size_t i = 0; i != chunks.size(); ++i) {
+            if (offsets[i] < values.size()) {
+                group.Run([&, i] { results[i] = ParseTokens(chunks[i], offsets[i], values); });
+            }
+        }
+        group.Wait();
+    }
+
+    ChunkResult result{std::min(offsets.back(), values.size())};
+    for (const auto& chunk : results) {
+        result.error_token = std::min(result.error_token, chunk.error_token);
+    }
+
+    return result;
+}
+
+} // namespace detail
+
+/**
+ * @brief Reads the whole stream in large blocks
+ */
+inline std::string ReadAll(std::istream& stream) {
+    std::string buffer;
+    size_t size = 0;
+
+    while (stream) {
+        buffer.resize(size + detail::kReadBlockSize);
+        stream.read(buffer.data() + size, detail::kReadBlockSize);
+        size += stream.gcount();
+    }
+
+    buffer.resize(size);
+    return buffer;
+}
 
-    if (!stream.good()) {
+/**
+ * @brief Parses the text input format: the number of triangles, then nine coordinates per triangle
+ *
+ * Numbers are converted with std::from_chars (locale-independent, no allocations per value).
+ * With concurrency::Execution::kParallel large buffers are split into chunks parsed concurrently.
+ *
+ * @throw std::runtime_error naming the first triangle with a missing or malformed coordinate
+ */
+template <typename T>
+std::vector<geometry::acceleration::IndexedTriangle<T>> ParseInput(
+    std::string_view text, concurrency::Execution execution = concurrency::Execution::kSerial)
+{
+    size_t n = 0;
+    auto count = detail::ParseTokens(text, 0, std::span<size_t>(&n, 1));
+    if (count.end_token != 1) {
         throw std::runtime_error("Input error: expected number of triangles");
     }
 
+    size_t after_count = text.find_first_of(detail::kSpaces, text.find_first_not_of(detail::kSpaces));
+    std::string_view coordinates = (after_count == text.npos) ? std::string_view{} : text.substr(after_count);
+
+    // every number takes at least one character and one separator
+    std::vector<T> values(std::min(9 * n, coordinates.size() / 2 + 1));
+
+    auto parsed = (execution == concurrency::Execution::kParallel
+                   && coordinates.size() >= detail::kParallelParseMinSize)
+        ? detail::ParallelParseTokens<T>(coordinates, values)
+        : detail::ParseTokens<T>(coordinates, 0, values);
+
+    size_t failed_token = std::min(parsed.error_token, parsed.end_token);
+    if (failed_token < 9 * n) {
+        throw std::runtime_error(std::format("Input error on the triangle {}", failed_token / 9));
+    }
+
     std::vector<geometry::acceleration::IndexedTriangle<T>> triangles;
     triangles.reserve(n);
 
-    geometry::Point<T> p0, p1, p2;
     for (size_t i = 0; i != n; ++i) {
-        stream >> p0.x >> p0.y >> p0.z
-               >> p1.x >> p1.y >> p1.z
-               >> p2.x >> p2.y >> p2.z;
-
-        if (!stream.good()) {
-            throw std::runtime_error(std::format("Input error on the triangle {}", i));
-        }
-
-        triangles.emplace_back(i, geometry::Triangle{p0, p1, p2});
+        const T* v = values.data() + 9 * i;
+        triangles.emplace_back(
+            i,
+            geometry::Triangle{
+                geometry::Point<T>{v[0], v[1], v[2]},
+                geometry::Point<T>{v[3], v[4], v[5]},
+                geometry::Point<T>{v[6], v[7], v[8]}
+            }
+        );
     }
 
     return triangles;
 }
 
+template <typename T>
+std::vector<geometry::acceleration::IndexedTriangle<T>> ParseInput(
+    std::istream& stream, concurrency::Execution execution = concurrency::Execution::kSerial)
+{
+    return ParseInput<T>(ReadAll(stream), execution);
+}
+
 } // namespace app
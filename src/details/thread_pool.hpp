@@ -0,0 +1,229 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace concurrency {
+
+enum class Execution {
+    kSerial,
+    kParallel,
+};
+
+/**
+ * @brief Work-stealing thread pool
+ *
+ * Every worker owns a deque: it pushes and pops its own tasks at the back and steals from the
+ * front of the other deques when its own is empty. Tasks submitted from outside the pool are
+ * distributed over the deques round-robin.
+ *
+ * Waiting is done through TaskGroup::Wait, which executes pending tasks instead of blocking,
+ * so nested task groups never deadlock and a pool without workers degrades to serial execution.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t number_of_threads) : queues_(std::max<size_t>(number_of_threads, 1)) {
+        workers_.reserve(number_of_threads);
+        for (size_t i = 0; i != number_of_threads; ++i) {
+            workers_.emplace_back([this, i] { WorkerLoop(i); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(sleep_mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    void Submit(std::function<void()> task) {
+        size_t queue_idx = (current_pool_ == this)
+            ? current_worker_
+            : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+
+        {
+            std::lock_guard lock(queues_[queue_idx].mutex);
+            queues_[queue_idx].tasks.push_back(std::move(task));
+        }
+
+        {
+            std::lock_guard lock(sleep_mutex_);
+            ++queued_;
+        }
+        wake_.notify_one();
+    }
+
+    /**
+     * @brief Executes one pending task, if any, on the calling thread
+     *
+     * @return false if there was nothing to run
+     */
+    bool RunPendingTask() {
+        size_t own = (current_pool_ == this) ? current_worker_ : 0;
+
+        std::function<void()> task;
+        for (size_t i = 0; i != queues_.size() && !task; ++i) {
+            auto& queue = queues_[(own + i) % queues_.size()];
+            std::lock_guard lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+        }
+
+        if (!task) {
+            return false;
+        }
+
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        task();
+        return true;
+    }
+
+    size_t GetNumberOfThreads() const noexcept {
+        return workers_.size();
+    }
+
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    static inline thread_local ThreadPool* current_pool_ = nullptr;
+    static inline thread_local size_t current_worker_ = 0;
+
+    std::vector<TaskQueue> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> next_queue_{0};
+    std::atomic<std::ptrdiff_t> queued_{0};
+
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+
+    void WorkerLoop(size_t idx) {
+        current_pool_ = this;
+        current_worker_ = idx;
+
+        while (true) {
+            if (RunPendingTask()) {
+                continue;
+            }
+
+            std::unique_lock lock(sleep_mutex_);
+            wake_.wait(lock, [this] { return stop_ || queued_.load() > 0; });
+            if (stop_ && queued_.load() <= 0) {
+                return;
+            }
+        }
+    }
+};
+
+/**
+ * @brief Shared pool sized to the machine; the calling thread is the extra worker
+ */
+inline ThreadPool& DefaultPool() {
+    static ThreadPool pool{std::max(std::thread::hardware_concurrency(), 1u) - 1};
+    return pool;
+}
+
+/**
+ * @brief Set of tasks that can be waited for together
+ *
+ * The first exception thrown by a task is rethrown from Wait.
+ */
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool = DefaultPool()) : pool_(pool) {}
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    ~TaskGroup() {
+        while (pending_.load() != 0) {
+            if (!pool_.RunPendingTask()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    template <typename F>
+    void Run(F&& f) {
+        pending_.fetch_add(1);
+        pool_.Submit([this, f = std::forward<F>(f)]() mutable {
+            try {
+                f();
+            } catch (...) {
+                std::lock_guard lock(error_mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+            }
+            pending_.fetch_sub(1);
+        });
+    }
+
+    void Wait() {
+        while (pending_.load() != 0) {
+            if (!pool_.RunPendingTask()) {
+                std::this_thread::yield();
+            }
+        }
+
+        if (error_) {
+            std::rethrow_exception(std::exchange(error_, nullptr));
+        }
+    }
+
+private:
+    ThreadPool& pool_;
+    std::atomic<size_t> pending_{0};
+    std::mutex error_mutex_;
+    std::exception_ptr error_;
+};
+
+/**
+ * @brief Calls process(first, last) for consecutive ranges covering [0, size), in parallel mode
+ * concurrently on DefaultPool() in ranges of chunk elements
+ */
+template <typename Process>
+void ForEachChunk(size_t size, bool parallel, size_t chunk, Process&& process) {
+    chunk = std::max<size_t>(chunk, 1);
+    if (!parallel || size <= chunk) {
+        process(size_t{0}, size);
+        return;
+    }
+
+    TaskGroup group;
+    for (size_t first = 0; first < size; first += chunk) {
+        group.Run([&process, first, last = std::min(first + chunk, size)] { process(first, last); });
+    }
+    group.Wait();
+}
+
+} // namespace concurrency
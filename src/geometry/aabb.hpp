@@ -54,10 +54,16 @@ struct AABB {
         max = aabb.max;
     }
     
+    /**
+     * @brief Whether the boxes overlap or are closer than kEpsilon
+     * 
+     * All six comparisons are evaluated, without a branch between them: in a traversal the
+     * result is close to random, and one mispredicted branch costs more than the comparisons.
+     */
     static bool Intersects(const AABB& a, const AABB& b) noexcept {
-        return (a.min.x <= b.max.x + constants::kEpsilon && a.max.x + constants::kEpsilon >= b.min.x)
-            && (a.min.y <= b.max.y + constants::kEpsilon && a.max.y + constants::kEpsilon >= b.min.y)
-            && (a.min.z <= b.max.z + constants::kEpsilon && a.max.z + constants::kEpsilon >= b.min.z);
+        return (a.min.x <= b.max.x + constants::kEpsilon) & (a.max.x + constants::kEpsilon >= b.min.x)
+             & (a.min.y <= b.max.y + constants::kEpsilon) & (a.max.y + constants::kEpsilon >= b.min.y)
+             & (a.min.z <= b.max.z + constants::kEpsilon) & (a.max.z + constants::kEpsilon >= b.min.z);
     }
 
     void Expand(const AABB& other) {
@@ -82,6 +88,20 @@ struct AABB {
     Point<T> GetCenter() const {
         return Point<T>{(max.x + min.x) / 2, (max.y + min.y) / 2, (max.z + min.z) / 2};
     }
+
+    /**
+     * @brief Surface area of the box, the weight used by the surface area heuristic
+     * 
+     * @return 0 for an empty box (min > max on some axis)
+     */
+    T SurfaceArea() const {
+        if (min.x > max.x || min.y > max.y || min.z > max.z) {
+            return 0;
+        }
+
+        Vector<T> diff = max - min;
+        return 2 * (diff.x * diff.y + diff.y * diff.z + diff.z * diff.x);
+    }
 };
 
 } // namespace geometry
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+
+#include "thread_pool.hpp"
+
+namespace geometry {
+
+namespace acceleration {
+
+enum class SplitMethod {
+    kMedian,
+    kSah,
+    kLbvh,
+};
+
+enum class NodeBounds {
+    kNative,
+    kFloat,
+};
+
+enum class NodeOrder {
+    kDepthFirst,
+    kBreadthFirst,
+    kVanEmdeBoas,
+};
+
+inline constexpr size_t kMinSahBins = 16;
+inline constexpr size_t kMaxSahBins = 32;
+inline constexpr size_t kMaxLeafSize = 32;
+
+/**
+ * @brief Parameters of the BVH construction
+ * 
+ * - split_method: object median on the longest axis, binned surface area heuristic, or kLbvh: the
+ *   triangles sorted by the Morton codes of their centroids (see morton.hpp) and split where the
+ *   highest bit of the codes changes, which builds in linear time after the sort
+ * - sah_bins: number of bins per axis for SplitMethod::kSah, in [kMinSahBins, kMaxSahBins]
+ * - execution: kParallel builds subtrees concurrently on concurrency::DefaultPool(); the tree is
+ *   identical to the serial one
+ * - parallel_threshold: subtrees with fewer triangles are built serially inside one task
+ * - max_leaf_size: maximum number of triangles in a leaf, in [1, kMaxLeafSize]; larger leaves
+ *   give the batched narrow phase longer batches
+ * - node_bounds: type of the node boxes the queries test; kFloat rounds them outwards to float,
+ *   which halves the node size at the cost of a few more box overlaps
+ * - branching_factor: children per node of the tree the queries traverse, 2, 4 or 8; the wider
+ *   trees are collapsed from the binary one and test all children of a node at once
+ * - node_order: order of the traversal nodes in memory, see OrderNodes; the triangles stay in
+ *   the depth-first order of the leaves
+ */
+struct BuildOptions {
+    SplitMethod split_method = SplitMethod::kMedian;
+    size_t sah_bins = kMinSahBins;
+    concurrency::Execution execution = concurrency::Execution::kSerial;
+    size_t parallel_threshold = 4096;
+    size_t max_leaf_size = 3;
+    NodeBounds node_bounds = NodeBounds::kNative;
+    size_t branching_factor = 2;
+    NodeOrder node_order = NodeOrder::kDepthFirst;
+};
+
+} // namespace acceleration
+
+} // namespace geometry
@@ -1,13 +1,35 @@
 #pragma once
 
-#include <set>
+#include <bit>
+#include <array>
+#include <atomic>
+#include <mutex>
 #include <memory>
+#include <span>
+#include <string>
 #include <vector>
-#include <fstream>
+#include <limits>
+#include <cstring>
+#include <ostream>
+#include <variant>
+#include <algorithm>
 #include <stdexcept>
+#include <type_traits>
 
 #include "node.hpp"
+#include "morton.hpp"
+#include "bvh_file.hpp"
+#include "mapped_file.hpp"
+#include "packed_node.hpp"
+#include "prepared_triangle.hpp"
+#include "build_options.hpp"
+#include "query_options.hpp"
+#include "sat_kernel.hpp"
+#include "triangle_soa.hpp"
+#include "pair_traversal.hpp"
+#include "wide_traversal.hpp"
 #include "indexed_triangle.hpp"
+#include "intersection_result.hpp"
 
 namespace geometry {
 
@@ -17,13 +39,501 @@ template <typename T>
 requires concepts::Numeric<T>
 class BVH {
 public:
-    BVH(std::vector<IndexedTriangle<T>>&& triangles) : triangles_(std::move(triangles)) {
-        root_ = RecursiveBuild(0, triangles_.size());
+    BVH(std::vector<IndexedTriangle<T>>&& triangles, const BuildOptions& options = {})
+        : options_(options), triangles_(Keep(std::move(triangles)))
+    {
+        if (options_.split_method == SplitMethod::kSah
+            && (options_.sah_bins < kMinSahBins || options_.sah_bins > kMaxSahBins))
+        {
+            throw std::invalid_argument("BVH: the number of SAH bins is out of range");
+        }
+
+        if (options_.max_leaf_size == 0 || options_.max_leaf_size > kMaxLeafSize) {
+            throw std::invalid_argument("BVH: the maximum leaf size is out of range");
+        }
+
+        if (options_.branching_factor != 2 && options_.branching_factor != 4 && options_.branching_factor != 8) {
+            throw std::invalid_argument("BVH: the branching factor must be 2, 4 or 8");
+        }
+
+        if (options_.split_method == SplitMethod::kLbvh) {
+            SortByMortonCodes();
+        }
+
+        if (options_.execution == concurrency::Execution::kParallel) {
+            root_ = Stitch(*ParallelBuild(0, triangles_.size()));
+        } else {
+            root_ = RecursiveBuild(nodes_, 0, triangles_.size());
+        }
+        morton_codes_ = {};
+
+        soa_ = TriangleSoA<T>(triangles_);
+
+        std::vector<PreparedTriangle<T>> prepared;
+        prepared.reserve(triangles_.size());
+        for (const auto& tr : triangles_) {
+            prepared.emplace_back(tr.triangle);
+            id_capacity_ = std::max(id_capacity_, tr.id + 1);
+        }
+        prepared_ = Keep(std::move(prepared));
+
+        std::vector<uint32_t> positions(id_capacity_, kNoPosition);
+        for (size_t i = 0; i != triangles_.size(); ++i) {
+            positions[triangles_[i].id] = static_cast<uint32_t>(i);
+        }
+        positions_ = Keep(std::move(positions));
+
+        BuildTraversalNodes();
+        std::visit([this](auto nodes) { LinkNodes(nodes); }, traversal_nodes_);
+
+        built_sah_cost_ = GetSahCost();
+    }
+
+    // the spans of a tree view memory it shares with its copies, so trees are only moved
+    BVH(const BVH&) = delete;
+    BVH& operator=(const BVH&) = delete;
+    BVH(BVH&&) noexcept = default;
+    BVH& operator=(BVH&&) noexcept = default;
+
+    /**
+     * @brief Writes the tree in the saved BVH format, see bvh_file.hpp
+     * 
+     * @throws std::runtime_error if the stream fails
+     */
+    void Save(std::ostream& stream) const {
+        std::vector<BvhFileNode<T>> file_nodes;
+        file_nodes.reserve(nodes_.size());
+        for (const auto& node : nodes_) {
+            if (node.IsLeaf()) {
+                auto triangles = node.GetTriangles();
+                file_nodes.push_back({node.GetAABB(), invalid_idx, invalid_idx,
+                                      static_cast<uint64_t>(triangles.data() - triangles_.data()), triangles.size()});
+            } else {
+                file_nodes.push_back({node.GetAABB(), node.GetLeftIdx(), node.GetRightIdx(), 0, 0});
+            }
+        }
+
+        BvhFileHeader header{};
+        header.magic = kBvhFileMagic;
+        header.version = kBvhFileVersion;
+        header.scalar_size = sizeof(T);
+        header.scalar_is_floating = std::is_floating_point_v<T>;
+        header.split_method = static_cast<uint32_t>(options_.split_method);
+        header.sah_bins = static_cast<uint32_t>(options_.sah_bins);
+        header.max_leaf_size = static_cast<uint32_t>(options_.max_leaf_size);
+        header.node_bounds = static_cast<uint32_t>(options_.node_bounds);
+        header.branching_factor = static_cast<uint32_t>(options_.branching_factor);
+        header.node_order = static_cast<uint32_t>(options_.node_order);
+        header.traversal_layout = static_cast<uint32_t>(traversal_nodes_.index());
+        header.root = root_;
+        header.id_capacity = id_capacity_;
+        header.soa_scale = static_cast<double>(soa_.GetScale());
+        header.built_sah_cost = built_sah_cost_;
+
+        std::array<std::span<const std::byte>, kNumberOfSections> sections;
+        auto add = [&](BvhSection section, auto elements) {
+            using Element = typename decltype(elements)::element_type;
+            // written and read back as bytes; assignment is never used, so the std::pair of
+            // PreparedTriangle does no harm
+            static_assert(std::is_trivially_copy_constructible_v<Element> && std::is_trivially_destructible_v<Element>
+                          && alignof(Element) <= kBvhFileAlignment);
+
+            auto& entry = header.sections[static_cast<size_t>(section)];
+            entry.count = elements.size();
+            entry.element_size = sizeof(Element);
+            sections[static_cast<size_t>(section)] = std::as_bytes(elements);
+        };
+
+        add(BvhSection::kNodes, std::span<const BvhFileNode<T>>(file_nodes));
+        add(BvhSection::kTriangles, triangles_);
+        std::visit([&](auto nodes) { add(BvhSection::kTraversalNodes, nodes); }, traversal_nodes_);
+        add(BvhSection::kSoaValues, soa_.GetValues());
+        add(BvhSection::kSoaIds, soa_.ids);
+        add(BvhSection::kSoaDegenerate, soa_.degenerate);
+        add(BvhSection::kPrepared, prepared_);
+        add(BvhSection::kPositions, positions_);
+        add(BvhSection::kSources, sources_);
+        add(BvhSection::kParents, parents_);
+        add(BvhSection::kLeafOf, leaf_of_);
+        add(BvhSection::kSubtreeSizes, subtree_sizes_);
+
+        uint64_t offset = sizeof(header);
+        for (size_t i = 0; i != kNumberOfSections; ++i) {
+            offset = (offset + kBvhFileAlignment - 1) / kBvhFileAlignment * kBvhFileAlignment;
+            header.sections[i].offset = offset;
+            offset += sections[i].size();
+        }
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        uint64_t written = sizeof(header);
+        const std::array<char, kBvhFileAlignment> padding{};
+        for (size_t i = 0; i != kNumberOfSections; ++i) {
+            stream.write(padding.data(), static_cast<std::streamsize>(header.sections[i].offset - written));
+            stream.write(reinterpret_cast<const char*>(sections[i].data()), static_cast<std::streamsize>(sections[i].size()));
+            written = header.sections[i].offset + sections[i].size();
+        }
+
+        if (!stream.good()) {
+            throw std::runtime_error("BVH: cannot write the tree");
+        }
+    }
+
+    /**
+     * @brief Tree saved with Save, queried in place in a read-only mapping of the file
+     * 
+     * Nothing is parsed or built: the triangles, the traversal nodes and every other array the
+     * queries read stay in the mapping, which is shared, so processes mapping the same file share
+     * its pages. Only the nodes behind GetNode are made anew, as they point into the triangles.
+     * The mapping lives as long as the tree. A mapped tree cannot be changed: SetTriangle and
+     * Refit throw std::runtime_error.
+     * 
+     * Only the framing of the file is checked, not the tree inside.
+     * 
+     * @throws std::runtime_error if the file cannot be mapped, is not a saved tree of this version
+     * and scalar type, or is truncated
+     */
+    static BVH Map(const std::string& filename) {
+        auto file = std::make_shared<const io::MappedFile>(filename);
+
+        BvhFileHeader header;
+        if (file->Size() < sizeof(header)) {
+            throw std::runtime_error("BVH: the saved tree is truncated");
+        }
+        std::memcpy(&header, file->Data(), sizeof(header));
+
+        if (header.magic != kBvhFileMagic) {
+            throw std::runtime_error("BVH: not a saved tree");
+        }
+        if (header.version != kBvhFileVersion) {
+            throw std::runtime_error("BVH: unsupported saved tree version");
+        }
+        if (header.scalar_size != sizeof(T) || header.scalar_is_floating != std::is_floating_point_v<T>) {
+            throw std::runtime_error("BVH: the saved tree has another scalar type");
+        }
+
+        BVH tree;
+        tree.storage_.push_back(file);
+        tree.mapped_ = true;
+        tree.options_.split_method = static_cast<SplitMethod>(header.split_method);
+        tree.options_.sah_bins = header.sah_bins;
+        tree.options_.max_leaf_size = header.max_leaf_size;
+        tree.options_.node_bounds = static_cast<NodeBounds>(header.node_bounds);
+        tree.options_.branching_factor = header.branching_factor;
+        tree.options_.node_order = static_cast<NodeOrder>(header.node_order);
+        tree.id_capacity_ = header.id_capacity;
+        tree.built_sah_cost_ = header.built_sah_cost;
+
+        tree.triangles_ = MapSection<IndexedTriangle<T>>(*file, header, BvhSection::kTriangles);
+        tree.prepared_ = MapSection<PreparedTriangle<T>>(*file, header, BvhSection::kPrepared);
+        tree.positions_ = MapSection<uint32_t>(*file, header, BvhSection::kPositions);
+        tree.sources_ = MapSection<NodeIdx>(*file, header, BvhSection::kSources);
+        tree.parents_ = MapSection<NodeIdx>(*file, header, BvhSection::kParents);
+        tree.leaf_of_ = MapSection<NodeIdx>(*file, header, BvhSection::kLeafOf);
+        tree.subtree_sizes_ = MapSection<uint32_t>(*file, header, BvhSection::kSubtreeSizes);
+
+        const size_t n = tree.triangles_.size();
+        auto soa_values = MapSection<T>(*file, header, BvhSection::kSoaValues);
+        auto soa_ids = MapSection<TrIndex>(*file, header, BvhSection::kSoaIds);
+        auto soa_degenerate = MapSection<uint8_t>(*file, header, BvhSection::kSoaDegenerate);
+        if (soa_values.size() != TriangleSoA<T>::kComponents * n || soa_ids.size() != n || soa_degenerate.size() != n
+            || tree.prepared_.size() != n || tree.leaf_of_.size() != n || tree.positions_.size() != tree.id_capacity_
+            || tree.parents_.size() != tree.subtree_sizes_.size() || tree.sources_.size() != tree.parents_.size())
+        {
+            throw std::runtime_error("BVH: the saved tree is corrupt");
+        }
+        tree.soa_ = TriangleSoA<T>::View(soa_values, soa_ids, soa_degenerate, static_cast<T>(header.soa_scale));
+
+        switch (header.traversal_layout) {
+            case 0: tree.traversal_nodes_.template emplace<0>(MapSection<PackedNode<T>>(*file, header, BvhSection::kTraversalNodes)); break;
+            case 1: tree.traversal_nodes_.template emplace<1>(MapSection<PackedNode<float>>(*file, header, BvhSection::kTraversalNodes)); break;
+            case 2: tree.traversal_nodes_.template emplace<2>(MapSection<WideNode<T, 4>>(*file, header, BvhSection::kTraversalNodes)); break;
+            case 3: tree.traversal_nodes_.template emplace<3>(MapSection<WideNode<float, 4>>(*file, header, BvhSection::kTraversalNodes)); break;
+            case 4: tree.traversal_nodes_.template emplace<4>(MapSection<WideNode<T, 8>>(*file, header, BvhSection::kTraversalNodes)); break;
+            case 5: tree.traversal_nodes_.template emplace<5>(MapSection<WideNode<float, 8>>(*file, header, BvhSection::kTraversalNodes)); break;
+            default: throw std::runtime_error("BVH: the saved tree is corrupt");
+        }
+
+        auto file_nodes = MapSection<const BvhFileNode<T>>(*file, header, BvhSection::kNodes);
+        if (header.root < 0 || static_cast<uint64_t>(header.root) >= file_nodes.size()) {
+            throw std::runtime_error("BVH: the saved tree is corrupt");
+        }
+        tree.root_ = static_cast<NodeIdx>(header.root);
+
+        tree.nodes_.reserve(file_nodes.size());
+        for (const auto& node : file_nodes) {
+            if (node.left == invalid_idx) {
+                if (node.first > n || node.count > n - node.first) {
+                    throw std::runtime_error("BVH: the saved tree is corrupt");
+                }
+                tree.nodes_.emplace_back(node.aabb, std::span<const IndexedTriangle<T>>(tree.triangles_.data() + node.first,
+                                                                                        node.count));
+            } else {
+                if (node.left < 0 || node.right < 0 || static_cast<uint64_t>(node.left) >= file_nodes.size()
+                    || static_cast<uint64_t>(node.right) >= file_nodes.size())
+                {
+                    throw std::runtime_error("BVH: the saved tree is corrupt");
+                }
+                tree.nodes_.emplace_back(node.aabb, node.left, node.right);
+            }
+        }
+
+        return tree;
+    }
+
+    /**
+     * @brief Whether the tree was loaded with Map
+     */
+    bool IsMapped() const noexcept {
+        return mapped_;
+    }
+
+    /**
+     * @brief Moves the triangle with the given id to new coordinates
+     * 
+     * The node boxes are not touched: call Refit once all triangles of a step are moved, before
+     * the next query. Must not run concurrently with a query.
+     * 
+     * @throws std::invalid_argument if the tree has no triangle with this id
+     */
+    void SetTriangle(TrIndex id, const Triangle<T>& triangle) {
+        CheckWritable();
+        if (id >= positions_.size() || positions_[id] == kNoPosition) {
+            throw std::invalid_argument("BVH: no triangle with this id");
+        }
+
+        soa_.GrowTolerances(StoreTriangle(positions_[id], triangle));
+    }
+
+    /**
+     * @brief Recomputes all node boxes bottom-up from the current triangles in O(n), keeping the
+     * structure of the tree
+     * 
+     * The queries stay exact after any movement, but the tree fits the triangles worse the
+     * further they move from where it was built; see GetSahCostGrowth. In parallel mode subtrees
+     * of at least BuildOptions::parallel_threshold triangles are refit concurrently.
+     */
+    void Refit(concurrency::Execution execution = concurrency::Execution::kSerial) {
+        CheckWritable();
+        const bool parallel = execution == concurrency::Execution::kParallel;
+
+        RefitSubtree(root_, parallel);
+        std::visit([this, parallel](auto nodes) { RefitTraversalNodes(nodes, parallel); }, traversal_nodes_);
+    }
+
+    /**
+     * @brief Moves every triangle of the tree to triangles[id] and refits the tree
+     * 
+     * Faster than SetTriangle for all triangles, as the copies are written in the order of the
+     * tree, in parallel mode concurrently.
+     * 
+     * @throws std::invalid_argument if triangles has no element for some id of the tree
+     */
+    void Refit(std::span<const Triangle<T>> triangles,
+               concurrency::Execution execution = concurrency::Execution::kSerial)
+    {
+        CheckWritable();
+        if (triangles.size() < id_capacity_) {
+            throw std::invalid_argument("BVH: fewer triangles than ids in the tree");
+        }
+
+        std::mutex scale_mutex;
+        T scale = 0;
+        const bool parallel = execution == concurrency::Execution::kParallel;
+        concurrency::ForEachChunk(triangles_.size(), parallel, options_.parallel_threshold, [&](size_t first, size_t last) {
+            T chunk_scale = 0;
+            for (size_t i = first; i != last; ++i) {
+                chunk_scale = std::max(chunk_scale, StoreTriangle(i, triangles[triangles_[i].id]));
+            }
+
+            std::lock_guard lock(scale_mutex);
+            scale = std::max(scale, chunk_scale);
+        });
+
+        soa_.GrowTolerances(scale);
+        Refit(execution);
+    }
+
+    /**
+     * @brief Ids of all triangles that intersect at least one other triangle
+     * 
+     * The query does not modify the tree, so it may be run from several threads at once.
+     * In parallel mode all tasks set their hits in one shared result with atomic bit-sets.
+     * With options.skip_flagged, pairs of triangles that are both in the result already and node
+     * pairs whose subtrees are fully in the result are not tested.
+     * 
+     * @param options Query parameters
+     * @param stats If not null, receives the work counters of the traversal
+     * @return the ids as a bitmap, iterated in ascending order
+     */
+    IntersectionResult FindIntersectingTriangles(
+        const QueryOptions& options = {}, TraversalStats* stats = nullptr) const
+    {
+        IntersectionResult result(id_capacity_);
+        TraversalStats total;
+
+        if (options.skip_flagged) {
+            IntersectionResult flagged(triangles_.size());
+            auto unflagged = std::make_unique<std::atomic<uint32_t>[]>(subtree_sizes_.size());
+            for (size_t idx = 0; idx != subtree_sizes_.size(); ++idx) {
+                unflagged[idx].store(subtree_sizes_[idx], std::memory_order_relaxed);
+            }
+
+            total = Traverse(options, FlaggingSink{this, &result, &flagged, unflagged.get()});
+        } else {
+            total = Traverse(options, IdSink{this, &result, options.execution == concurrency::Execution::kParallel});
+        }
+
+        if (stats) {
+            *stats = total;
+        }
+
+        return result;
+    }
+
+    /**
+     * @brief Calls visit(i, j) with i < j for every pair of intersecting triangle ids as soon as
+     * it is found
+     * 
+     * Every unordered pair is reported exactly once, in traversal order; nothing is buffered.
+     * In parallel mode visit is called concurrently from several threads and must be thread-safe.
+     * 
+     * @param visit Callable with the signature void(TrIndex, TrIndex) or bool(TrIndex, TrIndex);
+     * returning false stops the traversal, including the other parallel tasks
+     * @param options Query parameters
+     * @param stats If not null, receives the work counters of the traversal
+     */
+    template <typename Visitor>
+    void ForEachIntersectingPair(Visitor&& visit, const QueryOptions& options = {},
+                                 TraversalStats* stats = nullptr) const
+    {
+        PairSink<std::remove_reference_t<Visitor>> sink{this, &visit};
+
+        TraversalStats total = Traverse(options, sink);
+        if (stats) {
+            *stats = total;
+        }
+    }
+
+    /**
+     * @brief Ids of the intersecting pairs found first, stopping the traversal once there are
+     * max_ids of them
+     * 
+     * The result holds both ids of every pair found before the stop, so it may contain a few
+     * more than max_ids ids; which ids are found first depends on the traversal order.
+     */
+    IntersectionResult FindFirstIntersectingTriangles(size_t max_ids, const QueryOptions& options = {},
+                                                      TraversalStats* stats = nullptr) const
+    {
+        IntersectionResult result(id_capacity_);
+        if (max_ids == 0) {
+            return result;
+        }
+
+        std::atomic<size_t> found{0};
+        ForEachIntersectingPair(
+            [&](TrIndex a, TrIndex b) {
+                size_t inserted = result.AtomicInsert(a) + result.AtomicInsert(b);
+                return found.fetch_add(inserted, std::memory_order_relaxed) + inserted < max_ids;
+            },
+            options,
+            stats
+        );
+
+        return result;
+    }
+
+    /**
+     * @brief The first max_pairs intersecting pairs (i, j), i < j, found by the traversal, which
+     * stops as soon as they are found
+     */
+    std::vector<std::pair<TrIndex, TrIndex>> FindFirstIntersectingPairs(
+        size_t max_pairs, const QueryOptions& options = {}, TraversalStats* stats = nullptr) const
+    {
+        std::vector<std::pair<TrIndex, TrIndex>> pairs(max_pairs);
+        if (max_pairs == 0) {
+            return pairs;
+        }
+
+        std::atomic<size_t> found{0};
+        ForEachIntersectingPair(
+            [&](TrIndex a, TrIndex b) {
+                size_t slot = found.fetch_add(1, std::memory_order_relaxed);
+                if (slot < max_pairs) {
+                    pairs[slot] = {a, b};
+                }
+                return slot + 1 < max_pairs;
+            },
+            options,
+            stats
+        );
+
+        pairs.resize(std::min(found.load(), max_pairs));
+        return pairs;
+    }
+
+    /**
+     * @brief Whether any two triangles intersect; the traversal stops at the first intersection
+     */
+    bool HasIntersections(const QueryOptions& options = {}, TraversalStats* stats = nullptr) const {
+        return !FindFirstIntersectingPairs(1, options, stats).empty();
+    }
+
+    /**
+     * @brief Calls visit(i, j) for every pair of intersecting triangles with id i in this tree
+     * and id j in other
+     * 
+     * Only the cross pairs are traversed, none inside either tree, and neither tree is modified,
+     * so a tree may be queried against any number of partners, also concurrently. Both trees are
+     * traversed in their packed layouts when both have a branching factor of 2 and in their built
+     * binary trees otherwise. options.skip_flagged is ignored.
+     * 
+     * @param visit Callable with the signature void(TrIndex, TrIndex) or bool(TrIndex, TrIndex);
+     * returning false stops the traversal, including the other parallel tasks
+     */
+    template <typename Visitor>
+    void ForEachIntersectingPair(const BVH& other, Visitor&& visit, const QueryOptions& options = {},
+                                 TraversalStats* stats = nullptr) const
+    {
+        CrossPairSink<std::remove_reference_t<Visitor>> sink{this, &other, &visit};
+
+        TraversalStats total = TraverseCross(other, options, sink);
+        if (stats) {
+            *stats = total;
+        }
+    }
+
+    /**
+     * @brief Ids of the triangles of this tree that intersect a triangle of other, and of the
+     * triangles of other that intersect a triangle of this tree
+     */
+    std::pair<IntersectionResult, IntersectionResult> FindIntersectingTriangles(
+        const BVH& other, const QueryOptions& options = {}, TraversalStats* stats = nullptr) const
+    {
+        std::pair<IntersectionResult, IntersectionResult> result{id_capacity_, other.id_capacity_};
+        const bool atomic = options.execution == concurrency::Execution::kParallel;
+
+        TraversalStats total = TraverseCross(other, options, CrossIdSink{this, &other, &result.first,
+                                                                          &result.second, atomic});
+        if (stats) {
+            *stats = total;
+        }
+
+        return result;
     }
 
-    std::set<TrIndex> FindIntersectingTriangles() {
-        RecursiveFindIntersections(root_, root_);
-        return intersecting_triangles_;
+    /**
+     * @brief Whether any triangle of this tree intersects a triangle of other; the traversal stops
+     * at the first intersection
+     */
+    bool HasIntersections(const BVH& other, const QueryOptions& options = {},
+                          TraversalStats* stats = nullptr) const
+    {
+        std::atomic<bool> found{false};
+        ForEachIntersectingPair(other, [&found](TrIndex, TrIndex) {
+            found.store(true, std::memory_order_relaxed);
+            return false;
+        }, options, stats);
+        return found.load();
     }
 
     const BVHNode<T>* GetRoot() const {
@@ -34,36 +544,415 @@ public:
         return &nodes_[idx];
     }
 
+    size_t GetNumberOfNodes() const noexcept {
+        return nodes_.size();
+    }
+
+    /**
+     * @brief Surface area heuristic cost of the built tree
+     * 
+     * Sum of kSahTraversalCost over the inner nodes and kSahIntersectionCost per triangle over
+     * the leaves, each weighted by the node surface area relative to the root. Lower is better;
+     * the value is comparable between builders run on the same input.
+     */
+    double GetSahCost() const {
+        double root_area = nodes_[root_].GetAABB().SurfaceArea();
+        if (root_area <= 0) {
+            root_area = 1;
+        }
+
+        double cost = 0;
+        for (const auto& node : nodes_) {
+            double area = node.GetAABB().SurfaceArea() / root_area;
+            cost += node.IsLeaf()
+                ? kSahIntersectionCost * area * node.GetNumberOfTriangles()
+                : kSahTraversalCost * area;
+        }
+
+        return cost;
+    }
+
+    /**
+     * @brief SAH cost of the tree now relative to right after the build, 1 for a tree that was
+     * never refit
+     * 
+     * Refits keep the splits the builder chose for the old positions, so this rises as the
+     * triangles move, and the query time rises about as fast. A rebuild pays off once the extra
+     * query time over the next steps exceeds the build time; with a query every step that is
+     * typically at a growth of about 1.5.
+     */
+    double GetSahCostGrowth() const {
+        return (built_sah_cost_ > 0) ? GetSahCost() / built_sah_cost_ : 1.0;
+    }
+
 private:
-    static constexpr int kMaxTrianglesPerLeaf = 3;
+    static constexpr double kSahTraversalCost = 1.0;
+    static constexpr double kSahIntersectionCost = 1.0;
+    static constexpr uint32_t kNoPosition = std::numeric_limits<uint32_t>::max();
+
+    static constexpr size_t kNumberOfSections = static_cast<size_t>(BvhSection::kNumberOfSections);
+
+    // owners of the memory the spans below view: the arrays of a built tree, or the file of a
+    // mapped one
+    std::vector<std::shared_ptr<const void>> storage_;
+    bool mapped_ = false;
 
+    BuildOptions options_;
     NodeIdx root_ = invalid_idx;
     std::vector<BVHNode<T>> nodes_;
-    std::vector<IndexedTriangle<T>> triangles_;
-    std::set<TrIndex> intersecting_triangles_;
+    std::span<IndexedTriangle<T>> triangles_;
+
+    // the nodes the queries traverse, of options_.branching_factor and options_.node_bounds
+    std::variant<
+        std::span<PackedNode<T>>,
+        std::span<PackedNode<float>>,
+        std::span<WideNode<T, 4>>,
+        std::span<WideNode<float, 4>>,
+        std::span<WideNode<T, 8>>,
+        std::span<WideNode<float, 8>>
+    > traversal_nodes_;
+
+    TriangleSoA<T> soa_;
+    std::span<PreparedTriangle<T>> prepared_;
+    size_t id_capacity_ = 0;
+
+    // position in triangles_ of every id, kNoPosition for ids not in the tree
+    std::span<uint32_t> positions_;
+    double built_sah_cost_ = 0;
+
+    // indexed by the positions of the packed nodes or the slots of the wide ones; sources_ holds
+    // the index in nodes_ of the node behind each
+    std::span<NodeIdx> sources_;
+    std::span<NodeIdx> parents_;
+    std::span<NodeIdx> leaf_of_;
+    std::span<uint32_t> subtree_sizes_;
+
+    // sorted codes of triangles_, only during a SplitMethod::kLbvh build
+    std::vector<MortonCode<T>> morton_codes_;
+
+    BVH() = default;
+
+    /**
+     * @brief Moves the array into the storage of the tree and returns a view of it
+     */
+    template <typename X>
+    std::span<X> Keep(std::vector<X>&& array) {
+        auto kept = std::make_shared<std::vector<X>>(std::move(array));
+        storage_.push_back(kept);
+        return *kept;
+    }
+
+    /**
+     * @brief View of a section of a file written by Save
+     * 
+     * The span is not const, as the members are the same for built and mapped trees, but a mapped
+     * tree never writes through it, see CheckWritable.
+     */
+    template <typename X>
+    static std::span<X> MapSection(const io::MappedFile& file, const BvhFileHeader& header, BvhSection section) {
+        const auto& entry = header.sections[static_cast<size_t>(section)];
+        if (entry.element_size != sizeof(X) || entry.offset % kBvhFileAlignment != 0 || entry.offset > file.Size()
+            || entry.count > (file.Size() - entry.offset) / sizeof(X))
+        {
+            throw std::runtime_error("BVH: the saved tree is corrupt");
+        }
+
+        return {reinterpret_cast<X*>(const_cast<std::byte*>(file.Data() + entry.offset)), entry.count};
+    }
+
+    void CheckWritable() const {
+        if (mapped_) {
+            throw std::runtime_error("BVH: a mapped tree is read-only");
+        }
+    }
 
     size_t GetSplitAxis(const AABB<T>& aabb) const {
         Vector<T> diff = aabb.max - aabb.min;
         return (diff.x >= diff.y && diff.x >= diff.z) ? 0 : (diff.y >= diff.z) ? 1 : 2;
     }
 
-    NodeIdx RecursiveBuild(size_t start, size_t end) {
+    AABB<T> CalculateAABB(size_t start, size_t end) const {
+        AABB<T> aabb;
+        for (size_t i = start; i != end; ++i) {
+            aabb.Expand(triangles_[i].triangle);
+        }
+        return aabb;
+    }
+
+    size_t Partition(size_t start, size_t end, const AABB<T>& aabb) {
         std::span<IndexedTriangle<T>> triangles(triangles_.begin() + start, triangles_.begin() + end);
 
+        return (options_.split_method == SplitMethod::kSah)
+            ? PartitionSah(triangles, aabb, start)
+            : PartitionMedian(triangles, aabb, start);
+    }
+
+    NodeIdx RecursiveBuild(std::vector<BVHNode<T>>& nodes, size_t start, size_t end) {
+        if (options_.split_method == SplitMethod::kLbvh) {
+            return MortonBuild(nodes, start, end);
+        }
+
+        AABB<T> aabb = CalculateAABB(start, end);
+
+        if (end - start <= options_.max_leaf_size) {
+            nodes.emplace_back(aabb, std::span<const IndexedTriangle<T>>(triangles_.data() + start, end - start));
+            return nodes.size() - 1;
+        }
+
+        size_t mid = Partition(start, end, aabb);
+
+        NodeIdx left = RecursiveBuild(nodes, start, mid);
+        NodeIdx right = RecursiveBuild(nodes, mid, end);
+
+        nodes.emplace_back(aabb, left, right);
+        return nodes.size() - 1;
+    }
+
+    /**
+     * @brief Top of the tree built in parallel
+     * 
+     * Inner tasks only remember the split; a task below options_.parallel_threshold builds its
+     * whole subtree serially into its own node vector with local indices.
+     */
+    struct BuildTask {
         AABB<T> aabb;
-        for (auto&& tr : triangles) {
-            aabb.Expand(tr.triangle);
+        std::unique_ptr<BuildTask> left;
+        std::unique_ptr<BuildTask> right;
+        std::vector<BVHNode<T>> nodes;
+    };
+
+    std::unique_ptr<BuildTask> ParallelBuild(size_t start, size_t end) {
+        auto task = std::make_unique<BuildTask>();
+
+        if (end - start < options_.parallel_threshold || end - start <= options_.max_leaf_size) {
+            RecursiveBuild(task->nodes, start, end);
+            return task;
+        }
+
+        const bool lbvh = options_.split_method == SplitMethod::kLbvh;
+        size_t mid = 0;
+        if (lbvh) {
+            mid = MortonSplit(start, end);
+        } else {
+            task->aabb = CalculateAABB(start, end);
+            mid = Partition(start, end, task->aabb);
+        }
+
+        concurrency::TaskGroup group;
+        group.Run([&] { task->left = ParallelBuild(start, mid); });
+        task->right = ParallelBuild(mid, end);
+        group.Wait();
+
+        if (lbvh) {
+            task->aabb = TaskAABB(*task->left);
+            task->aabb.Expand(TaskAABB(*task->right));
+        }
+
+        return task;
+    }
+
+    static const AABB<T>& TaskAABB(const BuildTask& task) {
+        return task.left ? task.aabb : task.nodes.back().GetAABB();
+    }
+
+    /**
+     * @brief Reorders triangles_ by the Morton codes of their centroids in the box of all
+     * centroids, keeping the sorted codes in morton_codes_ for MortonSplit
+     */
+    void SortByMortonCodes() {
+        const bool parallel = options_.execution == concurrency::Execution::kParallel;
+        const size_t n = triangles_.size();
+
+        std::vector<Point<T>> centroids(n);
+        concurrency::ForEachChunk(n, parallel, options_.parallel_threshold, [&](size_t first, size_t last) {
+            for (size_t i = first; i != last; ++i) {
+                centroids[i] = Centroid(triangles_[i]);
+            }
+        });
+
+        AABB<T> bounds;
+        for (const auto& centroid : centroids) {
+            bounds.Expand(AABB<T>{centroid, centroid});
         }
 
-        if (end - start <= kMaxTrianglesPerLeaf) {
-            nodes_.emplace_back(aabb, triangles);
+        morton_codes_.resize(n);
+        std::vector<uint32_t> order(n);
+        concurrency::ForEachChunk(n, parallel, options_.parallel_threshold, [&](size_t first, size_t last) {
+            for (size_t i = first; i != last; ++i) {
+                morton_codes_[i] = EncodeMorton(centroids[i], bounds);
+                order[i] = static_cast<uint32_t>(i);
+            }
+        });
+
+        RadixSortByKey(morton_codes_, order, parallel, options_.parallel_threshold);
+
+        std::vector<IndexedTriangle<T>> unsorted(triangles_.begin(), triangles_.end());
+        concurrency::ForEachChunk(n, parallel, options_.parallel_threshold, [&](size_t first, size_t last) {
+            for (size_t i = first; i != last; ++i) {
+                triangles_[i] = unsorted[order[i]];
+            }
+        });
+    }
+
+    /**
+     * @brief End of the left half of [start, end) in Morton order: the first code with the
+     * highest bit in which the codes of the range differ set, or the middle if they are all equal
+     */
+    size_t MortonSplit(size_t start, size_t end) const {
+        const auto first = morton_codes_[start];
+        const auto last = morton_codes_[end - 1];
+        if (first == last) {
+            return start + (end - start) / 2;
+        }
+
+        const auto bit = std::bit_floor(first ^ last);
+        return std::partition_point(morton_codes_.begin() + start, morton_codes_.begin() + end,
+                                    [bit](auto code) { return !(code & bit); }) - morton_codes_.begin();
+    }
+
+    /**
+     * @brief RecursiveBuild of SplitMethod::kLbvh: the same order of nodes, with the boxes of
+     * the inner nodes merged from their children instead of computed from the triangles
+     */
+    NodeIdx MortonBuild(std::vector<BVHNode<T>>& nodes, size_t start, size_t end) {
+        if (end - start <= options_.max_leaf_size) {
+            nodes.emplace_back(CalculateAABB(start, end),
+                               std::span<const IndexedTriangle<T>>(triangles_.data() + start, end - start));
+            return nodes.size() - 1;
+        }
+
+        size_t mid = MortonSplit(start, end);
+
+        NodeIdx left = MortonBuild(nodes, start, mid);
+        NodeIdx right = MortonBuild(nodes, mid, end);
+
+        AABB<T> aabb = nodes[left].GetAABB();
+        aabb.Expand(nodes[right].GetAABB());
+        nodes.emplace_back(aabb, left, right);
+        return nodes.size() - 1;
+    }
+
+    /**
+     * @brief Appends the task tree to nodes_ in the order RecursiveBuild would have produced
+     * 
+     * Subtrees are emitted left, right, parent, so the result is identical to the serial build.
+     */
+    NodeIdx Stitch(const BuildTask& task) {
+        if (!task.left) {
+            NodeIdx offset = nodes_.size();
+            for (const auto& node : task.nodes) {
+                if (node.IsLeaf()) {
+                    nodes_.push_back(node);
+                } else {
+                    nodes_.emplace_back(node.GetAABB(), node.GetLeftIdx() + offset, node.GetRightIdx() + offset);
+                }
+            }
             return nodes_.size() - 1;
         }
 
+        NodeIdx left = Stitch(*task.left);
+        NodeIdx right = Stitch(*task.right);
+
+        nodes_.emplace_back(task.aabb, left, right);
+        return nodes_.size() - 1;
+    }
+
+    /**
+     * @brief Refit of the subtree below idx in nodes_
+     * 
+     * RecursiveBuild and Stitch emit every subtree as one range of nodes_ that starts with its
+     * leftmost leaf and ends with its root, children before parents, so a serial refit is a
+     * forward pass over the range. Subtrees of at least options_.parallel_threshold triangles
+     * refit their children concurrently, like ParallelBuild builds them.
+     */
+    void RefitSubtree(NodeIdx idx, bool parallel) {
+        NodeIdx first = idx;
+        while (!nodes_[first].IsLeaf()) {
+            first = nodes_[first].GetLeftIdx();
+        }
+        NodeIdx last = idx;
+        while (!nodes_[last].IsLeaf()) {
+            last = nodes_[last].GetRightIdx();
+        }
+
+        const auto* first_triangle = nodes_[first].GetTriangles().data();
+        const auto* last_triangle = nodes_[last].GetTriangles().data() + nodes_[last].GetNumberOfTriangles();
+
+        if (!parallel || static_cast<size_t>(last_triangle - first_triangle) < options_.parallel_threshold) {
+            for (NodeIdx i = first; i <= idx; ++i) {
+                RefitNode(nodes_[i]);
+            }
+            return;
+        }
+
+        concurrency::TaskGroup group;
+        group.Run([&] { RefitSubtree(nodes_[idx].GetLeftIdx(), true); });
+        RefitSubtree(nodes_[idx].GetRightIdx(), true);
+        group.Wait();
+
+        RefitNode(nodes_[idx]);
+    }
+
+    void RefitNode(BVHNode<T>& node) {
+        if (node.IsLeaf()) {
+            AABB<T> aabb;
+            for (const auto& tr : node.GetTriangles()) {
+                aabb.Expand(tr.triangle);
+            }
+            node.SetAABB(aabb);
+        } else {
+            AABB<T> aabb = nodes_[node.GetLeftIdx()].GetAABB();
+            aabb.Expand(nodes_[node.GetRightIdx()].GetAABB());
+            node.SetAABB(aabb);
+        }
+    }
+
+    /**
+     * @brief Copies the refit boxes of nodes_ into the traversal nodes, inflated like at the build
+     */
+    template <typename Nodes>
+    void RefitTraversalNodes(Nodes nodes, bool parallel) {
+        concurrency::ForEachChunk(sources_.size(), parallel, options_.parallel_threshold, [&](size_t first, size_t last) {
+            for (size_t i = first; i != last; ++i) {
+                if (sources_[i] != invalid_idx) {
+                    SetTraversalBox(nodes, i, nodes_[sources_[i]].GetAABB());
+                }
+            }
+        });
+    }
+
+    /**
+     * @brief Copies triangle to position i of triangles_, soa_ and prepared_
+     * 
+     * @return the scale for TriangleSoA::GrowTolerances
+     */
+    T StoreTriangle(size_t i, const Triangle<T>& triangle) {
+        triangles_[i].triangle = triangle;
+        prepared_[i] = PreparedTriangle<T>(triangle);
+        return soa_.SetTriangle(i, triangle);
+    }
+
+    template <typename B>
+    static void SetTraversalBox(std::span<PackedNode<B>> nodes, size_t idx, const AABB<T>& aabb) {
+        nodes[idx].SetAABB(InflateBounds<B>(aabb));
+    }
+
+    template <typename B, size_t kWidth>
+    static void SetTraversalBox(std::span<WideNode<B, kWidth>> nodes, size_t slot, const AABB<T>& aabb) {
+        nodes[slot / kWidth].SetAABB(slot % kWidth, InflateBounds<B>(aabb));
+    }
+
+    static Point<T> Centroid(const IndexedTriangle<T>& tr) {
+        return AABB<T>{tr.triangle}.GetCenter();
+    }
+
+    size_t PartitionMedian(std::span<IndexedTriangle<T>> triangles, const AABB<T>& aabb, size_t start) {
         size_t axis = GetSplitAxis(aabb);
+        size_t mid = triangles.size() / 2;
 
-        std::sort(
+        std::nth_element(
             triangles.begin(),
+            triangles.begin() + mid,
             triangles.end(),
             [axis](const IndexedTriangle<T>& a, const IndexedTriangle<T>& b) {
                 AABB aabb_a{a.triangle};
@@ -72,49 +961,763 @@ private:
             }
         );
 
-        size_t mid = start + (end - start) / 2;
+        return start + mid;
+    }
 
-        nodes_.emplace_back(aabb, RecursiveBuild(start, mid), RecursiveBuild(mid, end));
-        return nodes_.size() - 1;
+    /**
+     * @brief Partitions the triangles by the cheapest binned SAH split
+     * 
+     * Centroids are distributed into options_.sah_bins bins along each axis, and for every
+     * boundary between bins the cost N_left * A_left + N_right * A_right is evaluated. Falls
+     * back to the median split when all centroids coincide.
+     * 
+     * @return index of the first triangle of the right subtree
+     */
+    size_t PartitionSah(std::span<IndexedTriangle<T>> triangles, const AABB<T>& aabb, size_t start) {
+        struct Bin {
+            AABB<T> aabb;
+            size_t count = 0;
+        };
+
+        AABB<T> centroid_bounds;
+        for (const auto& tr : triangles) {
+            Point<T> c = Centroid(tr);
+            centroid_bounds.Expand(AABB<T>{c, c});
+        }
+
+        const size_t bins_count = options_.sah_bins;
+
+        auto BinIndex = [&](const IndexedTriangle<T>& tr, size_t axis) {
+            double extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+            double offset = (Centroid(tr)[axis] - centroid_bounds.min[axis]) / extent;
+            return std::min(bins_count - 1, static_cast<size_t>(offset * bins_count));
+        };
+
+        double best_cost = limits::MaxValue<double>();
+        size_t best_axis = 0;
+        size_t best_split = 0;
+
+        for (size_t axis = 0; axis != 3; ++axis) {
+            if (centroid_bounds.max[axis] - centroid_bounds.min[axis] <= constants::kEpsilon) {
+                continue;
+            }
+
+            std::array<Bin, kMaxSahBins> bins{};
+            for (const auto& tr : triangles) {
+                Bin& bin = bins[BinIndex(tr, axis)];
+                bin.aabb.Expand(tr.triangle);
+                ++bin.count;
+            }
+
+            std::array<double, kMaxSahBins> right_costs{};
+            AABB<T> right_aabb;
+            size_t right_count = 0;
+            for (size_t i = bins_count - 1; i != 0; --i) {
+                right_aabb.Expand(bins[i].aabb);
+                right_count += bins[i].count;
+                right_costs[i] = right_count * static_cast<double>(right_aabb.SurfaceArea());
+            }
+
+            AABB<T> left_aabb;
+            size_t left_count = 0;
+            for (size_t i = 0; i != bins_count - 1; ++i) {
+                left_aabb.Expand(bins[i].aabb);
+                left_count += bins[i].count;
+
+                if (left_count == 0 || left_count == triangles.size()) {
+                    continue;
+                }
+
+                double cost = left_count * static_cast<double>(left_aabb.SurfaceArea())
+                    + right_costs[i + 1];
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_split = i;
+                }
+            }
+        }
+
+        if (best_cost == limits::MaxValue<double>()) {
+            return PartitionMedian(triangles, aabb, start);
+        }
+
+        auto mid = std::partition(
+            triangles.begin(),
+            triangles.end(),
+            [&](const IndexedTriangle<T>& tr) {
+                return BinIndex(tr, best_axis) <= best_split;
+            }
+        );
+
+        return start + (mid - triangles.begin());
     }
 
-    void RecursiveFindIntersections(NodeIdx a_idx, NodeIdx b_idx) {
-        const auto& a = nodes_[a_idx];
-        const auto& b = nodes_[b_idx];
+    /**
+     * @brief Traversal state of one task
+     * 
+     * Sink receives the positions of the intersecting triangle pairs and returns false to stop
+     * the query; stop is shared by all tasks of the query and checked on every node pair.
+     */
+    template <typename Sink>
+    struct QueryContext {
+        Sink sink;
+        TraversalStats stats;
+        NarrowPhase narrow_phase = NarrowPhase::kSat;
+        std::atomic<bool>* stop = nullptr;
 
-        if (!AABB<T>::Intersects(a.GetAABB(), b.GetAABB())) {
-            return;
+        bool Stopped() const noexcept {
+            return stop->load(std::memory_order_relaxed);
+        }
+
+        void Report(size_t i, size_t j) {
+            if (!sink(i, j)) {
+                stop->store(true, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    /**
+     * @brief Sets both ids of every pair in the result
+     */
+    struct IdSink {
+        const BVH* tree;
+        IntersectionResult* result;
+        bool atomic;
+
+        bool operator()(size_t i, size_t j) const noexcept {
+            if (atomic) {
+                result->AtomicInsert(tree->triangles_[i].id);
+                result->AtomicInsert(tree->triangles_[j].id);
+            } else {
+                result->Insert(tree->triangles_[i].id);
+                result->Insert(tree->triangles_[j].id);
+            }
+            return true;
+        }
+    };
+
+    /**
+     * @brief IdSink that also tracks which positions are flagged and how many unflagged triangles
+     * every subtree still has, so pairs of flagged triangles and of fully flagged subtrees can
+     * be skipped
+     */
+    struct FlaggingSink {
+        const BVH* tree;
+        IntersectionResult* result;
+        IntersectionResult* flagged;
+        std::atomic<uint32_t>* unflagged;
+
+        bool operator()(size_t i, size_t j) const noexcept {
+            Flag(i);
+            Flag(j);
+            return true;
+        }
+
+        void Flag(size_t i) const noexcept {
+            if (!flagged->AtomicInsert(i)) {
+                return;
+            }
+
+            result->AtomicInsert(tree->triangles_[i].id);
+            for (NodeIdx idx = tree->leaf_of_[i]; idx != invalid_idx; idx = tree->parents_[idx]) {
+                unflagged[idx].fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        bool IsFlagged(size_t i) const noexcept {
+            return flagged->AtomicContains(i);
+        }
+
+        bool IsFullyFlagged(NodeIdx idx) const noexcept {
+            return unflagged[idx].load(std::memory_order_relaxed) == 0;
         }
+    };
 
-        if (a.IsLeaf() && b.IsLeaf()) {
-            auto a_triangles = a.GetTriangles();
-            auto b_triangles = b.GetTriangles();
+    template <typename Visitor>
+    struct PairSink {
+        const BVH* tree;
+        Visitor* visit;
 
-            for (const auto& a_tr : a_triangles) {
-                for (const auto& b_tr : b_triangles) {
-                    if (a_tr.id < b_tr.id && Triangle<T>::Intersect(a_tr.triangle, b_tr.triangle)) { 
-                        intersecting_triangles_.insert(a_tr.id);
-                        intersecting_triangles_.insert(b_tr.id);
+        bool operator()(size_t i, size_t j) const {
+            TrIndex a = std::min(tree->triangles_[i].id, tree->triangles_[j].id);
+            TrIndex b = std::max(tree->triangles_[i].id, tree->triangles_[j].id);
+
+            if constexpr (std::is_same_v<std::invoke_result_t<Visitor&, TrIndex, TrIndex>, bool>) {
+                return (*visit)(a, b);
+            } else {
+                (*visit)(a, b);
+                return true;
+            }
+        }
+    };
+
+    /**
+     * @brief IdSink of a cross query, with positions i in tree and j in other
+     */
+    struct CrossIdSink {
+        const BVH* tree;
+        const BVH* other;
+        IntersectionResult* tree_result;
+        IntersectionResult* other_result;
+        bool atomic;
+
+        bool operator()(size_t i, size_t j) const noexcept {
+            if (atomic) {
+                tree_result->AtomicInsert(tree->triangles_[i].id);
+                other_result->AtomicInsert(other->triangles_[j].id);
+            } else {
+                tree_result->Insert(tree->triangles_[i].id);
+                other_result->Insert(other->triangles_[j].id);
+            }
+            return true;
+        }
+    };
+
+    template <typename Visitor>
+    struct CrossPairSink {
+        const BVH* tree;
+        const BVH* other;
+        Visitor* visit;
+
+        bool operator()(size_t i, size_t j) const {
+            TrIndex a = tree->triangles_[i].id;
+            TrIndex b = other->triangles_[j].id;
+
+            if constexpr (std::is_same_v<std::invoke_result_t<Visitor&, TrIndex, TrIndex>, bool>) {
+                return (*visit)(a, b);
+            } else {
+                (*visit)(a, b);
+                return true;
+            }
+        }
+    };
+
+    template <typename Context>
+    static constexpr bool kSkipsFlagged = requires(const Context& context) {
+        context.sink.IsFullyFlagged(NodeIdx{});
+    };
+
+    /**
+     * @brief Copies the built tree into traversal_nodes_; the alternatives are in the order of
+     * the variant, as T may be float itself
+     */
+    void BuildTraversalNodes() {
+        const bool rounded = options_.node_bounds == NodeBounds::kFloat;
+        const NodeOrder order = options_.node_order;
+        const IndexedTriangle<T>* base = triangles_.data();
+        std::vector<NodeIdx> sources;
+
+        switch (options_.branching_factor) {
+            case 4:
+                if (rounded) {
+                    traversal_nodes_.template emplace<3>(Keep(CollapseNodes<float, 4>(nodes_, root_, base, order, &sources)));
+                } else {
+                    traversal_nodes_.template emplace<2>(Keep(CollapseNodes<T, 4>(nodes_, root_, base, order, &sources)));
+                }
+                break;
+            case 8:
+                if (rounded) {
+                    traversal_nodes_.template emplace<5>(Keep(CollapseNodes<float, 8>(nodes_, root_, base, order, &sources)));
+                } else {
+                    traversal_nodes_.template emplace<4>(Keep(CollapseNodes<T, 8>(nodes_, root_, base, order, &sources)));
+                }
+                break;
+            default:
+                if (rounded) {
+                    traversal_nodes_.template emplace<1>(Keep(PackNodes<float>(nodes_, root_, base, order, &sources)));
+                } else {
+                    traversal_nodes_.template emplace<0>(Keep(PackNodes<T>(nodes_, root_, base, order, &sources)));
+                }
+                break;
+        }
+        sources_ = Keep(std::move(sources));
+    }
+
+    template <typename Sink>
+    TraversalStats Traverse(const QueryOptions& options, const Sink& sink) const {
+        return std::visit([&](const auto& nodes) { return Traverse(nodes, options, sink); }, traversal_nodes_);
+    }
+
+    template <typename B>
+    static constexpr NodeIdx RootIdx(std::span<PackedNode<B>>) noexcept {
+        return kPackedRootIdx;
+    }
+
+    template <typename B, size_t kWidth>
+    static constexpr NodeIdx RootIdx(std::span<WideNode<B, kWidth>>) noexcept {
+        return kWideRootIdx;
+    }
+
+    /**
+     * @brief Runs the whole query over nodes, serially or split into tasks, and reports the pairs
+     * to sink
+     * 
+     * @return work counters summed over all tasks
+     */
+    template <typename Nodes, typename Sink>
+    TraversalStats Traverse(const Nodes& nodes, const QueryOptions& options, const Sink& sink) const {
+        std::atomic<bool> stop{false};
+        QueryContext<Sink> initial_context{sink, {}, options.narrow_phase, &stop};
+        TraversalStats total;
+
+        if (options.execution == concurrency::Execution::kParallel) {
+            concurrency::ThreadPool& pool = concurrency::DefaultPool();
+            auto tasks = SplitIntoTasks(nodes, options.tasks_per_thread * (pool.GetNumberOfThreads() + 1), total);
+            std::vector<QueryContext<Sink>> contexts(tasks.size(), initial_context);
+
+            concurrency::TaskGroup group(pool);
+            for (size_t i = 0; i != tasks.size(); ++i) {
+                group.Run([&, i] { RunTask(nodes, tasks[i], contexts[i]); });
+            }
+            group.Wait();
+
+            for (const auto& context : contexts) {
+                total += context.stats;
+            }
+        } else {
+            RunTask(nodes, {RootIdx(nodes), RootIdx(nodes)}, initial_context);
+            total = initial_context.stats;
+        }
+
+        return total;
+    }
+
+    /**
+     * @brief Expands the top of the traversal breadth-first into independent tasks
+     * 
+     * A pair (idx, idx) stands for the self traversal of the subtree idx. Pairs with disjoint
+     * boxes are dropped, pairs of leaves are left to the tasks. Stops as soon as there are at least
+     * target_tasks pairs or nothing is left to expand.
+     */
+    template <typename B>
+    std::vector<NodePair> SplitIntoTasks(std::span<PackedNode<B>> nodes, size_t target_tasks,
+                                         TraversalStats& stats) const
+    {
+        std::vector<NodePair> frontier{{kPackedRootIdx, kPackedRootIdx}};
+
+        while (frontier.size() < target_tasks) {
+            std::vector<NodePair> next;
+            bool expanded = false;
+
+            for (auto [a_idx, b_idx] : frontier) {
+                const auto& a = nodes[a_idx];
+                const auto& b = nodes[b_idx];
+
+                if (a_idx == b_idx) {
+                    if (a.IsLeaf()) {
+                        next.emplace_back(a_idx, b_idx);
+                    } else {
+                        next.emplace_back(a.GetLeftIdx(), a.GetLeftIdx());
+                        next.emplace_back(a.GetRightIdx(), a.GetRightIdx());
+                        next.emplace_back(a.GetLeftIdx(), a.GetRightIdx());
+                        expanded = true;
                     }
+                    continue;
                 }
+
+                if (a.IsLeaf() && b.IsLeaf()) {
+                    next.emplace_back(a_idx, b_idx);
+                    continue;
+                }
+
+                ++stats.aabb_tests;
+                if (!PackedNode<B>::Overlap(a, b)) {
+                    continue;
+                }
+
+                ForEachChildPair(a_idx, a, b_idx, b, [&next](NodeIdx l, NodeIdx r) { next.emplace_back(l, r); });
+                expanded = true;
             }
 
-            return;
+            frontier.swap(next);
+            if (!expanded) {
+                break;
+            }
+        }
+
+        return frontier;
+    }
+
+    /**
+     * @brief SplitIntoTasks of a wide tree, whose pairs are pairs of slots
+     */
+    template <typename B, size_t kWidth>
+    std::vector<NodePair> SplitIntoTasks(std::span<WideNode<B, kWidth>> nodes, size_t target_tasks,
+                                         TraversalStats& stats) const
+    {
+        std::vector<NodePair> frontier{{kWideRootIdx, kWideRootIdx}};
+
+        while (frontier.size() < target_tasks) {
+            std::vector<NodePair> next;
+            bool expanded = false;
+
+            for (NodePair pair : frontier) {
+                if (!IsInnerSlot(nodes.data(), pair.a) && !IsInnerSlot(nodes.data(), pair.b)) {
+                    next.push_back(pair);
+                    continue;
+                }
+
+                stats.aabb_tests += ForEachWideChildPair(nodes.data(), pair, [&next](NodePair child, bool keep) {
+                    if (keep) {
+                        next.push_back(child);
+                    }
+                });
+                expanded = true;
+            }
+
+            frontier.swap(next);
+            if (!expanded) {
+                break;
+            }
         }
 
-        if (!a.IsLeaf() && !b.IsLeaf()) { 
-            RecursiveFindIntersections(a.GetLeftIdx(), b.GetLeftIdx());
-            RecursiveFindIntersections(a.GetLeftIdx(), b.GetRightIdx());
-            RecursiveFindIntersections(a.GetRightIdx(), b.GetLeftIdx());
-            RecursiveFindIntersections(a.GetRightIdx(), b.GetRightIdx());
-        } else if (!a.IsLeaf()) {
-            RecursiveFindIntersections(a.GetLeftIdx(), b_idx);
-            RecursiveFindIntersections(a.GetRightIdx(), b_idx);
+        return frontier;
+    }
+
+    template <typename B, typename Context>
+    void RunTask(std::span<PackedNode<B>> nodes, NodePair task, Context& context) const {
+        Query<PackedNode<B>, Context> query{this, nodes.data(), &context};
+        if (task.a == task.b) {
+            TraverseSelfPairs(task.a, query);
         } else {
-            RecursiveFindIntersections(a_idx, b.GetLeftIdx());
-            RecursiveFindIntersections(a_idx, b.GetRightIdx());
+            TraverseNodePairs(task, query);
+        }
+    }
+
+    template <typename B, size_t kWidth, typename Context>
+    void RunTask(std::span<WideNode<B, kWidth>> nodes, NodePair task, Context& context) const {
+        Query<WideNode<B, kWidth>, Context> query{this, nodes.data(), &context};
+        TraverseWidePairs(nodes.data(), task, query);
+    }
+
+    /**
+     * @brief Runs a cross query against other over the packed nodes of both trees if both have
+     * them, and over the built binary trees otherwise
+     */
+    template <typename Sink>
+    TraversalStats TraverseCross(const BVH& other, const QueryOptions& options, const Sink& sink) const {
+        return std::visit([&](const auto& a_nodes, const auto& b_nodes) {
+            using ANodes = std::decay_t<decltype(a_nodes)>;
+            using BNodes = std::decay_t<decltype(b_nodes)>;
+
+            if constexpr (kIsPackedNodes<ANodes> && kIsPackedNodes<BNodes>) {
+                return TraverseCross(a_nodes.data(), kPackedRootIdx, other, b_nodes.data(), kPackedRootIdx,
+                                     options, sink);
+            } else {
+                return TraverseCross(nodes_.data(), root_, other, other.nodes_.data(), other.root_, options, sink);
+            }
+        }, traversal_nodes_, other.traversal_nodes_);
+    }
+
+    /**
+     * @brief Traverse of a cross query; the tasks of parallel mode are the overlapping node pairs
+     * of the top levels of both trees
+     */
+    template <typename ANode, typename BNode, typename Sink>
+    TraversalStats TraverseCross(const ANode* a_nodes, NodeIdx a_root, const BVH& other, const BNode* b_nodes,
+                                 NodeIdx b_root, const QueryOptions& options, const Sink& sink) const
+    {
+        std::atomic<bool> stop{false};
+        QueryContext<Sink> initial_context{sink, {}, options.narrow_phase, &stop};
+        TraversalStats total;
+
+        auto run = [&](NodePair task, QueryContext<Sink>& context) {
+            CrossQuery<ANode, BNode, QueryContext<Sink>> query{this, &other, a_nodes, b_nodes, &context};
+            TraverseNodePairs(task, query);
+        };
+
+        if (options.execution == concurrency::Execution::kParallel) {
+            concurrency::ThreadPool& pool = concurrency::DefaultPool();
+            size_t target_tasks = options.tasks_per_thread * (pool.GetNumberOfThreads() + 1);
+
+            std::vector<NodePair> tasks{{a_root, b_root}};
+            while (tasks.size() < target_tasks) {
+                std::vector<NodePair> next;
+                bool expanded = false;
+
+                for (NodePair pair : tasks) {
+                    const auto& a = a_nodes[pair.a];
+                    const auto& b = b_nodes[pair.b];
+                    if (a.IsLeaf() && b.IsLeaf()) {
+                        next.push_back(pair);
+                        continue;
+                    }
+
+                    ++total.aabb_tests;
+                    if (!NodesOverlap(a, b)) {
+                        continue;
+                    }
+
+                    ForEachChildPair(pair.a, a, pair.b, b, [&next](NodeIdx l, NodeIdx r) { next.emplace_back(l, r); });
+                    expanded = true;
+                }
+
+                tasks.swap(next);
+                if (!expanded) {
+                    break;
+                }
+            }
+
+            std::vector<QueryContext<Sink>> contexts(tasks.size(), initial_context);
+
+            concurrency::TaskGroup group(pool);
+            for (size_t i = 0; i != tasks.size(); ++i) {
+                group.Run([&, i] { run(tasks[i], contexts[i]); });
+            }
+            group.Wait();
+
+            for (const auto& context : contexts) {
+                total += context.stats;
+            }
+        } else {
+            run({a_root, b_root}, initial_context);
+            total = initial_context.stats;
+        }
+
+        return total;
+    }
+
+    /**
+     * @brief Box test of two packed nodes, which may have bounds of different types; both boxes
+     * are inflated, so they are compared as they are
+     */
+    template <typename A, typename B>
+    static bool NodesOverlap(const PackedNode<A>& a, const PackedNode<B>& b) noexcept {
+        const auto& a_box = a.GetAABB();
+        const auto& b_box = b.GetAABB();
+        return (a_box.min.x <= b_box.max.x) & (a_box.max.x >= b_box.min.x)
+             & (a_box.min.y <= b_box.max.y) & (a_box.max.y >= b_box.min.y)
+             & (a_box.min.z <= b_box.max.z) & (a_box.max.z >= b_box.min.z);
+    }
+
+    static bool NodesOverlap(const BVHNode<T>& a, const BVHNode<T>& b) noexcept {
+        return AABB<T>::Intersects(a.GetAABB(), b.GetAABB());
+    }
+
+    /**
+     * @brief Fills the parent of every node, the leaf of every triangle position and the number
+     * of triangles of every subtree
+     * 
+     * Every node order puts the children after their parent, so the nodes are visited backwards.
+     */
+    template <typename B>
+    void LinkNodes(std::span<PackedNode<B>> nodes) {
+        parents_ = Keep(std::vector<NodeIdx>(nodes.size(), invalid_idx));
+        leaf_of_ = Keep(std::vector<NodeIdx>(triangles_.size(), invalid_idx));
+        subtree_sizes_ = Keep(std::vector<uint32_t>(nodes.size(), 0));
+
+        for (size_t idx = nodes.size(); idx-- != 0;) {
+            const auto& node = nodes[idx];
+
+            if (node.IsLeaf()) {
+                auto [first, last] = LeafRange(nodes.data(), idx);
+                std::fill(leaf_of_.begin() + first, leaf_of_.begin() + last, static_cast<NodeIdx>(idx));
+                subtree_sizes_[idx] = last - first;
+            } else {
+                parents_[node.GetLeftIdx()] = static_cast<NodeIdx>(idx);
+                parents_[node.GetRightIdx()] = static_cast<NodeIdx>(idx);
+                subtree_sizes_[idx] = subtree_sizes_[node.GetLeftIdx()] + subtree_sizes_[node.GetRightIdx()];
+            }
+        }
+    }
+
+    /**
+     * @brief LinkNodes of a wide tree, for every slot
+     * 
+     * Wide nodes always come after the node holding their slot, so they are visited backwards.
+     */
+    template <typename B, size_t kWidth>
+    void LinkNodes(std::span<WideNode<B, kWidth>> nodes) {
+        parents_ = Keep(std::vector<NodeIdx>(nodes.size() * kWidth, invalid_idx));
+        leaf_of_ = Keep(std::vector<NodeIdx>(triangles_.size(), invalid_idx));
+        subtree_sizes_ = Keep(std::vector<uint32_t>(nodes.size() * kWidth, 0));
+
+        for (size_t slot = nodes.size() * kWidth; slot-- != 0;) {
+            const auto& node = nodes[slot / kWidth];
+            const size_t lane = slot % kWidth;
+
+            if (!node.IsInner(lane)) {
+                auto [first, last] = LeafRange(nodes.data(), slot);
+                std::fill(leaf_of_.begin() + first, leaf_of_.begin() + last, static_cast<NodeIdx>(slot));
+                subtree_sizes_[slot] = last - first;
+                continue;
+            }
+
+            for (size_t child = node.child[lane] * kWidth, end = child + kWidth; child != end; ++child) {
+                parents_[child] = static_cast<NodeIdx>(slot);
+                subtree_sizes_[slot] += subtree_sizes_[child];
+            }
         }
     }
+
+    /**
+     * @brief Positions [first, last) of the leaf triangles in triangles_, soa_ and prepared_
+     */
+    template <typename B>
+    static std::pair<size_t, size_t> LeafRange(const PackedNode<B>* nodes, NodeIdx idx) noexcept {
+        const auto& leaf = nodes[idx];
+        return {leaf.GetFirstTriangle(), leaf.GetFirstTriangle() + leaf.GetNumberOfTriangles()};
+    }
+
+    template <typename B, size_t kWidth>
+    static std::pair<size_t, size_t> LeafRange(const WideNode<B, kWidth>* nodes, NodeIdx slot) noexcept {
+        const auto& node = SlotNode(nodes, slot);
+        const size_t lane = SlotLane<kWidth>(slot);
+        return {node.child[lane], node.child[lane] + node.count[lane]};
+    }
+
+    std::pair<size_t, size_t> LeafRange(const BVHNode<T>* nodes, NodeIdx idx) const noexcept {
+        auto triangles = nodes[idx].GetTriangles();
+        size_t first = static_cast<size_t>(triangles.data() - triangles_.data());
+        return {first, first + triangles.size()};
+    }
+
+    /**
+     * @brief Tests every triangle of [a_first, a_last) against the batch [b_first, b_last) of
+     * b_tree, which is this tree except in cross queries
+     * 
+     * For a self test of one leaf (b_first == a_first in this tree) each triangle is only tested
+     * against the ones after it. The batch is first filtered by the SAT kernel on the SoA copy, and only the
+     * remaining candidates go through the exact test of the selected engine on the prepared
+     * triangles.
+     */
+    template <typename Context>
+    void IntersectRanges(const BVH& b_tree, size_t a_first, size_t a_last, size_t b_first, size_t b_last,
+                         Context& context) const
+    {
+        bool self = &b_tree == this && a_first == b_first;
+        std::array<uint8_t, kMaxLeafSize> candidates;
+
+        for (size_t i = a_first; i != a_last && !context.Stopped(); ++i) {
+            size_t first = self ? i + 1 : b_first;
+            if (first >= b_last) {
+                continue;
+            }
+
+            context.stats.triangle_pairs += b_last - first;
+            if (SelectCandidates(soa_, i, b_tree.soa_, first, b_last, candidates.data()) == 0) {
+                continue;
+            }
+
+            for (size_t j = first; j != b_last; ++j) {
+                if (!candidates[j - first]) {
+                    continue;
+                }
+
+                if constexpr (kSkipsFlagged<Context>) {
+                    if (context.sink.IsFlagged(i) && context.sink.IsFlagged(j)) {
+                        ++context.stats.skipped_narrow_phase_tests;
+                        continue;
+                    }
+                }
+
+                ++context.stats.narrow_phase_tests;
+                bool intersect = (context.narrow_phase == NarrowPhase::kMoller)
+                    ? PreparedTriangle<T>::IntersectMoller(prepared_[i], b_tree.prepared_[j])
+                    : PreparedTriangle<T>::Intersect(prepared_[i], b_tree.prepared_[j]);
+                if (intersect) {
+                    context.Report(i, j);
+                    if (context.Stopped()) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Adapter of the tree and one task context to TraverseNodePairs, TraverseSelfPairs and
+     * TraverseWidePairs
+     * 
+     * Node is the packed or wide node type of traversal_nodes_, and the indices are positions of
+     * packed nodes or slots of wide ones. Fully flagged subtrees are pruned when the sink tracks
+     * them. The leaf tests stay out of line, which keeps the traversal loop small.
+     */
+    template <typename Node, typename Context>
+    struct Query {
+        const BVH* tree;
+        const Node* nodes;
+        Context* context;
+
+        const Node& NodeA(NodeIdx idx) const noexcept {
+            return nodes[idx];
+        }
+
+        const Node& NodeB(NodeIdx idx) const noexcept {
+            return nodes[idx];
+        }
+
+        bool Stopped() const noexcept {
+            return context->Stopped();
+        }
+
+        bool Prune(NodeIdx a, NodeIdx b) const noexcept {
+            if constexpr (kSkipsFlagged<Context>) {
+                if (context->sink.IsFullyFlagged(a) && context->sink.IsFullyFlagged(b)) {
+                    ++context->stats.pruned_node_pairs;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool Overlap(NodeIdx a, NodeIdx b) const noexcept {
+            ++context->stats.aabb_tests;
+            return Node::Overlap(nodes[a], nodes[b]);
+        }
+
+        void CountBoxTests(size_t count) const noexcept {
+            context->stats.aabb_tests += count;
+        }
+
+        [[gnu::noinline]] void IntersectLeaves(NodeIdx a, NodeIdx b) const {
+            auto [a_first, a_last] = LeafRange(nodes, a);
+            auto [b_first, b_last] = LeafRange(nodes, b);
+            tree->IntersectRanges(*tree, a_first, a_last, b_first, b_last, *context);
+        }
+    };
+
+    /**
+     * @brief Adapter of two trees and one task context to TraverseNodePairs, for cross queries
+     * 
+     * ANode and BNode are the packed node types of the two trees or both BVHNode<T>.
+     */
+    template <typename ANode, typename BNode, typename Context>
+    struct CrossQuery {
+        const BVH* tree;
+        const BVH* other;
+        const ANode* a_nodes;
+        const BNode* b_nodes;
+        Context* context;
+
+        const ANode& NodeA(NodeIdx idx) const noexcept {
+            return a_nodes[idx];
+        }
+
+        const BNode& NodeB(NodeIdx idx) const noexcept {
+            return b_nodes[idx];
+        }
+
+        bool Stopped() const noexcept {
+            return context->Stopped();
+        }
+
+        bool Prune(NodeIdx, NodeIdx) const noexcept {
+            return false;
+        }
+
+        bool Overlap(NodeIdx a, NodeIdx b) const noexcept {
+            ++context->stats.aabb_tests;
+            return NodesOverlap(a_nodes[a], b_nodes[b]);
+        }
+
+        [[gnu::noinline]] void IntersectLeaves(NodeIdx a, NodeIdx b) const {
+            auto [a_first, a_last] = tree->LeafRange(a_nodes, a);
+            auto [b_first, b_last] = other->LeafRange(b_nodes, b);
+            tree->IntersectRanges(*other, a_first, a_last, b_first, b_last, *context);
+        }
+    };
 };
 
 } // namespace acceleration
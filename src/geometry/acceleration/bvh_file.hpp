@@ -0,0 +1,89 @@
+#pragma once
+
+#include <bit>
+#include <array>
+#include <cstdint>
+
+#include "aabb.hpp"
+#include "node.hpp"
+
+namespace geometry {
+
+namespace acceleration {
+
+/**
+ * Saved BVH format, host byte order (little-endian only), read by BVH::Map without copying:
+ *
+ *   BvhFileHeader, then the sections it lists, each starting at a multiple of kBvhFileAlignment
+ *
+ * A section is the flat array of one member of the tree, element by element as in memory, so the
+ * file is only readable by a build with the same scalar type and element layouts; the element
+ * size of every section is checked on load.
+ */
+inline constexpr std::array<char, 8> kBvhFileMagic {'T', 'R', 'I', '3', 'D', 'B', 'V', 'H'};
+inline constexpr uint32_t kBvhFileVersion = 1;
+inline constexpr uint64_t kBvhFileAlignment = 64;
+
+enum class BvhSection : uint32_t {
+    kNodes,
+    kTriangles,
+    kTraversalNodes,
+    kSoaValues,
+    kSoaIds,
+    kSoaDegenerate,
+    kPrepared,
+    kPositions,
+    kSources,
+    kParents,
+    kLeafOf,
+    kSubtreeSizes,
+    kNumberOfSections,
+};
+
+struct BvhSectionEntry {
+    uint64_t offset;
+    uint64_t count;
+    uint64_t element_size;
+};
+
+struct BvhFileHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t scalar_size;
+    uint32_t scalar_is_floating;
+
+    // BuildOptions the tree was built with
+    uint32_t split_method;
+    uint32_t sah_bins;
+    uint32_t max_leaf_size;
+    uint32_t node_bounds;
+    uint32_t branching_factor;
+    uint32_t node_order;
+
+    // index of the traversal node type in the variant of the tree
+    uint32_t traversal_layout;
+    int64_t root;
+    uint64_t id_capacity;
+    double soa_scale;
+    double built_sah_cost;
+
+    std::array<BvhSectionEntry, static_cast<size_t>(BvhSection::kNumberOfSections)> sections;
+};
+
+static_assert(std::endian::native == std::endian::little, "The saved BVH format is defined as little-endian");
+
+/**
+ * @brief BVHNode with the span of its triangles replaced by their positions in the triangle section
+ */
+template <typename T>
+struct BvhFileNode {
+    AABB<T> aabb;
+    NodeIdx left;
+    NodeIdx right;
+    uint64_t first;
+    uint64_t count;
+};
+
+} // namespace acceleration
+
+} // namespace geometry
@@ -0,0 +1,522 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+#include "node.hpp"
+#include "query_options.hpp"
+#include "pair_traversal.hpp"
+#include "prepared_triangle.hpp"
+#include "intersection_result.hpp"
+
+namespace geometry {
+
+namespace acceleration {
+
+/**
+ * @brief Node of a DynamicBVH; a leaf holds exactly one triangle
+ *
+ * Has the accessors of BVHNode that TraverseNodePairs and TraverseSelfPairs use.
+ */
+template <typename T>
+requires concepts::Numeric<T>
+struct DynamicNode {
+    AABB<T> aabb;
+    NodeIdx parent = invalid_idx;
+    NodeIdx left = invalid_idx;
+    NodeIdx right = invalid_idx;
+    TrIndex id = 0;
+    // levels below the node, 0 for a leaf
+    uint32_t height = 0;
+
+    const AABB<T>& GetAABB() const noexcept {
+        return aabb;
+    }
+
+    bool IsLeaf() const noexcept {
+        return left == invalid_idx;
+    }
+
+    NodeIdx GetLeftIdx() const noexcept {
+        return left;
+    }
+
+    NodeIdx GetRightIdx() const noexcept {
+        return right;
+    }
+};
+
+/**
+ * @brief Incremental AABB tree over triangles that may be inserted, removed and moved one by one
+ *
+ * A triangle is inserted next to the node where it adds the least surface area, found by a
+ * branch-and-bound descent from the root, and every ancestor is then refit and may rotate a child
+ * with a grandchild where that shrinks the tree, so the quality stays close to a built tree
+ * without any global rebuild. All edits take O(log n) for a balanced tree.
+ *
+ * Inserted and moved triangles are remembered as touched until ForEachTouchedPair, which tests
+ * only them against the tree: k edits between two queries cost O(k log n) plus the reported pairs.
+ */
+template <typename T>
+requires concepts::Numeric<T>
+class DynamicBVH {
+public:
+    DynamicBVH() = default;
+
+    explicit DynamicBVH(const std::vector<IndexedTriangle<T>>& triangles) {
+        for (const auto& tr : triangles) {
+            Insert(tr.id, tr.triangle);
+        }
+    }
+
+    /**
+     * @throws std::invalid_argument if the tree has a triangle with this id already
+     */
+    void Insert(TrIndex id, const Triangle<T>& triangle) {
+        if (Contains(id)) {
+            throw std::invalid_argument("DynamicBVH: the id is in the tree already");
+        }
+
+        if (id >= leaves_.size()) {
+            leaves_.resize(id + 1, invalid_idx);
+            prepared_.resize(id + 1);
+            touched_flags_.resize(id + 1, 0);
+        }
+
+        NodeIdx leaf = Allocate();
+        nodes_[leaf].aabb = AABB<T>{triangle};
+        nodes_[leaf].id = id;
+        leaves_[id] = leaf;
+        prepared_[id].emplace(triangle);
+
+        InsertLeaf(leaf);
+        Touch(id);
+        ++size_;
+    }
+
+    /**
+     * @throws std::invalid_argument if the tree has no triangle with this id
+     */
+    void Remove(TrIndex id) {
+        NodeIdx leaf = LeafOf(id);
+
+        RemoveLeaf(leaf);
+        free_.push_back(leaf);
+        leaves_[id] = invalid_idx;
+        prepared_[id].reset();
+        touched_flags_[id] = 0;
+        --size_;
+    }
+
+    /**
+     * @brief Moves the triangle with this id, reinserting its leaf
+     *
+     * @throws std::invalid_argument if the tree has no triangle with this id
+     */
+    void Update(TrIndex id, const Triangle<T>& triangle) {
+        NodeIdx leaf = LeafOf(id);
+
+        RemoveLeaf(leaf);
+        nodes_[leaf].aabb = AABB<T>{triangle};
+        prepared_[id].emplace(triangle);
+        InsertLeaf(leaf);
+        Touch(id);
+    }
+
+    bool Contains(TrIndex id) const noexcept {
+        return id < leaves_.size() && leaves_[id] != invalid_idx;
+    }
+
+    size_t Size() const noexcept {
+        return size_;
+    }
+
+    /**
+     * @brief Levels of the tree below the root, 0 for an empty tree or a single triangle
+     */
+    size_t GetHeight() const noexcept {
+        return (root_ == invalid_idx) ? 0 : nodes_[root_].height;
+    }
+
+    /**
+     * @brief Surface area heuristic cost, comparable with BVH::GetSahCost for leaves of one
+     * triangle
+     */
+    double GetSahCost() const {
+        if (root_ == invalid_idx) {
+            return 0;
+        }
+
+        double root_area = nodes_[root_].aabb.SurfaceArea();
+        if (root_area <= 0) {
+            root_area = 1;
+        }
+
+        double cost = 0;
+        std::vector<NodeIdx> stack{root_};
+        while (!stack.empty()) {
+            const auto& node = nodes_[stack.back()];
+            stack.pop_back();
+
+            cost += node.aabb.SurfaceArea() / root_area;
+            if (!node.IsLeaf()) {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+            }
+        }
+
+        return cost;
+    }
+
+    /**
+     * @brief Calls visit(i, j) with i < j for every pair of intersecting triangle ids in the tree
+     *
+     * @param visit Callable with the signature void(TrIndex, TrIndex) or bool(TrIndex, TrIndex);
+     * returning false stops the traversal
+     * @param stats If not null, receives the work counters of the traversal
+     */
+    template <typename Visitor>
+    void ForEachIntersectingPair(Visitor&& visit, TraversalStats* stats = nullptr) const {
+        Query<std::remove_reference_t<Visitor>> query{this, &visit};
+        if (root_ != invalid_idx) {
+            TraverseSelfPairs(root_, query);
+        }
+
+        if (stats) {
+            *stats = query.stats;
+        }
+    }
+
+    /**
+     * @brief Calls visit(i, j) with i < j for every intersecting pair of which at least one
+     * triangle was inserted or moved since the last call, then forgets the touched triangles
+     *
+     * Every touched triangle is traversed against the whole tree on its own, each pair of two
+     * touched triangles is reported once. The touched triangles are forgotten even if visit
+     * stops the query.
+     */
+    template <typename Visitor>
+    void ForEachTouchedPair(Visitor&& visit, TraversalStats* stats = nullptr) {
+        // a triangle removed and inserted again may be listed twice
+        std::erase_if(touched_, [this](TrIndex id) { return !touched_flags_[id]; });
+        std::sort(touched_.begin(), touched_.end());
+        touched_.erase(std::unique(touched_.begin(), touched_.end()), touched_.end());
+
+        Query<std::remove_reference_t<Visitor>> query{this, &visit, true};
+        for (TrIndex id : touched_) {
+            if (query.Stopped()) {
+                break;
+            }
+            TraverseNodePairs({root_, leaves_[id]}, query);
+        }
+
+        for (TrIndex id : touched_) {
+            touched_flags_[id] = 0;
+        }
+        touched_.clear();
+
+        if (stats) {
+            *stats = query.stats;
+        }
+    }
+
+    /**
+     * @brief Ids of all triangles that intersect at least one other triangle
+     */
+    IntersectionResult FindIntersectingTriangles(TraversalStats* stats = nullptr) const {
+        IntersectionResult result(leaves_.size());
+        ForEachIntersectingPair([&result](TrIndex a, TrIndex b) {
+            result.Insert(a);
+            result.Insert(b);
+        }, stats);
+        return result;
+    }
+
+    const DynamicNode<T>* GetRoot() const noexcept {
+        return (root_ == invalid_idx) ? nullptr : &nodes_[root_];
+    }
+
+    const DynamicNode<T>* GetNode(NodeIdx idx) const noexcept {
+        return &nodes_[idx];
+    }
+
+private:
+    NodeIdx root_ = invalid_idx;
+    std::vector<DynamicNode<T>> nodes_;
+    std::vector<NodeIdx> free_;
+    size_t size_ = 0;
+
+    // indexed by id
+    std::vector<NodeIdx> leaves_;
+    std::vector<std::optional<PreparedTriangle<T>>> prepared_;
+    std::vector<uint8_t> touched_flags_;
+
+    std::vector<TrIndex> touched_;
+
+    NodeIdx LeafOf(TrIndex id) const {
+        if (!Contains(id)) {
+            throw std::invalid_argument("DynamicBVH: no triangle with this id");
+        }
+        return leaves_[id];
+    }
+
+    void Touch(TrIndex id) {
+        if (!touched_flags_[id]) {
+            touched_flags_[id] = 1;
+            touched_.push_back(id);
+        }
+    }
+
+    NodeIdx Allocate() {
+        if (!free_.empty()) {
+            NodeIdx idx = free_.back();
+            free_.pop_back();
+            nodes_[idx] = DynamicNode<T>{};
+            return idx;
+        }
+
+        nodes_.emplace_back();
+        return static_cast<NodeIdx>(nodes_.size() - 1);
+    }
+
+    static AABB<T> Union(const AABB<T>& a, const AABB<T>& b) {
+        AABB<T> aabb = a;
+        aabb.Expand(b);
+        return aabb;
+    }
+
+    /**
+     * @brief The node the new box should become the sibling of
+     *
+     * Best-first search over the cost of making each node the sibling: the area of the new parent
+     * plus the area every ancestor grows by. A subtree is skipped once even the growth of its
+     * root's ancestors alone reaches the best cost found.
+     */
+    NodeIdx FindBestSibling(const AABB<T>& box) const {
+        const double box_area = box.SurfaceArea();
+
+        NodeIdx best = root_;
+        double best_cost = Union(nodes_[root_].aabb, box).SurfaceArea();
+
+        // node and the growth of the areas of its ancestors
+        std::vector<std::pair<NodeIdx, double>> stack{{root_, 0.0}};
+        while (!stack.empty()) {
+            auto [idx, inherited] = stack.back();
+            stack.pop_back();
+
+            const auto& node = nodes_[idx];
+            double combined = Union(node.aabb, box).SurfaceArea();
+            double cost = combined + inherited;
+            if (cost < best_cost) {
+                best_cost = cost;
+                best = idx;
+            }
+
+            if (node.IsLeaf()) {
+                continue;
+            }
+
+            double child_inherited = inherited + combined - node.aabb.SurfaceArea();
+            if (child_inherited + box_area < best_cost) {
+                stack.emplace_back(node.left, child_inherited);
+                stack.emplace_back(node.right, child_inherited);
+            }
+        }
+
+        return best;
+    }
+
+    void InsertLeaf(NodeIdx leaf) {
+        nodes_[leaf].parent = invalid_idx;
+        if (root_ == invalid_idx) {
+            root_ = leaf;
+            return;
+        }
+
+        NodeIdx sibling = FindBestSibling(nodes_[leaf].aabb);
+        NodeIdx old_parent = nodes_[sibling].parent;
+
+        NodeIdx parent = Allocate();
+        nodes_[parent].parent = old_parent;
+        nodes_[parent].left = sibling;
+        nodes_[parent].right = leaf;
+        nodes_[sibling].parent = parent;
+        nodes_[leaf].parent = parent;
+
+        if (old_parent == invalid_idx) {
+            root_ = parent;
+        } else if (nodes_[old_parent].left == sibling) {
+            nodes_[old_parent].left = parent;
+        } else {
+            nodes_[old_parent].right = parent;
+        }
+
+        RefitUpwards(parent);
+    }
+
+    void RemoveLeaf(NodeIdx leaf) {
+        NodeIdx parent = nodes_[leaf].parent;
+        if (parent == invalid_idx) {
+            root_ = invalid_idx;
+            return;
+        }
+
+        NodeIdx sibling = (nodes_[parent].left == leaf) ? nodes_[parent].right : nodes_[parent].left;
+        NodeIdx grandparent = nodes_[parent].parent;
+        nodes_[sibling].parent = grandparent;
+        free_.push_back(parent);
+
+        if (grandparent == invalid_idx) {
+            root_ = sibling;
+            return;
+        }
+
+        if (nodes_[grandparent].left == parent) {
+            nodes_[grandparent].left = sibling;
+        } else {
+            nodes_[grandparent].right = sibling;
+        }
+        RefitUpwards(grandparent);
+    }
+
+    void Refit(NodeIdx idx) {
+        auto& node = nodes_[idx];
+        node.aabb = Union(nodes_[node.left].aabb, nodes_[node.right].aabb);
+        node.height = 1 + std::max(nodes_[node.left].height, nodes_[node.right].height);
+    }
+
+    void RefitUpwards(NodeIdx idx) {
+        for (; idx != invalid_idx; idx = nodes_[idx].parent) {
+            Refit(idx);
+            Rotate(idx);
+        }
+    }
+
+    /**
+     * @brief Swaps a child of idx with a grandchild on the other side if that shrinks the child
+     * that gets new children
+     *
+     * Of the four swaps the one giving the smallest new box is taken. The box of idx stays the
+     * same, so the ancestors are not affected beyond their heights.
+     */
+    void Rotate(NodeIdx idx) {
+        const NodeIdx b = nodes_[idx].left;
+        const NodeIdx c = nodes_[idx].right;
+
+        // the child swapped up, the grandchild swapped down with it, and the area gained
+        NodeIdx best_up = invalid_idx;
+        NodeIdx best_down = invalid_idx;
+        double best_gain = 0;
+
+        auto consider = [&](NodeIdx up, NodeIdx inner) {
+            if (nodes_[inner].IsLeaf()) {
+                return;
+            }
+
+            double area = nodes_[inner].aabb.SurfaceArea();
+            const NodeIdx f = nodes_[inner].left;
+            const NodeIdx g = nodes_[inner].right;
+
+            // swapping up with f leaves inner with (up, g), and with g, (f, up)
+            double gain_f = area - Union(nodes_[up].aabb, nodes_[g].aabb).SurfaceArea();
+            double gain_g = area - Union(nodes_[f].aabb, nodes_[up].aabb).SurfaceArea();
+            if (gain_f > best_gain) {
+                best_gain = gain_f;
+                best_up = up;
+                best_down = f;
+            }
+            if (gain_g > best_gain) {
+                best_gain = gain_g;
+                best_up = up;
+                best_down = g;
+            }
+        };
+
+        consider(b, c);
+        consider(c, b);
+
+        if (best_up == invalid_idx) {
+            return;
+        }
+
+        NodeIdx inner = nodes_[best_down].parent;
+        auto& up_slot = (nodes_[idx].left == best_up) ? nodes_[idx].left : nodes_[idx].right;
+        auto& down_slot = (nodes_[inner].left == best_down) ? nodes_[inner].left : nodes_[inner].right;
+
+        up_slot = best_down;
+        down_slot = best_up;
+        nodes_[best_down].parent = idx;
+        nodes_[best_up].parent = inner;
+
+        Refit(inner);
+        Refit(idx);
+    }
+
+    /**
+     * @brief Adapter of the tree to TraverseNodePairs and TraverseSelfPairs
+     *
+     * With touched_only, a pair of two touched triangles is only tested from the one with the
+     * smaller id, the other one being b of the traversal.
+     */
+    template <typename Visitor>
+    struct Query {
+        const DynamicBVH* tree = nullptr;
+        Visitor* visit = nullptr;
+        bool touched_only = false;
+        bool stop = false;
+        TraversalStats stats{};
+
+        const DynamicNode<T>& NodeA(NodeIdx idx) const noexcept {
+            return tree->nodes_[idx];
+        }
+
+        const DynamicNode<T>& NodeB(NodeIdx idx) const noexcept {
+            return tree->nodes_[idx];
+        }
+
+        bool Stopped() const noexcept {
+            return stop;
+        }
+
+        bool Prune(NodeIdx, NodeIdx) const noexcept {
+            return false;
+        }
+
+        bool Overlap(NodeIdx a, NodeIdx b) noexcept {
+            ++stats.aabb_tests;
+            return AABB<T>::Intersects(tree->nodes_[a].aabb, tree->nodes_[b].aabb);
+        }
+
+        void IntersectLeaves(NodeIdx a, NodeIdx b) {
+            if (a == b) {
+                return;
+            }
+
+            TrIndex i = tree->nodes_[a].id;
+            TrIndex j = tree->nodes_[b].id;
+            if (touched_only && tree->touched_flags_[i] && i < j) {
+                return;
+            }
+
+            ++stats.triangle_pairs;
+            ++stats.narrow_phase_tests;
+            if (!PreparedTriangle<T>::Intersect(*tree->prepared_[i], *tree->prepared_[j])) {
+                return;
+            }
+
+            if constexpr (std::is_same_v<std::invoke_result_t<Visitor&, TrIndex, TrIndex>, bool>) {
+                stop = !(*visit)(std::min(i, j), std::max(i, j));
+            } else {
+                (*visit)(std::min(i, j), std::max(i, j));
+            }
+        }
+    };
+};
+
+} // namespace acceleration
+
+} // namespace geometry
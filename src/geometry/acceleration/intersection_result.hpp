@@ -0,0 +1,167 @@
+#pragma once
+
+#include <bit>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+
+#include "indexed_triangle.hpp"
+
+namespace geometry {
+
+namespace acceleration {
+
+/**
+ * @brief Set of triangle ids stored as a dense bitmap indexed by id
+ *
+ * Inserting is a single bit-or, and AtomicInsert lets several threads fill one result at once.
+ * Iteration scans the bitmap, so ids always come out sorted.
+ */
+class IntersectionResult {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TrIndex;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const TrIndex*;
+        using reference = TrIndex;
+
+        Iterator() = default;
+
+        Iterator(const std::vector<uint64_t>* words, size_t word_idx) : words_(words), word_idx_(word_idx) {
+            if (word_idx_ != words_->size()) {
+                bits_ = (*words_)[word_idx_];
+                SkipEmptyWords();
+            }
+        }
+
+        TrIndex operator*() const noexcept {
+            return word_idx_ * kBitsPerWord + std::countr_zero(bits_);
+        }
+
+        Iterator& operator++() noexcept {
+            bits_ &= bits_ - 1;
+            SkipEmptyWords();
+            return *this;
+        }
+
+        Iterator operator++(int) noexcept {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const Iterator& other) const noexcept {
+            return word_idx_ == other.word_idx_ && bits_ == other.bits_;
+        }
+
+    private:
+        const std::vector<uint64_t>* words_ = nullptr;
+        size_t word_idx_ = 0;
+        uint64_t bits_ = 0;
+
+        void SkipEmptyWords() noexcept {
+            while (bits_ == 0 && ++word_idx_ != words_->size()) {
+                bits_ = (*words_)[word_idx_];
+            }
+        }
+    };
+
+    using value_type = TrIndex;
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+
+    IntersectionResult() = default;
+
+    /**
+     * @param capacity Ids of the result are in [0, capacity)
+     */
+    explicit IntersectionResult(size_t capacity) : words_((capacity + kBitsPerWord - 1) / kBitsPerWord, 0) {}
+
+    /**
+     * @return true if id was not in the result yet
+     */
+    bool Insert(TrIndex id) noexcept {
+        uint64_t& word = words_[id / kBitsPerWord];
+        bool inserted = !(word & Bit(id));
+        word |= Bit(id);
+        return inserted;
+    }
+
+    /**
+     * @brief Insert that may run concurrently with other AtomicInsert calls on the same result
+     *
+     * @return true if id was not in the result yet
+     */
+    bool AtomicInsert(TrIndex id) noexcept {
+        std::atomic_ref<uint64_t> word(words_[id / kBitsPerWord]);
+        return !(word.fetch_or(Bit(id), std::memory_order_relaxed) & Bit(id));
+    }
+
+    bool Contains(TrIndex id) const noexcept {
+        return id / kBitsPerWord < words_.size() && (words_[id / kBitsPerWord] & Bit(id));
+    }
+
+    /**
+     * @brief Contains that may run concurrently with AtomicInsert calls on the same result
+     */
+    bool AtomicContains(TrIndex id) const noexcept {
+        if (id / kBitsPerWord >= words_.size()) {
+            return false;
+        }
+
+        std::atomic_ref<const uint64_t> word(words_[id / kBitsPerWord]);
+        return word.load(std::memory_order_relaxed) & Bit(id);
+    }
+
+    size_t size() const noexcept {
+        size_t count = 0;
+        for (uint64_t word : words_) {
+            count += std::popcount(word);
+        }
+        return count;
+    }
+
+    bool empty() const noexcept {
+        return begin() == end();
+    }
+
+    Iterator begin() const {
+        return Iterator(&words_, 0);
+    }
+
+    Iterator end() const {
+        return Iterator(&words_, words_.size());
+    }
+
+    /**
+     * @brief Sorted ids of the result
+     */
+    std::vector<TrIndex> ToVector() const {
+        std::vector<TrIndex> ids;
+        ids.reserve(size());
+        ids.assign(begin(), end());
+        return ids;
+    }
+
+    bool operator==(const IntersectionResult& other) const {
+        return std::equal(begin(), end(), other.begin(), other.end());
+    }
+
+private:
+    static constexpr size_t kBitsPerWord = 64;
+
+    std::vector<uint64_t> words_;
+
+    static uint64_t Bit(TrIndex id) noexcept {
+        return uint64_t{1} << (id % kBitsPerWord);
+    }
+};
+
+} // namespace acceleration
+
+} // namespace geometry
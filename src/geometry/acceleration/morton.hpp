@@ -0,0 +1,151 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+#include "aabb.hpp"
+#include "point.hpp"
+#include "thread_pool.hpp"
+
+namespace geometry {
+
+namespace acceleration {
+
+/**
+ * @brief Morton code of a point of T: 30 bits, 10 per axis, for types of up to 32 bits, whose
+ * precision is no finer, and 63 bits, 21 per axis, otherwise
+ */
+template <typename T>
+using MortonCode = std::conditional_t<(sizeof(T) <= 4), uint32_t, uint64_t>;
+
+template <typename Code>
+inline constexpr unsigned kMortonBitsPerAxis = (sizeof(Code) == 4) ? 10 : 21;
+
+/**
+ * @brief Spreads the low kMortonBitsPerAxis bits of x so that two zero bits follow every bit
+ */
+template <typename Code>
+constexpr Code SpreadMortonBits(Code x) noexcept {
+    if constexpr (sizeof(Code) == 4) {
+        x &= 0x3ffu;
+        x = (x | (x << 16)) & 0x030000ffu;
+        x = (x | (x << 8))  & 0x0300f00fu;
+        x = (x | (x << 4))  & 0x030c30c3u;
+        x = (x | (x << 2))  & 0x09249249u;
+    } else {
+        x &= 0x1fffffu;
+        x = (x | (x << 32)) & 0x001f00000000ffffull;
+        x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+        x = (x | (x << 8))  & 0x100f00f00f00f00full;
+        x = (x | (x << 4))  & 0x10c30c30c30c30c3ull;
+        x = (x | (x << 2))  & 0x1249249249249249ull;
+    }
+    return x;
+}
+
+/**
+ * @brief Morton code of point on the grid of 2^kMortonBitsPerAxis cells per axis over bounds,
+ * x taking the highest bit of every triple
+ */
+template <typename T>
+MortonCode<T> EncodeMorton(const Point<T>& point, const AABB<T>& bounds) noexcept {
+    using Code = MortonCode<T>;
+    constexpr double kCells = static_cast<double>(Code{1} << kMortonBitsPerAxis<Code>);
+
+    auto cell = [&](T value, T min, T max) -> Code {
+        double extent = static_cast<double>(max) - static_cast<double>(min);
+        if (!(extent > 0)) {
+            return 0;
+        }
+        double scaled = (static_cast<double>(value) - static_cast<double>(min)) / extent * kCells;
+        return static_cast<Code>(std::clamp(scaled, 0.0, kCells - 1));
+    };
+
+    return (SpreadMortonBits(cell(point.x, bounds.min.x, bounds.max.x)) << 2)
+         | (SpreadMortonBits(cell(point.y, bounds.min.y, bounds.max.y)) << 1)
+         |  SpreadMortonBits(cell(point.z, bounds.min.z, bounds.max.z));
+}
+
+/**
+ * @brief Stable LSD radix sort of keys, applying the same permutation to values
+ *
+ * One pass per byte of Key; a pass whose byte is the same for every key is skipped, so short
+ * codes in a wide key cost nothing. In parallel mode every pass counts and scatters chunks of
+ * the given size concurrently on concurrency::DefaultPool(); the chunk offsets are taken from
+ * the counts of the chunks before, so the result is the same as the serial one.
+ */
+template <typename Key, typename Value>
+void RadixSortByKey(std::vector<Key>& keys, std::vector<Value>& values, bool parallel, size_t chunk) {
+    static_assert(std::is_unsigned_v<Key>);
+
+    constexpr size_t kRadix = 256;
+    using Counts = std::array<size_t, kRadix>;
+
+    const size_t n = keys.size();
+    chunk = std::max<size_t>(chunk, 1);
+    const size_t chunks = (!parallel || n <= chunk) ? 1 : (n + chunk - 1) / chunk;
+
+    auto for_each_chunk = [&](auto&& process) {
+        if (chunks == 1) {
+            process(size_t{0}, size_t{0}, n);
+            return;
+        }
+        concurrency::TaskGroup group;
+        for (size_t c = 0; c != chunks; ++c) {
+            group.Run([&process, c, first = c * chunk, last = std::min(n, (c + 1) * chunk)] {
+                process(c, first, last);
+            });
+        }
+        group.Wait();
+    };
+
+    std::vector<Key> key_buffer(n);
+    std::vector<Value> value_buffer(n);
+    std::vector<Counts> counts(chunks);
+
+    for (unsigned shift = 0; shift != 8 * sizeof(Key); shift += 8) {
+        for_each_chunk([&](size_t c, size_t first, size_t last) {
+            counts[c].fill(0);
+            for (size_t i = first; i != last; ++i) {
+                ++counts[c][(keys[i] >> shift) & (kRadix - 1)];
+            }
+        });
+
+        // offsets of every chunk in every bucket, in place of the counts
+        size_t offset = 0;
+        bool one_bucket = false;
+        for (size_t digit = 0; digit != kRadix; ++digit) {
+            size_t bucket_size = 0;
+            for (size_t c = 0; c != chunks; ++c) {
+                size_t count = counts[c][digit];
+                counts[c][digit] = offset + bucket_size;
+                bucket_size += count;
+            }
+            one_bucket = one_bucket || bucket_size == n;
+            offset += bucket_size;
+        }
+        if (one_bucket) {
+            continue;
+        }
+
+        for_each_chunk([&](size_t c, size_t first, size_t last) {
+            auto& next = counts[c];
+            for (size_t i = first; i != last; ++i) {
+                size_t to = next[(keys[i] >> shift) & (kRadix - 1)]++;
+                key_buffer[to] = keys[i];
+                value_buffer[to] = std::move(values[i]);
+            }
+        });
+
+        keys.swap(key_buffer);
+        values.swap(value_buffer);
+    }
+}
+
+} // namespace acceleration
+
+} // namespace geometry
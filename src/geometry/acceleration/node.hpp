@@ -27,6 +27,10 @@ public:
         return aabb_;
     }
 
+    void SetAABB(const AABB<T>& aabb) noexcept {
+        aabb_ = aabb;
+    }
+
     std::span<const IndexedTriangle<T>> GetTriangles() const noexcept {
         return triangles_;
     }
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#include "build_options.hpp"
+
+namespace geometry {
+
+namespace acceleration {
+
+namespace detail {
+
+/**
+ * @brief van Emde Boas order of the levels [0, levels) of the subtree below root
+ *
+ * The top half of the levels is laid out first, recursively, and then every subtree hanging
+ * below it, each recursively, so any subtree of 2^k levels lies in about one block of memory.
+ */
+template <typename Children>
+void VanEmdeBoasOrder(size_t root, size_t levels, const std::vector<uint32_t>& heights,
+                      Children& children, std::vector<size_t>& order)
+{
+    if (levels == 1) {
+        order.push_back(root);
+        return;
+    }
+
+    const size_t top = levels / 2;
+    VanEmdeBoasOrder(root, top, heights, children, order);
+
+    // roots of the bottom subtrees, left to right
+    std::vector<size_t> bottoms;
+    std::vector<size_t> below;
+    std::vector<std::pair<size_t, size_t>> stack{{root, 0}};
+    while (!stack.empty()) {
+        auto [node, depth] = stack.back();
+        stack.pop_back();
+
+        if (depth == top) {
+            bottoms.push_back(node);
+            continue;
+        }
+
+        below.clear();
+        children(node, below);
+        for (size_t i = below.size(); i-- != 0;) {
+            stack.emplace_back(below[i], depth + 1);
+        }
+    }
+
+    for (size_t bottom : bottoms) {
+        VanEmdeBoasOrder(bottom, std::min<size_t>(heights[bottom], levels - top), heights, children, order);
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief Nodes of the tree below root in the order they are laid out in memory
+ *
+ * The tree is given by children(node, out), which appends the children of node to out from left
+ * to right, node being an index in [0, count). Every order puts a node before its children:
+ * - kDepthFirst: preorder, so a subtree takes one contiguous range
+ * - kBreadthFirst: level by level, the top levels of the tree taking the fewest cache lines
+ * - kVanEmdeBoas: recursive split of the levels in halves, see detail::VanEmdeBoasOrder
+ */
+template <typename Children>
+std::vector<size_t> OrderNodes(size_t count, size_t root, NodeOrder node_order, Children&& children) {
+    std::vector<size_t> order{root};
+    std::vector<size_t> below;
+
+    if (node_order == NodeOrder::kBreadthFirst) {
+        for (size_t i = 0; i != order.size(); ++i) {
+            children(order[i], order);
+        }
+        return order;
+    }
+
+    // preorder first, also to get the heights for the van Emde Boas order
+    order.clear();
+    std::vector<size_t> stack{root};
+    while (!stack.empty()) {
+        size_t node = stack.back();
+        stack.pop_back();
+        order.push_back(node);
+
+        below.clear();
+        children(node, below);
+        stack.insert(stack.end(), below.rbegin(), below.rend());
+    }
+
+    if (node_order != NodeOrder::kVanEmdeBoas) {
+        return order;
+    }
+
+    // number of levels of the subtree below every node, the children of which come after it
+    std::vector<uint32_t> heights(count, 0);
+    for (size_t i = order.size(); i-- != 0;) {
+        below.clear();
+        children(order[i], below);
+
+        uint32_t height = 0;
+        for (size_t child : below) {
+            height = std::max(height, heights[child]);
+        }
+        heights[order[i]] = height + 1;
+    }
+
+    std::vector<size_t> layout;
+    layout.reserve(order.size());
+    detail::VanEmdeBoasOrder(root, heights[root], heights, children, layout);
+    return layout;
+}
+
+} // namespace acceleration
+
+} // namespace geometry
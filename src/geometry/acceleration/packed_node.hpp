@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cmath>
+#include <span>
+#include <limits>
+#include <vector>
+#include <cstdint>
+#include <concepts>
+
+#include "node.hpp"
+#include "node_order.hpp"
+
+namespace geometry {
+
+namespace acceleration {
+
+/**
+ * @brief Position of the root in a packed node array; position 1 is left empty, so that the
+ * children of every node start at an even position
+ */
+inline constexpr NodeIdx kPackedRootIdx = 0;
+
+/**
+ * @brief Node of the traversal layout, 32 bytes with float bounds and 64 bytes with double ones
+ *
+ * The box is stored inflated by kEpsilon / 2 on every side, so two boxes are within kEpsilon of
+ * each other exactly when they overlap, and the test needs no additions. The children of an inner
+ * node are adjacent, the right one right after the left one, which leaves room for the first
+ * triangle of a leaf in the same field as the left child.
+ */
+template <typename B>
+requires concepts::Numeric<B>
+class alignas(sizeof(B) <= 4 ? 32 : 64) PackedNode final {
+public:
+    PackedNode() = default;
+
+    PackedNode(const AABB<B>& bounds, NodeIdx left)
+        : bounds_(bounds), left_(static_cast<uint32_t>(left)), count_(kInnerNode) {}
+
+    PackedNode(const AABB<B>& bounds, size_t first, size_t count)
+        : bounds_(bounds), first_(static_cast<uint32_t>(first)), count_(static_cast<uint32_t>(count)) {}
+
+    /**
+     * @brief The inflated box of the node
+     */
+    const AABB<B>& GetAABB() const noexcept {
+        return bounds_;
+    }
+
+    void SetAABB(const AABB<B>& bounds) noexcept {
+        bounds_ = bounds;
+    }
+
+    bool IsLeaf() const noexcept {
+        return count_ != kInnerNode;
+    }
+
+    NodeIdx GetLeftIdx() const noexcept {
+        return static_cast<NodeIdx>(left_);
+    }
+
+    NodeIdx GetRightIdx() const noexcept {
+        return static_cast<NodeIdx>(left_) + 1;
+    }
+
+    /**
+     * @brief Position of the first triangle of a leaf in the triangle array of the tree
+     */
+    size_t GetFirstTriangle() const noexcept {
+        return first_;
+    }
+
+    size_t GetNumberOfTriangles() const noexcept {
+        return IsLeaf() ? count_ : 0;
+    }
+
+    /**
+     * @brief Whether the boxes of the nodes are closer than kEpsilon
+     */
+    static bool Overlap(const PackedNode& a, const PackedNode& b) noexcept {
+        return (a.bounds_.min.x <= b.bounds_.max.x) & (a.bounds_.max.x >= b.bounds_.min.x)
+             & (a.bounds_.min.y <= b.bounds_.max.y) & (a.bounds_.max.y >= b.bounds_.min.y)
+             & (a.bounds_.min.z <= b.bounds_.max.z) & (a.bounds_.max.z >= b.bounds_.min.z);
+    }
+
+private:
+    static constexpr uint32_t kInnerNode = std::numeric_limits<uint32_t>::max();
+
+    AABB<B> bounds_;
+    union {
+        uint32_t left_;
+        uint32_t first_ = 0;
+    };
+    uint32_t count_ = 0;
+};
+
+static_assert(sizeof(PackedNode<float>) == 32);
+static_assert(sizeof(PackedNode<double>) == 64);
+
+/**
+ * @brief Whether Nodes is a packed node array
+ */
+template <typename Nodes>
+inline constexpr bool kIsPackedNodes = false;
+
+template <typename B>
+inline constexpr bool kIsPackedNodes<std::span<PackedNode<B>>> = true;
+
+/**
+ * @brief The largest B not greater than value
+ */
+template <typename B, typename T>
+B RoundDown(T value) {
+    if constexpr (std::floating_point<B>) {
+        if (value < static_cast<T>(limits::LowestValue<B>())) {
+            return -std::numeric_limits<B>::infinity();
+        }
+        if (value > static_cast<T>(limits::MaxValue<B>())) {
+            return limits::MaxValue<B>();
+        }
+
+        B rounded = static_cast<B>(value);
+        return (rounded > value) ? std::nextafter(rounded, -std::numeric_limits<B>::infinity()) : rounded;
+    } else {
+        return static_cast<B>(value);
+    }
+}
+
+/**
+ * @brief The smallest B not less than value
+ */
+template <typename B, typename T>
+B RoundUp(T value) {
+    return -RoundDown<B>(-value);
+}
+
+/**
+ * @brief Box inflated by kEpsilon / 2 on every side and rounded outwards to B
+ *
+ * The result always contains the box, so with B narrower than T the box tests may only report
+ * more overlaps than with T, never fewer. Integer boxes are not inflated: kEpsilon changes no
+ * comparison of integers.
+ */
+template <typename B, typename T>
+AABB<B> InflateBounds(const AABB<T>& box) {
+    if constexpr (std::integral<B>) {
+        return {Point<B>{box.min.x, box.min.y, box.min.z}, Point<B>{box.max.x, box.max.y, box.max.z}};
+    } else {
+        constexpr auto margin = constants::kEpsilon / 2;
+        return {
+            Point<B>{RoundDown<B>(box.min.x - margin), RoundDown<B>(box.min.y - margin), RoundDown<B>(box.min.z - margin)},
+            Point<B>{RoundUp<B>(box.max.x + margin), RoundUp<B>(box.max.y + margin), RoundUp<B>(box.max.z + margin)}
+        };
+    }
+}
+
+/**
+ * @brief Copies the tree below root into the packed layout
+ *
+ * The root goes to kPackedRootIdx and the children of every inner node, as one pair, to the
+ * next free even position, taking the inner nodes in node_order. Both children of a node with
+ * float bounds thus share a cache line, and with the default depth-first order a subtree stays in
+ * one region of the array.
+ *
+ * @param triangles The triangle array the leaf spans point into
+ * @param sources If not null, receives the index in nodes of every packed node, invalid_idx for
+ * the unused position
+ */
+template <typename B, typename T>
+std::vector<PackedNode<B>> PackNodes(const std::vector<BVHNode<T>>& nodes, NodeIdx root,
+                                     const IndexedTriangle<T>* triangles,
+                                     NodeOrder node_order = NodeOrder::kDepthFirst,
+                                     std::vector<NodeIdx>* sources = nullptr)
+{
+    auto inner_children = [&nodes](size_t idx, std::vector<size_t>& out) {
+        for (NodeIdx child : {nodes[idx].GetLeftIdx(), nodes[idx].GetRightIdx()}) {
+            if (!nodes[child].IsLeaf()) {
+                out.push_back(child);
+            }
+        }
+    };
+
+    // position of the children of every inner node
+    std::vector<NodeIdx> children_at(nodes.size(), kPackedRootIdx);
+    if (!nodes[root].IsLeaf()) {
+        NodeIdx next = kPackedRootIdx + 2;
+        for (size_t idx : OrderNodes(nodes.size(), root, node_order, inner_children)) {
+            children_at[idx] = next;
+            next += 2;
+        }
+    }
+
+    std::vector<PackedNode<B>> packed(nodes.size() + 1);
+    if (sources) {
+        sources->assign(packed.size(), invalid_idx);
+    }
+
+    auto pack = [&](NodeIdx idx, NodeIdx at) {
+        const auto& node = nodes[idx];
+        if (sources) {
+            (*sources)[at] = idx;
+        }
+
+        AABB<B> bounds = InflateBounds<B>(node.GetAABB());
+
+        if (node.IsLeaf()) {
+            packed[at] = PackedNode<B>(bounds, node.GetTriangles().data() - triangles, node.GetNumberOfTriangles());
+        } else {
+            packed[at] = PackedNode<B>(bounds, children_at[idx]);
+        }
+    };
+
+    pack(root, kPackedRootIdx);
+    for (size_t idx = 0; idx != nodes.size(); ++idx) {
+        if (!nodes[idx].IsLeaf() && children_at[idx] != kPackedRootIdx) {
+            pack(nodes[idx].GetLeftIdx(), children_at[idx]);
+            pack(nodes[idx].GetRightIdx(), children_at[idx] + 1);
+        }
+    }
+
+    return packed;
+}
+
+} // namespace acceleration
+
+} // namespace geometry
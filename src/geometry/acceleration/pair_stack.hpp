@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+namespace geometry {
+
+namespace acceleration {
+
+/**
+ * @brief LIFO stack of traversal entries with kCapacity of them stored inline
+ *
+ * The inline array lives in the frame of the traversal, so a balanced tree never leaves it and
+ * the stack stays in cache. A deeper traversal moves the entries to a heap buffer that doubles
+ * as needed, so there is no depth limit.
+ */
+template <typename Entry, size_t kCapacity>
+class PairStack {
+public:
+    PairStack() = default;
+
+    PairStack(const PairStack&) = delete;
+    PairStack& operator=(const PairStack&) = delete;
+
+    void Push(const Entry& entry) {
+        if (size_ == capacity_) [[unlikely]] {
+            Grow();
+        }
+        data_[size_++] = entry;
+    }
+
+    /**
+     * @brief Makes room for count more entries, so that PushIf needs no capacity check
+     */
+    void Reserve(size_t count) {
+        while (size_ + count > capacity_) {
+            Grow();
+        }
+    }
+
+    /**
+     * @brief Pushes entry if keep is set, without a branch; requires room reserved by Reserve
+     */
+    void PushIf(const Entry& entry, bool keep) noexcept {
+        data_[size_] = entry;
+        size_ += keep;
+    }
+
+    Entry Pop() noexcept {
+        return data_[--size_];
+    }
+
+    bool Empty() const noexcept {
+        return size_ == 0;
+    }
+
+    size_t Size() const noexcept {
+        return size_;
+    }
+
+    /**
+     * @brief Whether the entries have moved from the inline array to the heap
+     */
+    bool Spilled() const noexcept {
+        return data_ != inline_.data();
+    }
+
+private:
+    std::array<Entry, kCapacity> inline_;
+    std::vector<Entry> spill_;
+    Entry* data_ = inline_.data();
+    size_t size_ = 0;
+    size_t capacity_ = kCapacity;
+
+    [[gnu::noinline]] void Grow() {
+        std::vector<Entry> grown(2 * capacity_);
+        std::copy(data_, data_ + size_, grown.begin());
+
+        spill_.swap(grown);
+        data_ = spill_.data();
+        capacity_ = spill_.size();
+    }
+};
+
+} // namespace acceleration
+
+} // namespace geometry
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+
+#include "node.hpp"
+#include "pair_stack.hpp"
+
+namespace geometry {
+
+namespace acceleration {
+
+/**
+ * @brief Pair of nodes a traversal descends into; a is a node of the first tree and b of the
+ * second one, which may be the same tree
+ */
+struct NodePair {
+    NodeIdx a;
+    NodeIdx b;
+};
+
+/**
+ * @brief Pairs TraverseNodePairs keeps inline; a balanced tree needs at most four per level
+ */
+inline constexpr size_t kPairStackCapacity = 128;
+
+using NodePairStack = PairStack<NodePair, kPairStackCapacity>;
+
+/**
+ * @brief Calls visit for every pair the traversal descends into from the overlapping pair
+ * (a_idx, b_idx) of which at least one node is inner
+ *
+ * The larger node, by the sum of the box extents, is descended first: a leaf or a node less than
+ * half as large as the other one stays whole while the other is split. Nodes of comparable size,
+ * which are most pairs of a self query, are split together into four pairs.
+ */
+template <typename NodeA, typename NodeB, typename Visit>
+void ForEachChildPair(NodeIdx a_idx, const NodeA& a, NodeIdx b_idx, const NodeB& b, Visit&& visit) {
+    bool split_a = !a.IsLeaf();
+    bool split_b = !b.IsLeaf();
+
+    if (split_a && split_b) {
+        auto a_extent = a.GetAABB().max - a.GetAABB().min;
+        auto b_extent = b.GetAABB().max - b.GetAABB().min;
+        auto a_size = a_extent.x + a_extent.y + a_extent.z;
+        auto b_size = b_extent.x + b_extent.y + b_extent.z;
+        split_a = 2 * a_size >= b_size;
+        split_b = 2 * b_size >= a_size;
+    }
+
+    if (split_a && split_b) {
+        visit(a.GetLeftIdx(), b.GetLeftIdx());
+        visit(a.GetLeftIdx(), b.GetRightIdx());
+        visit(a.GetRightIdx(), b.GetLeftIdx());
+        visit(a.GetRightIdx(), b.GetRightIdx());
+    } else if (split_a) {
+        visit(a.GetLeftIdx(), b_idx);
+        visit(a.GetRightIdx(), b_idx);
+    } else {
+        visit(a_idx, b.GetLeftIdx());
+        visit(a_idx, b.GetRightIdx());
+    }
+}
+
+/**
+ * @brief Depth-first traversal of the pairs of overlapping nodes below (root.a, root.b)
+ *
+ * Runs on an explicit stack, so degenerate deep trees need no call stack. The children pairs of
+ * ForEachChildPair are tested before they are pushed, and pushed with PushIf: the result of a box
+ * test is close to random, and this loop has no branch on it. The last pair pushed is taken
+ * first. The stack entries below stack.Size() at the call are left untouched.
+ *
+ * Query provides:
+ * - NodeA(idx), NodeB(idx): the nodes of the two trees
+ * - Stopped(): whether the traversal must end now
+ * - Prune(a, b): whether the pair is known to add nothing
+ * - Overlap(a, b): box test of a pair of nodes
+ * - IntersectLeaves(a, b): exact tests of a pair of leaves
+ */
+template <typename Query>
+void TraverseNodePairs(NodePair root, Query& query, NodePairStack& stack) {
+    const size_t base = stack.Size();
+
+    stack.Reserve(1);
+    stack.PushIf(root, query.Overlap(root.a, root.b));
+
+    while (stack.Size() != base && !query.Stopped()) {
+        NodePair pair = stack.Pop();
+        if (query.Prune(pair.a, pair.b)) {
+            continue;
+        }
+
+        const auto& a = query.NodeA(pair.a);
+        const auto& b = query.NodeB(pair.b);
+
+        if (a.IsLeaf() && b.IsLeaf()) {
+            query.IntersectLeaves(pair.a, pair.b);
+            continue;
+        }
+
+        stack.Reserve(4);
+        ForEachChildPair(pair.a, a, pair.b, b, [&](NodeIdx l, NodeIdx r) {
+            stack.PushIf({l, r}, query.Overlap(l, r));
+        });
+    }
+}
+
+template <typename Query>
+void TraverseNodePairs(NodePair root, Query& query) {
+    NodePairStack stack;
+    TraverseNodePairs(root, query, stack);
+}
+
+/**
+ * @brief Depth-first traversal of all pairs inside the subtree root of the tree of NodeA
+ *
+ * Every subtree is traversed on its own and the pair (left, right) of its children once with
+ * TraverseNodePairs, so no node pair is visited twice. Query is as for TraverseNodePairs, with
+ * IntersectLeaves(idx, idx) for the pairs inside one leaf and Prune(idx, idx) for a subtree.
+ */
+template <typename Query>
+void TraverseSelfPairs(NodeIdx root, Query& query) {
+    NodePairStack stack;
+    stack.Push({root, root});
+
+    while (!stack.Empty() && !query.Stopped()) {
+        NodeIdx idx = stack.Pop().a;
+        if (query.Prune(idx, idx)) {
+            continue;
+        }
+
+        const auto& node = query.NodeA(idx);
+        if (node.IsLeaf()) {
+            query.IntersectLeaves(idx, idx);
+            continue;
+        }
+
+        stack.Push({node.GetRightIdx(), node.GetRightIdx()});
+        stack.Push({node.GetLeftIdx(), node.GetLeftIdx()});
+        TraverseNodePairs({node.GetLeftIdx(), node.GetRightIdx()}, query, stack);
+    }
+}
+
+} // namespace acceleration
+
+} // namespace geometry
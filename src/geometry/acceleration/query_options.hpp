@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+
+#include "thread_pool.hpp"
+
+namespace geometry {
+
+namespace acceleration {
+
+/**
+ * @brief Exact triangle-triangle test run on the candidates of the batched filters
+ * 
+ * Both engines give the same answers; kMoller rejects most pairs by the signed distances of
+ * the vertices to the other plane before any separating axis is built.
+ */
+enum class NarrowPhase {
+    kSat,
+    kMoller,
+};
+
+/**
+ * @brief Parameters of the BVH intersection queries
+ * 
+ * - execution: kParallel splits the top levels of the traversal into tasks that run on
+ *   concurrency::DefaultPool(); all tasks flag the ids they find in one shared IntersectionResult
+ *   with atomic updates
+ * - tasks_per_thread: how many tasks per pool thread the traversal is split into; more tasks
+ *   balance the load better at the cost of a deeper serial split
+ * - narrow_phase: exact test engine, see NarrowPhase
+ * - skip_flagged: for the id queries, skip the pairs whose triangles are both known to intersect
+ *   something already and the node pairs whose subtrees are fully known to
+ */
+struct QueryOptions {
+    concurrency::Execution execution = concurrency::Execution::kSerial;
+    size_t tasks_per_thread = 16;
+    NarrowPhase narrow_phase = NarrowPhase::kSat;
+    bool skip_flagged = false;
+};
+
+/**
+ * @brief Work counters of one traversal
+ * 
+ * - aabb_tests: node pairs whose boxes were compared
+ * - triangle_pairs: triangle pairs enumerated in leaves
+ * - narrow_phase_tests: calls of the exact triangle-triangle test, after the batched filters
+ * - skipped_narrow_phase_tests: exact tests avoided because both triangles were already flagged
+ * - pruned_node_pairs: node pairs not traversed because their subtrees were fully flagged
+ */
+struct TraversalStats {
+    size_t aabb_tests = 0;
+    size_t triangle_pairs = 0;
+    size_t narrow_phase_tests = 0;
+    size_t skipped_narrow_phase_tests = 0;
+    size_t pruned_node_pairs = 0;
+
+    TraversalStats& operator+=(const TraversalStats& other) {
+        aabb_tests += other.aabb_tests;
+        triangle_pairs += other.triangle_pairs;
+        narrow_phase_tests += other.narrow_phase_tests;
+        skipped_narrow_phase_tests += other.skipped_narrow_phase_tests;
+        pruned_node_pairs += other.pruned_node_pairs;
+        return *this;
+    }
+};
+
+} // namespace acceleration
+
+} // namespace geometry
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#include "triangle_soa.hpp"
+
+namespace geometry {
+
+namespace acceleration {
+
+enum class SimdLevel {
+    kScalar,
+    kAvx2,
+    kAvx512,
+};
+
+/**
+ * @brief Widest instruction set the batched kernels can use on this CPU, detected once
+ */
+inline SimdLevel DetectSimdLevel() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    static const SimdLevel level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return SimdLevel::kAvx512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return SimdLevel::kAvx2;
+        }
+        return SimdLevel::kScalar;
+    }();
+    return level;
+#else
+    return SimdLevel::kScalar;
+#endif
+}
+
+namespace detail {
+
+/**
+ * @brief Separating axis test of triangle a of a_soa against kLanes consecutive triangles of soa
+ *
+ * Tests the 11 SAT axes of Triangle::Sat (both normals and the 9 edge cross products) without
+ * normalizing them: an axis L separates when the gap between the projection intervals exceeds
+ * tolerance * |L|, which is compared squared. Of two different SoAs the larger tolerance and
+ * minimum axis length are taken. Stops as soon as every lane is separated.
+ *
+ * V is a GCC vector of kLanes values of T. The function is always inlined, so it is compiled for
+ * the instruction set of the dispatching wrapper it is inlined into.
+ *
+ * @return bit k set if triangle j + k is separated from a
+ */
+template <typename T, size_t kLanes>
+[[gnu::always_inline]] inline uint32_t SatRejectLanes(const TriangleSoA<T>& a_soa, size_t a,
+                                                      const TriangleSoA<T>& soa, size_t j)
+{
+    typedef T V __attribute__((vector_size(sizeof(T) * kLanes)));
+
+    // vectors are passed by reference so no lambda has a vector in its calling convention
+    auto Load = [&](V& v, std::span<const T> values) __attribute__((always_inline)) {
+        std::memcpy(&v, values.data() + j, sizeof(V));
+    };
+
+    const double tolerance = std::max(a_soa.GetTolerance(), soa.GetTolerance());
+    const double min_axis = std::max(a_soa.GetMinAxisLength(), soa.GetMinAxisLength());
+    const V tol2 = V{} + static_cast<T>(tolerance * tolerance);
+    const V min_axis2 = V{} + static_cast<T>(min_axis * min_axis);
+
+    V ax[3], ay[3], az[3], aex[3], aey[3], aez[3];
+    V bx[3], by[3], bz[3], bex[3], bey[3], bez[3];
+    for (size_t v = 0; v != 3; ++v) {
+        ax[v] = V{} + a_soa.vertices[v].x[a];
+        ay[v] = V{} + a_soa.vertices[v].y[a];
+        az[v] = V{} + a_soa.vertices[v].z[a];
+        aex[v] = V{} + a_soa.edges[v].x[a];
+        aey[v] = V{} + a_soa.edges[v].y[a];
+        aez[v] = V{} + a_soa.edges[v].z[a];
+
+        Load(bx[v], soa.vertices[v].x);
+        Load(by[v], soa.vertices[v].y);
+        Load(bz[v], soa.vertices[v].z);
+        Load(bex[v], soa.edges[v].x);
+        Load(bey[v], soa.edges[v].y);
+        Load(bez[v], soa.edges[v].z);
+    }
+
+    auto rejected = (tol2 != tol2);
+
+    auto TestAxis = [&](const V& lx, const V& ly, const V& lz) __attribute__((always_inline)) {
+        V pa0 = lx * ax[0] + ly * ay[0] + lz * az[0];
+        V pa1 = lx * ax[1] + ly * ay[1] + lz * az[1];
+        V pa2 = lx * ax[2] + ly * ay[2] + lz * az[2];
+        V pb0 = lx * bx[0] + ly * by[0] + lz * bz[0];
+        V pb1 = lx * bx[1] + ly * by[1] + lz * bz[1];
+        V pb2 = lx * bx[2] + ly * by[2] + lz * bz[2];
+
+        V a_min = pa0 < pa1 ? pa0 : pa1;
+        a_min = a_min < pa2 ? a_min : pa2;
+        V a_max = pa0 > pa1 ? pa0 : pa1;
+        a_max = a_max > pa2 ? a_max : pa2;
+        V b_min = pb0 < pb1 ? pb0 : pb1;
+        b_min = b_min < pb2 ? b_min : pb2;
+        V b_max = pb0 > pb1 ? pb0 : pb1;
+        b_max = b_max > pb2 ? b_max : pb2;
+
+        V gap = b_min - a_max;
+        V other_gap = a_min - b_max;
+        gap = gap > other_gap ? gap : other_gap;
+
+        V length2 = lx * lx + ly * ly + lz * lz;
+        rejected |= (gap > V{}) & (gap * gap > tol2 * length2) & (length2 > min_axis2);
+
+        bool all = true;
+        for (size_t k = 0; k != kLanes; ++k) {
+            all = all && rejected[k];
+        }
+        return all;
+    };
+
+    const V anx = V{} + a_soa.normals.x[a];
+    const V any = V{} + a_soa.normals.y[a];
+    const V anz = V{} + a_soa.normals.z[a];
+    V bnx, bny, bnz;
+    Load(bnx, soa.normals.x);
+    Load(bny, soa.normals.y);
+    Load(bnz, soa.normals.z);
+
+    bool done = TestAxis(anx, any, anz) || TestAxis(bnx, bny, bnz);
+
+    for (size_t e = 0; e != 9 && !done; ++e) {
+        const size_t ea = e / 3;
+        const size_t eb = e % 3;
+        const V lx = aey[ea] * bez[eb] - aez[ea] * bey[eb];
+        const V ly = aez[ea] * bex[eb] - aex[ea] * bez[eb];
+        const V lz = aex[ea] * bey[eb] - aey[ea] * bex[eb];
+        done = TestAxis(lx, ly, lz);
+    }
+
+    uint32_t mask = 0;
+    for (size_t k = 0; k != kLanes; ++k) {
+        mask |= static_cast<uint32_t>(rejected[k] != 0) << k;
+    }
+    return mask;
+}
+
+template <typename T, size_t kLanes>
+[[gnu::always_inline]] inline size_t SatSelect(const TriangleSoA<T>& a_soa, size_t a, const TriangleSoA<T>& soa,
+                                               size_t first, size_t last, uint8_t* candidates)
+{
+    size_t count = 0;
+    size_t j = first;
+
+    for (; j + kLanes <= last; j += kLanes) {
+        uint32_t rejected = SatRejectLanes<T, kLanes>(a_soa, a, soa, j);
+        for (size_t k = 0; k != kLanes; ++k) {
+            uint8_t candidate = !((rejected >> k) & 1) || soa.degenerate[j + k];
+            candidates[j + k - first] = candidate;
+            count += candidate;
+        }
+    }
+
+    for (; j != last; ++j) {
+        uint8_t candidate = !SatRejectLanes<T, 1>(a_soa, a, soa, j) || soa.degenerate[j];
+        candidates[j - first] = candidate;
+        count += candidate;
+    }
+
+    return count;
+}
+
+template <typename T>
+size_t SatSelectScalar(const TriangleSoA<T>& a_soa, size_t a, const TriangleSoA<T>& soa, size_t first, size_t last,
+                       uint8_t* candidates)
+{
+    return SatSelect<T, 1>(a_soa, a, soa, first, last, candidates);
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+template <typename T>
+[[gnu::target("avx2")]]
+size_t SatSelectAvx2(const TriangleSoA<T>& a_soa, size_t a, const TriangleSoA<T>& soa, size_t first, size_t last,
+                     uint8_t* candidates)
+{
+    return SatSelect<T, 32 / sizeof(T)>(a_soa, a, soa, first, last, candidates);
+}
+
+template <typename T>
+[[gnu::target("avx512f")]]
+size_t SatSelectAvx512(const TriangleSoA<T>& a_soa, size_t a, const TriangleSoA<T>& soa, size_t first, size_t last,
+                       uint8_t* candidates)
+{
+    return SatSelect<T, 64 / sizeof(T)>(a_soa, a, soa, first, last, candidates);
+}
+
+#endif
+
+} // namespace detail
+
+/**
+ * @brief Marks in candidates[j - first] which triangles of [first, last) of soa may intersect
+ * triangle a of a_soa
+ *
+ * A pair is dropped only when both triangles are non-degenerate and one of the 11 SAT axes
+ * separates them by more than the SoA tolerance, in which case Triangle::Intersect is certainly
+ * false. Runs 4 (AVX2) or 8 (AVX-512) double lanes at once when the CPU supports it.
+ *
+ * @param level Instruction set to use; defaults to the best one available
+ * @return number of remaining candidates
+ */
+template <typename T>
+size_t SelectCandidates(const TriangleSoA<T>& a_soa, size_t a, const TriangleSoA<T>& soa, size_t first,
+                        size_t last, uint8_t* candidates, SimdLevel level = DetectSimdLevel())
+{
+    if (a_soa.degenerate[a]) {
+        std::memset(candidates, 1, last - first);
+        return last - first;
+    }
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    if constexpr (std::is_floating_point_v<T>) {
+        switch (level) {
+            case SimdLevel::kAvx512: return detail::SatSelectAvx512(a_soa, a, soa, first, last, candidates);
+            case SimdLevel::kAvx2:   return detail::SatSelectAvx2(a_soa, a, soa, first, last, candidates);
+            default: break;
+        }
+    }
+#endif
+
+    return detail::SatSelectScalar(a_soa, a, soa, first, last, candidates);
+}
+
+/**
+ * @brief SelectCandidates of triangle a against [first, last) of the same SoA
+ */
+template <typename T>
+size_t SelectCandidates(const TriangleSoA<T>& soa, size_t a, size_t first, size_t last, uint8_t* candidates,
+                        SimdLevel level = DetectSimdLevel())
+{
+    return SelectCandidates(soa, a, soa, first, last, candidates, level);
+}
+
+} // namespace acceleration
+
+} // namespace geometry
@@ -0,0 +1,349 @@
+#pragma once
+
+#include <bit>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+#include "aabb.hpp"
+#include "morton.hpp"
+#include "packed_node.hpp"
+#include "sat_kernel.hpp"
+#include "query_options.hpp"
+#include "thread_pool.hpp"
+#include "indexed_triangle.hpp"
+#include "prepared_triangle.hpp"
+#include "intersection_result.hpp"
+
+namespace geometry {
+
+namespace acceleration {
+
+/**
+ * @brief Parameters of the SweepAndPrune construction
+ *
+ * - execution: kParallel sorts the boxes and lays them out in chunks on
+ *   concurrency::DefaultPool(); the result is identical to the serial one
+ * - parallel_threshold: number of triangles per chunk of the parallel construction
+ */
+struct SweepOptions {
+    concurrency::Execution execution = concurrency::Execution::kSerial;
+    size_t parallel_threshold = 4096;
+};
+
+namespace detail {
+
+/**
+ * @brief Boxes of SweepAndPrune in sweep order, one array per bound; axis 0 is the sweep axis
+ */
+template <typename T>
+struct SweepBoxes {
+    std::array<std::vector<T>, 3> min;
+    std::array<std::vector<T>, 3> max;
+};
+
+/**
+ * @brief Bit k set if box j + k overlaps box i: starts on the sweep axis before box i ends and
+ * overlaps it on the other two axes
+ *
+ * V is a GCC vector of kLanes values of T, compiled for the instruction set of the dispatching
+ * wrapper it is inlined into. The arrays are padded so that j + kLanes never reads past them.
+ */
+template <typename T, size_t kLanes>
+[[gnu::always_inline]] inline uint32_t SweepOverlapLanes(const SweepBoxes<T>& boxes, size_t i, size_t j) {
+    typedef T V __attribute__((vector_size(sizeof(T) * kLanes)));
+
+    auto Load = [&](V& v, const std::vector<T>& values) __attribute__((always_inline)) {
+        std::memcpy(&v, values.data() + j, sizeof(V));
+    };
+
+    V start, min1, max1, min2, max2;
+    Load(start, boxes.min[0]);
+    Load(min1, boxes.min[1]);
+    Load(max1, boxes.max[1]);
+    Load(min2, boxes.min[2]);
+    Load(max2, boxes.max[2]);
+
+    auto overlap = (start <= boxes.max[0][i])
+                 & (min1 <= boxes.max[1][i]) & (max1 >= boxes.min[1][i])
+                 & (min2 <= boxes.max[2][i]) & (max2 >= boxes.min[2][i]);
+
+    uint32_t mask = 0;
+    for (size_t k = 0; k != kLanes; ++k) {
+        mask |= static_cast<uint32_t>(overlap[k] != 0) << k;
+    }
+    return mask;
+}
+
+template <typename T, size_t kLanes, typename Process>
+[[gnu::always_inline]] inline void SweepBox(const SweepBoxes<T>& boxes, size_t i, size_t n, Process&& process) {
+    const T end = boxes.max[0][i];
+    for (size_t j = i + 1; j < n && boxes.min[0][j] <= end; j += kLanes) {
+        for (uint32_t mask = SweepOverlapLanes<T, kLanes>(boxes, i, j); mask != 0; mask &= mask - 1) {
+            process(j + std::countr_zero(mask));
+        }
+    }
+}
+
+template <typename T, typename Process>
+void SweepScalar(const SweepBoxes<T>& boxes, size_t first, size_t last, size_t n, Process& process) {
+    for (size_t i = first; i != last; ++i) {
+        SweepBox<T, 1>(boxes, i, n, [&](size_t j) { process(i, j); });
+    }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+template <typename T, typename Process>
+[[gnu::target("avx2")]]
+void SweepAvx2(const SweepBoxes<T>& boxes, size_t first, size_t last, size_t n, Process& process) {
+    for (size_t i = first; i != last; ++i) {
+        SweepBox<T, 32 / sizeof(T)>(boxes, i, n, [&](size_t j) { process(i, j); });
+    }
+}
+
+template <typename T, typename Process>
+[[gnu::target("avx512f")]]
+void SweepAvx512(const SweepBoxes<T>& boxes, size_t first, size_t last, size_t n, Process& process) {
+    for (size_t i = first; i != last; ++i) {
+        SweepBox<T, 64 / sizeof(T)>(boxes, i, n, [&](size_t j) { process(i, j); });
+    }
+}
+
+#endif
+
+/**
+ * @brief Unsigned key in the order of value, for the radix sort
+ */
+inline uint64_t OrderedKey(double value) noexcept {
+    uint64_t bits = std::bit_cast<uint64_t>(value);
+    return (bits >> 63) ? ~bits : bits | (uint64_t{1} << 63);
+}
+
+} // namespace detail
+
+/**
+ * @brief Broad phase sweeping the triangle boxes along one axis, for inputs stretched along it
+ *
+ * The boxes are sorted by their start on the axis along which the box centers vary the most.
+ * The boxes still open when a box starts, the active list of the sweep, are then exactly the
+ * boxes after it in the sorted order that start before it ends; they are tested in batches of
+ * 4 or 8 lanes (AVX2 or AVX-512) for an overlap on the other two axes, and the overlapping pairs
+ * go to the narrow phase of PreparedTriangle.
+ *
+ * The boxes are grown by kEpsilon / 2 on every side, like the node boxes of the packed trees, so
+ * the box tests keep the pairs of triangles closer than kEpsilon and the query gives the same
+ * answers as BVH.
+ */
+template <typename T>
+requires concepts::Numeric<T>
+class SweepAndPrune {
+public:
+    SweepAndPrune(std::vector<IndexedTriangle<T>>&& triangles, const SweepOptions& options = {})
+        : options_(options)
+    {
+        const size_t n = triangles.size();
+        const bool parallel = options_.execution == concurrency::Execution::kParallel;
+
+        // grown by kEpsilon / 2, so that the exact compares of the sweep keep the triangles closer
+        // than kEpsilon, which the exact test counts as intersecting
+        std::vector<AABB<T>> boxes;
+        boxes.reserve(n);
+        for (const auto& tr : triangles) {
+            boxes.push_back(InflateBounds<T>(AABB<T>(tr.triangle)));
+            id_capacity_ = std::max(id_capacity_, tr.id + 1);
+        }
+        axis_ = ChooseAxis(boxes);
+
+        std::vector<uint64_t> keys(n);
+        std::vector<uint32_t> order(n);
+        for (size_t i = 0; i != n; ++i) {
+            keys[i] = detail::OrderedKey(static_cast<double>(boxes[i].min[axis_]));
+            order[i] = static_cast<uint32_t>(i);
+        }
+        RadixSortByKey(keys, order, parallel, options_.parallel_threshold);
+
+        // the sweep axis first, then the other two
+        const std::array<size_t, 3> axes{axis_, (axis_ + 1) % 3, (axis_ + 2) % 3};
+        for (size_t k = 0; k != 3; ++k) {
+            // padding never starts before any box ends
+            boxes_.min[k].assign(n + kPadding, limits::MaxValue<T>());
+            boxes_.max[k].assign(n + kPadding, limits::LowestValue<T>());
+        }
+        ids_.resize(n);
+        concurrency::ForEachChunk(n, parallel, options_.parallel_threshold, [&](size_t first, size_t last) {
+            for (size_t i = first; i != last; ++i) {
+                const auto& box = boxes[order[i]];
+                for (size_t k = 0; k != 3; ++k) {
+                    boxes_.min[k][i] = box.min[axes[k]];
+                    boxes_.max[k][i] = box.max[axes[k]];
+                }
+                ids_[i] = triangles[order[i]].id;
+            }
+        });
+
+        // gathered first, so that the triangles are prepared in the order they are read
+        std::vector<Triangle<T>> sorted;
+        sorted.reserve(n);
+        for (uint32_t i : order) {
+            sorted.push_back(triangles[i].triangle);
+        }
+        prepared_.reserve(n);
+        for (const auto& triangle : sorted) {
+            prepared_.emplace_back(triangle);
+        }
+    }
+
+    /**
+     * @brief Ids of all triangles intersecting at least one other triangle
+     *
+     * In parallel mode the sweep is split into options.tasks_per_thread ranges of boxes per pool
+     * thread.
+     *
+     * @param stats If not null, receives the work counters: aabb_tests counts the boxes of the
+     * active lists tested, triangle_pairs the overlapping boxes, narrow_phase_tests the exact tests
+     * @param level Instruction set of the box tests; defaults to the best one available
+     */
+    IntersectionResult FindIntersectingTriangles(const QueryOptions& options = {}, TraversalStats* stats = nullptr,
+                                                 SimdLevel level = DetectSimdLevel()) const
+    {
+        IntersectionResult result(id_capacity_);
+        const size_t n = ids_.size();
+
+        size_t tasks = 1;
+        if (options.execution == concurrency::Execution::kParallel) {
+            concurrency::ThreadPool& pool = concurrency::DefaultPool();
+            tasks = std::clamp<size_t>(options.tasks_per_thread * (pool.GetNumberOfThreads() + 1), 1,
+                                       std::max<size_t>(n, 1));
+        }
+
+        std::vector<TraversalStats> task_stats(tasks);
+        auto run = [&](size_t task) {
+            TraversalStats& task_stat = task_stats[task];
+            auto process = [&](size_t i, size_t j) {
+                ++task_stat.triangle_pairs;
+                if (options.skip_flagged && result.AtomicContains(ids_[i]) && result.AtomicContains(ids_[j])) {
+                    ++task_stat.skipped_narrow_phase_tests;
+                    return;
+                }
+
+                ++task_stat.narrow_phase_tests;
+                bool intersect = (options.narrow_phase == NarrowPhase::kMoller)
+                    ? PreparedTriangle<T>::IntersectMoller(prepared_[i], prepared_[j])
+                    : PreparedTriangle<T>::Intersect(prepared_[i], prepared_[j]);
+                if (intersect) {
+                    result.AtomicInsert(ids_[i]);
+                    result.AtomicInsert(ids_[j]);
+                }
+            };
+
+            size_t first = n * task / tasks;
+            size_t last = n * (task + 1) / tasks;
+            if (stats) {
+                // the batches test a few boxes past the active lists, which are not counted
+                for (size_t i = first; i != last; ++i) {
+                    task_stat.aabb_tests += ActiveListSize(i);
+                }
+            }
+
+            Sweep(first, last, process, level);
+        };
+
+        if (tasks == 1) {
+            run(0);
+        } else {
+            concurrency::TaskGroup group;
+            for (size_t task = 0; task != tasks; ++task) {
+                group.Run([&run, task] { run(task); });
+            }
+            group.Wait();
+        }
+
+        if (stats) {
+            *stats = {};
+            for (const auto& task : task_stats) {
+                *stats += task;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Axis the boxes are swept along: 0, 1 or 2 for x, y or z
+     */
+    size_t GetAxis() const noexcept {
+        return axis_;
+    }
+
+    size_t Size() const noexcept {
+        return ids_.size();
+    }
+
+private:
+    // the widest batch, of float lanes with AVX-512
+    static constexpr size_t kPadding = 16;
+
+    SweepOptions options_;
+    size_t axis_ = 0;
+    size_t id_capacity_ = 0;
+
+    detail::SweepBoxes<T> boxes_;
+    std::vector<TrIndex> ids_;
+    std::vector<PreparedTriangle<T>> prepared_;
+
+    /**
+     * @brief Axis of the largest variance of the box centers
+     */
+    static size_t ChooseAxis(const std::vector<AABB<T>>& boxes) {
+        if (boxes.empty()) {
+            return 0;
+        }
+
+        std::array<double, 3> sum{};
+        std::array<double, 3> sum_of_squares{};
+        for (const auto& box : boxes) {
+            for (size_t axis = 0; axis != 3; ++axis) {
+                double center = (static_cast<double>(box.min[axis]) + static_cast<double>(box.max[axis])) / 2;
+                sum[axis] += center;
+                sum_of_squares[axis] += center * center;
+            }
+        }
+
+        std::array<double, 3> variance{};
+        for (size_t axis = 0; axis != 3; ++axis) {
+            double mean = sum[axis] / boxes.size();
+            variance[axis] = sum_of_squares[axis] / boxes.size() - mean * mean;
+        }
+        return std::max_element(variance.begin(), variance.end()) - variance.begin();
+    }
+
+    size_t ActiveListSize(size_t i) const noexcept {
+        auto begin = boxes_.min[0].begin() + i + 1;
+        auto end = boxes_.min[0].begin() + ids_.size();
+        return std::upper_bound(begin, end, boxes_.max[0][i]) - begin;
+    }
+
+    template <typename Process>
+    void Sweep(size_t first, size_t last, Process& process, SimdLevel level) const {
+        const size_t n = ids_.size();
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        if constexpr (std::is_floating_point_v<T>) {
+            switch (level) {
+                case SimdLevel::kAvx512: return detail::SweepAvx512(boxes_, first, last, n, process);
+                case SimdLevel::kAvx2:   return detail::SweepAvx2(boxes_, first, last, n, process);
+                default: break;
+            }
+        }
+#endif
+
+        detail::SweepScalar(boxes_, first, last, n, process);
+    }
+};
+
+} // namespace acceleration
+
+} // namespace geometry
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <span>
+#include <array>
+#include <limits>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+#include "triangle.hpp"
+#include "indexed_triangle.hpp"
+
+namespace geometry {
+
+namespace acceleration {
+
+/**
+ * @brief Structure-of-arrays copy of a triangle array for batched narrow-phase filters
+ *
+ * Position i holds the i-th triangle of the source span, so a BVH leaf covering the positions
+ * [first, last) of the BVH triangle array covers the same positions here. Edges are
+ * e0 = p1 - p0, e1 = p2 - p1, e2 = p0 - p2; normals are CalculateNormal() of the triangle.
+ *
+ * The components view one block of kComponents * Size() values, ordered as normals, vertices
+ * and edges, x y z each. The block is owned by the SoA when it is built from triangles, and by
+ * someone else, such as a mapped file, when it is made with View; such a SoA must not be changed.
+ */
+template <typename T>
+requires concepts::Numeric<T>
+class TriangleSoA {
+public:
+    static constexpr size_t kComponents = 21;
+
+    struct Components {
+        std::span<T> x;
+        std::span<T> y;
+        std::span<T> z;
+    };
+
+    std::span<TrIndex> ids;
+    std::array<Components, 3> vertices;
+    std::array<Components, 3> edges;
+    Components normals;
+    std::span<uint8_t> degenerate;
+
+    TriangleSoA() = default;
+
+    explicit TriangleSoA(std::span<const IndexedTriangle<T>> triangles)
+        : owned_values_(kComponents * triangles.size()),
+          owned_ids_(triangles.size()),
+          owned_degenerate_(triangles.size())
+    {
+        size_t n = triangles.size();
+        Assign(owned_values_, owned_ids_, owned_degenerate_);
+
+        T scale = 0;
+        for (size_t i = 0; i != n; ++i) {
+            ids[i] = triangles[i].id;
+            scale = std::max(scale, Store(i, triangles[i].triangle));
+        }
+        SetScale(scale);
+    }
+
+    /**
+     * @brief SoA of the arrays of another one, kept alive by the caller
+     *
+     * @param values The block of all components, kComponents * ids.size() values
+     * @param scale GetScale() of the SoA the arrays come from
+     */
+    static TriangleSoA View(std::span<T> values, std::span<TrIndex> ids, std::span<uint8_t> degenerate, T scale) {
+        TriangleSoA soa;
+        soa.Assign(values, ids, degenerate);
+        soa.SetScale(scale);
+        return soa;
+    }
+
+    // the components view owned_values_, which moves with its buffer but cannot be copied
+    TriangleSoA(const TriangleSoA&) = delete;
+    TriangleSoA& operator=(const TriangleSoA&) = delete;
+    TriangleSoA(TriangleSoA&&) noexcept = default;
+    TriangleSoA& operator=(TriangleSoA&&) noexcept = default;
+
+    /**
+     * @brief Replaces the triangle at position i, keeping its id
+     *
+     * Leaves the tolerances as they are: pass the result on to GrowTolerances, once for many
+     * triangles when they are set concurrently.
+     *
+     * @return the largest absolute coordinate of the triangle
+     */
+    T SetTriangle(size_t i, const Triangle<T>& t) {
+        return Store(i, t);
+    }
+
+    /**
+     * @brief Grows the tolerances to cover coordinates up to scale in absolute value
+     *
+     * They never shrink, so they stay valid for the triangles that did not move.
+     */
+    void GrowTolerances(T scale) {
+        if (scale > scale_) {
+            SetScale(scale);
+        }
+    }
+
+    size_t Size() const noexcept {
+        return ids.size();
+    }
+
+    /**
+     * @brief The block of all components, see View
+     */
+    std::span<const T> GetValues() const noexcept {
+        return values_;
+    }
+
+    /**
+     * @brief Largest absolute coordinate the tolerances cover
+     */
+    T GetScale() const noexcept {
+        return scale_;
+    }
+
+    /**
+     * @brief Distance beyond which a separation is certain for Triangle::Intersect as well
+     *
+     * The tolerances of Triangle::Intersect are kEpsilon in absolute or in parametric units, so
+     * kEpsilon is taken with a generous slack and scaled with the input, plus a bound of the
+     * rounding error of the filters.
+     */
+    double GetTolerance() const noexcept {
+        return tolerance_;
+    }
+
+    /**
+     * @brief Cross products of edges shorter than this may be skipped by Triangle::Sat, so the
+     * batched filters do not use them as separating axes either
+     */
+    double GetMinAxisLength() const noexcept {
+        return min_axis_length_;
+    }
+
+private:
+    static constexpr double kSlack = 1024;
+    static constexpr double kRoundingFactor =
+        64 * (std::is_floating_point_v<T> ? std::numeric_limits<T>::epsilon() : 0);
+
+    std::vector<T> owned_values_;
+    std::vector<TrIndex> owned_ids_;
+    std::vector<uint8_t> owned_degenerate_;
+    std::span<T> values_;
+
+    T scale_ = 0;
+    double tolerance_ = constants::kEpsilon;
+    double min_axis_length_ = constants::kEpsilon;
+
+    void Assign(std::span<T> values, std::span<TrIndex> triangle_ids, std::span<uint8_t> degenerate_flags) {
+        const size_t n = triangle_ids.size();
+        values_ = values;
+        ids = triangle_ids;
+        degenerate = degenerate_flags;
+
+        size_t offset = 0;
+        for (auto* c : {&normals, &vertices[0], &vertices[1], &vertices[2], &edges[0], &edges[1], &edges[2]}) {
+            for (auto* component : {&c->x, &c->y, &c->z}) {
+                *component = values.subspan(offset, n);
+                offset += n;
+            }
+        }
+    }
+
+    /**
+     * @brief Writes the components of the triangle at position i
+     *
+     * @return the largest absolute coordinate of the triangle
+     */
+    T Store(size_t i, const Triangle<T>& t) {
+        degenerate[i] = t.DetermineType() != TriangleType::kNormal;
+
+        T scale = 0;
+        for (size_t v = 0; v != 3; ++v) {
+            Point<T> p = t[v];
+            Vector<T> e = t[(v + 1) % 3] - p;
+            Set(vertices[v], i, p.AsVector());
+            Set(edges[v], i, e);
+            scale = std::max({scale, std::abs(p.x), std::abs(p.y), std::abs(p.z)});
+        }
+        Set(normals, i, t.CalculateNormal());
+
+        return scale;
+    }
+
+    void SetScale(T scale) {
+        scale_ = scale;
+        double extent = 1 + static_cast<double>(scale);
+        tolerance_ = (kSlack * constants::kEpsilon + kRoundingFactor) * extent;
+        min_axis_length_ = (kSlack * constants::kEpsilon + kRoundingFactor) * 4 * extent * extent;
+    }
+
+    static void Set(Components& c, size_t i, const Vector<T>& v) {
+        c.x[i] = v.x;
+        c.y[i] = v.y;
+        c.z[i] = v.z;
+    }
+};
+
+} // namespace acceleration
+
+} // namespace geometry
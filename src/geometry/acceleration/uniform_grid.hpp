@@ -0,0 +1,333 @@
+#pragma once
+
+#include <span>
+#include <array>
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+#include "aabb.hpp"
+#include "morton.hpp"
+#include "triangle.hpp"
+#include "packed_node.hpp"
+#include "query_options.hpp"
+#include "thread_pool.hpp"
+#include "indexed_triangle.hpp"
+#include "intersection_result.hpp"
+
+namespace geometry {
+
+namespace acceleration {
+
+/**
+ * @brief Parameters of the UniformGrid construction
+ *
+ * - cell_size: edge of the cubic cells; 0 estimates it from the triangle boxes, see
+ *   UniformGrid::EstimateCellSize
+ * - execution: kParallel fills and sorts the cells in chunks on concurrency::DefaultPool(); the
+ *   grid is identical to the serial one
+ * - parallel_threshold: number of triangles or cell entries per chunk of the parallel build
+ */
+struct GridOptions {
+    double cell_size = 0;
+    concurrency::Execution execution = concurrency::Execution::kSerial;
+    size_t parallel_threshold = 4096;
+};
+
+/**
+ * @brief Broad phase over a uniform grid of cubic cells, for triangles of similar size spread
+ * evenly over space
+ *
+ * Every triangle is entered into every cell its box overlaps, the box grown by kEpsilon / 2 on
+ * every side: triangles closer than kEpsilon count as intersecting in the exact test, and the
+ * grown boxes of such triangles always share a cell. Only the occupied cells are stored: the
+ * entries are radix sorted by the linear index of their cell, so a cell is a run of entries and
+ * needs no hash table. A query tests the pairs inside every cell; a pair sharing several cells is
+ * tested only in the cell holding the lower corner of the overlap of the two grown boxes, which
+ * is the cell of the larger first cells of the two triangles on every axis.
+ *
+ * Gives the same answers as BVH: the exact test is Triangle::Intersect.
+ */
+template <typename T>
+requires concepts::Numeric<T>
+class UniformGrid {
+public:
+    /**
+     * @brief Largest number of cells along an axis; a larger grid gets coarser cells instead
+     */
+    static constexpr uint64_t kMaxCellsPerAxis = uint64_t{1} << 21;
+
+    UniformGrid(std::vector<IndexedTriangle<T>>&& triangles, const GridOptions& options = {})
+        : options_(options), triangles_(std::move(triangles))
+    {
+        if (options_.cell_size < 0 || !std::isfinite(options_.cell_size)) {
+            throw std::invalid_argument("UniformGrid: the cell size must be finite and not negative");
+        }
+
+        const size_t n = triangles_.size();
+        boxes_.reserve(n);
+        for (const auto& tr : triangles_) {
+            boxes_.emplace_back(tr.triangle);
+            bounds_.Expand(InflateBounds<T>(boxes_.back()));
+            id_capacity_ = std::max(id_capacity_, tr.id + 1);
+        }
+        if (n == 0) {
+            return;
+        }
+
+        cell_size_ = (options_.cell_size > 0) ? options_.cell_size : EstimateCellSize();
+        for (size_t axis = 0; axis != 3; ++axis) {
+            double extent = static_cast<double>(bounds_.max[axis]) - static_cast<double>(bounds_.min[axis]);
+            cell_size_ = std::max(cell_size_, extent / (kMaxCellsPerAxis - 1));
+        }
+        if (!(cell_size_ > 0)) {
+            // every triangle is the same point
+            cell_size_ = 1;
+        }
+        for (size_t axis = 0; axis != 3; ++axis) {
+            cells_per_axis_[axis] = CellOf(bounds_.max[axis], axis) + 1;
+        }
+
+        FillCells();
+    }
+
+    /**
+     * @brief Ids of all triangles intersecting at least one other triangle
+     *
+     * In parallel mode the cells are split into options.tasks_per_thread tasks per pool thread.
+     * options.narrow_phase is not used.
+     *
+     * @param stats If not null, receives the work counters: aabb_tests and triangle_pairs count
+     * the pairs met in the cells, narrow_phase_tests the exact tests
+     */
+    IntersectionResult FindIntersectingTriangles(const QueryOptions& options = {},
+                                                 TraversalStats* stats = nullptr) const
+    {
+        IntersectionResult result(id_capacity_);
+        const size_t cells = GetNumberOfCells();
+
+        size_t tasks = 1;
+        if (options.execution == concurrency::Execution::kParallel) {
+            concurrency::ThreadPool& pool = concurrency::DefaultPool();
+            tasks = std::clamp<size_t>(options.tasks_per_thread * (pool.GetNumberOfThreads() + 1), 1,
+                                       std::max<size_t>(cells, 1));
+        }
+
+        std::vector<TraversalStats> task_stats(tasks);
+        auto run = [&](size_t task) {
+            size_t first = cells * task / tasks;
+            size_t last = cells * (task + 1) / tasks;
+            for (size_t cell = first; cell != last; ++cell) {
+                TestCell(cell, options, result, task_stats[task]);
+            }
+        };
+
+        if (tasks == 1) {
+            run(0);
+        } else {
+            concurrency::TaskGroup group;
+            for (size_t task = 0; task != tasks; ++task) {
+                group.Run([&run, task] { run(task); });
+            }
+            group.Wait();
+        }
+
+        if (stats) {
+            *stats = {};
+            for (const auto& task : task_stats) {
+                *stats += task;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Number of occupied cells
+     */
+    size_t GetNumberOfCells() const noexcept {
+        return cell_starts_.empty() ? 0 : cell_starts_.size() - 1;
+    }
+
+    /**
+     * @brief Number of triangle entries over all cells
+     */
+    size_t GetNumberOfEntries() const noexcept {
+        return entry_triangles_.size();
+    }
+
+    double GetCellSize() const noexcept {
+        return cell_size_;
+    }
+
+    /**
+     * @brief Triangles of the occupied cell in [0, GetNumberOfCells()), as positions in the input
+     */
+    std::span<const uint32_t> GetCell(size_t cell) const noexcept {
+        return {entry_triangles_.data() + cell_starts_[cell], entry_triangles_.data() + cell_starts_[cell + 1]};
+    }
+
+private:
+    using CellCoords = std::array<uint32_t, 3>;
+
+    GridOptions options_;
+    std::vector<IndexedTriangle<T>> triangles_;
+    std::vector<AABB<T>> boxes_;
+    // bounds of the grown boxes
+    AABB<T> bounds_;
+    size_t id_capacity_ = 0;
+
+    double cell_size_ = 0;
+    std::array<uint64_t, 3> cells_per_axis_{};
+
+    // first and last cell of every grown triangle box on every axis
+    std::vector<CellCoords> first_cells_;
+    std::vector<CellCoords> last_cells_;
+
+    // the entries sorted by cell, and the start of every occupied cell in them plus the end
+    std::vector<uint64_t> entry_keys_;
+    std::vector<uint32_t> entry_triangles_;
+    std::vector<size_t> cell_starts_;
+
+    /**
+     * @brief Mean of the largest box extent of the triangles, but at least the edge of a cell
+     * that would hold one triangle on average if they were points
+     *
+     * Cells of about the size of a triangle keep both the entries per triangle and the
+     * triangles per cell small; the lower bound keeps tiny triangles from making a cell each.
+     */
+    double EstimateCellSize() const {
+        double sum = 0;
+        for (const auto& box : boxes_) {
+            sum += std::max({static_cast<double>(box.max.x) - box.min.x,
+                             static_cast<double>(box.max.y) - box.min.y,
+                             static_cast<double>(box.max.z) - box.min.z});
+        }
+
+        double volume = 1;
+        size_t flat_axes = 0;
+        for (size_t axis = 0; axis != 3; ++axis) {
+            double extent = static_cast<double>(bounds_.max[axis]) - static_cast<double>(bounds_.min[axis]);
+            if (extent > 0) {
+                volume *= extent;
+            } else {
+                ++flat_axes;
+            }
+        }
+        double per_triangle = (flat_axes == 3) ? 0 : std::pow(volume / boxes_.size(), 1.0 / (3 - flat_axes));
+
+        return std::max(sum / boxes_.size(), per_triangle);
+    }
+
+    uint64_t CellOf(T value, size_t axis) const noexcept {
+        double cell = (static_cast<double>(value) - static_cast<double>(bounds_.min[axis])) / cell_size_;
+        return static_cast<uint64_t>(std::clamp(cell, 0.0, static_cast<double>(kMaxCellsPerAxis - 1)));
+    }
+
+    uint64_t Key(uint64_t x, uint64_t y, uint64_t z) const noexcept {
+        return (z * cells_per_axis_[1] + y) * cells_per_axis_[0] + x;
+    }
+
+    /**
+     * @brief Enters every triangle into its cells: counts the entries of every triangle, lays
+     * them out by the prefix sums, writes them and sorts them by cell
+     */
+    void FillCells() {
+        const size_t n = triangles_.size();
+        const bool parallel = options_.execution == concurrency::Execution::kParallel;
+
+        first_cells_.resize(n);
+        last_cells_.resize(n);
+        std::vector<size_t> offsets(n + 1, 0);
+        concurrency::ForEachChunk(n, parallel, options_.parallel_threshold, [&](size_t first, size_t last) {
+            for (size_t i = first; i != last; ++i) {
+                const AABB<T> box = InflateBounds<T>(boxes_[i]);
+                size_t entries = 1;
+                for (size_t axis = 0; axis != 3; ++axis) {
+                    first_cells_[i][axis] = static_cast<uint32_t>(CellOf(box.min[axis], axis));
+                    last_cells_[i][axis] = static_cast<uint32_t>(CellOf(box.max[axis], axis));
+                    entries *= size_t{last_cells_[i][axis]} - first_cells_[i][axis] + 1;
+                }
+                offsets[i + 1] = entries;
+            }
+        });
+        for (size_t i = 0; i != n; ++i) {
+            offsets[i + 1] += offsets[i];
+        }
+
+        entry_keys_.resize(offsets[n]);
+        entry_triangles_.resize(offsets[n]);
+        concurrency::ForEachChunk(n, parallel, options_.parallel_threshold, [&](size_t first, size_t last) {
+            for (size_t i = first; i != last; ++i) {
+                size_t entry = offsets[i];
+                const auto& from = first_cells_[i];
+                const auto& to = last_cells_[i];
+                for (uint64_t z = from[2]; z <= to[2]; ++z) {
+                    for (uint64_t y = from[1]; y <= to[1]; ++y) {
+                        for (uint64_t x = from[0]; x <= to[0]; ++x) {
+                            entry_keys_[entry] = Key(x, y, z);
+                            entry_triangles_[entry] = static_cast<uint32_t>(i);
+                            ++entry;
+                        }
+                    }
+                }
+            }
+        });
+
+        RadixSortByKey(entry_keys_, entry_triangles_, parallel, options_.parallel_threshold);
+
+        for (size_t entry = 0; entry != entry_keys_.size(); ++entry) {
+            if (entry == 0 || entry_keys_[entry] != entry_keys_[entry - 1]) {
+                cell_starts_.push_back(entry);
+            }
+        }
+        cell_starts_.push_back(entry_keys_.size());
+    }
+
+    void TestCell(size_t cell, const QueryOptions& options, IntersectionResult& result,
+                  TraversalStats& stats) const
+    {
+        const auto triangles = GetCell(cell);
+        const uint64_t key = entry_keys_[cell_starts_[cell]];
+
+        for (size_t a = 0; a != triangles.size(); ++a) {
+            const uint32_t i = triangles[a];
+
+            for (size_t b = a + 1; b != triangles.size(); ++b) {
+                const uint32_t j = triangles[b];
+
+                ++stats.triangle_pairs;
+                ++stats.aabb_tests;
+                if (!AABB<T>::Intersects(boxes_[i], boxes_[j])) {
+                    continue;
+                }
+
+                // the cell of the lower corner of the overlap tests the pair
+                if (Key(std::max(first_cells_[i][0], first_cells_[j][0]),
+                        std::max(first_cells_[i][1], first_cells_[j][1]),
+                        std::max(first_cells_[i][2], first_cells_[j][2])) != key)
+                {
+                    continue;
+                }
+
+                const TrIndex id_i = triangles_[i].id;
+                const TrIndex id_j = triangles_[j].id;
+                if (options.skip_flagged && result.AtomicContains(id_i) && result.AtomicContains(id_j)) {
+                    ++stats.skipped_narrow_phase_tests;
+                    continue;
+                }
+
+                ++stats.narrow_phase_tests;
+                if (Triangle<T>::Intersect(triangles_[i].triangle, triangles_[j].triangle)) {
+                    result.AtomicInsert(id_i);
+                    result.AtomicInsert(id_j);
+                }
+            }
+        }
+    }
+};
+
+} // namespace acceleration
+
+} // namespace geometry
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "node.hpp"
+#include "packed_node.hpp"
+
+namespace geometry {
+
+namespace acceleration {
+
+/**
+ * @brief Slot of the root in a wide node array: lane 0 of node 0, the only used lane of that node
+ *
+ * Wide traversals work on slots, slot s being lane s % kWidth of node s / kWidth, so the root needs
+ * a parent like every other child.
+ */
+inline constexpr NodeIdx kWideRootIdx = 0;
+
+namespace detail {
+
+/**
+ * @brief Bit k set if lane k of the comparison result is set, with movemask where there is one
+ */
+template <typename B, typename Mask>
+[[gnu::always_inline]] inline uint32_t LaneMask(const Mask& lanes) noexcept {
+    constexpr size_t kLanes = sizeof(Mask) / sizeof(B);
+
+#if defined(__SSE2__)
+    if constexpr (std::is_floating_point_v<B> && sizeof(Mask) == 16) {
+        __m128i bits;
+        std::memcpy(&bits, &lanes, sizeof(bits));
+        return (sizeof(B) == 4) ? _mm_movemask_ps(_mm_castsi128_ps(bits)) : _mm_movemask_pd(_mm_castsi128_pd(bits));
+    }
+#endif
+
+    uint32_t mask = 0;
+    for (size_t k = 0; k != kLanes; ++k) {
+        mask |= static_cast<uint32_t>(lanes[k] != 0) << k;
+    }
+    return mask;
+}
+
+} // namespace detail
+
+/**
+ * @brief Node of a BVH with up to kWidth children, their boxes stored as structure of arrays
+ *
+ * The boxes are inflated like those of PackedNode, so that OverlapMask tests one box against all
+ * children with a single compare per bound. Unused lanes hold an empty box, which overlaps
+ * nothing, and no triangles.
+ */
+template <typename B, size_t kWidth>
+requires concepts::Numeric<B>
+struct alignas(32) WideNode {
+    static constexpr uint32_t kInnerChild = std::numeric_limits<uint32_t>::max();
+
+    std::array<B, kWidth> min_x;
+    std::array<B, kWidth> min_y;
+    std::array<B, kWidth> min_z;
+    std::array<B, kWidth> max_x;
+    std::array<B, kWidth> max_y;
+    std::array<B, kWidth> max_z;
+
+    // wide node of an inner child, position of the first triangle of a leaf
+    std::array<uint32_t, kWidth> child{};
+    // number of triangles of a leaf, kInnerChild for an inner child
+    std::array<uint32_t, kWidth> count{};
+
+    WideNode() {
+        for (auto* bound : {&min_x, &min_y, &min_z}) {
+            bound->fill(limits::MaxValue<B>());
+        }
+        for (auto* bound : {&max_x, &max_y, &max_z}) {
+            bound->fill(limits::LowestValue<B>());
+        }
+    }
+
+    void SetChild(size_t lane, const AABB<B>& box, uint32_t index, uint32_t triangles) noexcept {
+        SetAABB(lane, box);
+        child[lane] = index;
+        count[lane] = triangles;
+    }
+
+    void SetAABB(size_t lane, const AABB<B>& box) noexcept {
+        min_x[lane] = box.min.x;
+        min_y[lane] = box.min.y;
+        min_z[lane] = box.min.z;
+        max_x[lane] = box.max.x;
+        max_y[lane] = box.max.y;
+        max_z[lane] = box.max.z;
+    }
+
+    AABB<B> GetAABB(size_t lane) const noexcept {
+        return {Point<B>{min_x[lane], min_y[lane], min_z[lane]}, Point<B>{max_x[lane], max_y[lane], max_z[lane]}};
+    }
+
+    bool IsInner(size_t lane) const noexcept {
+        return count[lane] == kInnerChild;
+    }
+
+    /**
+     * @brief Bit i set if child i overlaps the box in lane of other
+     *
+     * The lanes are compared in 16-byte vectors, which every x86-64 CPU has, without a branch.
+     */
+    uint32_t OverlapMask(const WideNode& other, size_t lane) const noexcept {
+        constexpr size_t kChunk = std::min<size_t>(kWidth, 16 / sizeof(B));
+        typedef B V __attribute__((vector_size(sizeof(B) * kChunk)));
+
+        auto Splat = [](B value) __attribute__((always_inline)) {
+            V v;
+            for (size_t k = 0; k != kChunk; ++k) {
+                v[k] = value;
+            }
+            return v;
+        };
+
+        const V box_lo_x = Splat(other.min_x[lane]);
+        const V box_lo_y = Splat(other.min_y[lane]);
+        const V box_lo_z = Splat(other.min_z[lane]);
+        const V box_hi_x = Splat(other.max_x[lane]);
+        const V box_hi_y = Splat(other.max_y[lane]);
+        const V box_hi_z = Splat(other.max_z[lane]);
+
+        uint32_t mask = 0;
+        for (size_t first = 0; first != kWidth; first += kChunk) {
+            auto Load = [first](const std::array<B, kWidth>& values) __attribute__((always_inline)) {
+                V v;
+                std::memcpy(&v, values.data() + first, sizeof(V));
+                return v;
+            };
+
+            auto overlap = (Load(min_x) <= box_hi_x) & (Load(max_x) >= box_lo_x)
+                         & (Load(min_y) <= box_hi_y) & (Load(max_y) >= box_lo_y)
+                         & (Load(min_z) <= box_hi_z) & (Load(max_z) >= box_lo_z);
+            mask |= detail::LaneMask<B>(overlap) << first;
+        }
+        return mask;
+    }
+};
+
+/**
+ * @brief Collapses the binary tree below root into nodes of up to kWidth children
+ *
+ * Every wide node takes the two children of a binary node and keeps replacing its inner child of
+ * the largest surface area by that child's children while it has a free lane, which removes the
+ * binary levels that save the least. The children keep their left to right order and the nodes
+ * are numbered depth-first, or renumbered in node_order afterwards; every node comes before its
+ * children either way.
+ *
+ * @param triangles The triangle array the leaf spans point into
+ * @param sources If not null, receives the index in nodes of the child in every slot, invalid_idx
+ * for the unused lanes
+ */
+template <typename B, size_t kWidth, typename T>
+std::vector<WideNode<B, kWidth>> CollapseNodes(const std::vector<BVHNode<T>>& nodes, NodeIdx root,
+                                               const IndexedTriangle<T>* triangles,
+                                               NodeOrder node_order = NodeOrder::kDepthFirst,
+                                               std::vector<NodeIdx>* sources = nullptr)
+{
+    static_assert(kWidth >= 2 && kWidth <= 32, "a wide node must have 2 to 32 lanes");
+
+    std::vector<WideNode<B, kWidth>> wide(1);
+
+    // binary node and the wide node and lane it goes to
+    struct Slot {
+        NodeIdx idx;
+        size_t node;
+        size_t lane;
+    };
+
+    std::vector<NodeIdx> slot_sources;
+    std::vector<Slot> stack{{root, 0, 0}};
+    while (!stack.empty()) {
+        Slot slot = stack.back();
+        stack.pop_back();
+
+        slot_sources.resize(wide.size() * kWidth, invalid_idx);
+        slot_sources[slot.node * kWidth + slot.lane] = slot.idx;
+
+        const auto& node = nodes[slot.idx];
+        AABB<B> bounds = InflateBounds<B>(node.GetAABB());
+
+        if (node.IsLeaf()) {
+            wide[slot.node].SetChild(slot.lane, bounds, node.GetTriangles().data() - triangles,
+                                     node.GetNumberOfTriangles());
+            continue;
+        }
+
+        size_t parent = wide.size();
+        wide.emplace_back();
+        wide[slot.node].SetChild(slot.lane, bounds, parent, WideNode<B, kWidth>::kInnerChild);
+
+        std::vector<NodeIdx> children{node.GetLeftIdx(), node.GetRightIdx()};
+        while (children.size() < kWidth) {
+            auto largest = children.end();
+            for (auto it = children.begin(); it != children.end(); ++it) {
+                if (!nodes[*it].IsLeaf() && (largest == children.end()
+                    || nodes[*it].GetAABB().SurfaceArea() > nodes[*largest].GetAABB().SurfaceArea()))
+                {
+                    largest = it;
+                }
+            }
+
+            if (largest == children.end()) {
+                break;
+            }
+
+            NodeIdx split = *largest;
+            *largest = nodes[split].GetLeftIdx();
+            children.insert(largest + 1, nodes[split].GetRightIdx());
+        }
+
+        for (size_t lane = children.size(); lane-- != 0;) {
+            stack.push_back({children[lane], parent, lane});
+        }
+    }
+
+    slot_sources.resize(wide.size() * kWidth, invalid_idx);
+    if (node_order == NodeOrder::kDepthFirst) {
+        if (sources) {
+            *sources = std::move(slot_sources);
+        }
+        return wide;
+    }
+
+    auto inner_children = [&wide](size_t idx, std::vector<size_t>& out) {
+        for (size_t lane = 0; lane != kWidth; ++lane) {
+            if (wide[idx].IsInner(lane)) {
+                out.push_back(wide[idx].child[lane]);
+            }
+        }
+    };
+
+    std::vector<size_t> order = OrderNodes(wide.size(), 0, node_order, inner_children);
+    std::vector<uint32_t> renumbered(wide.size());
+    for (size_t i = 0; i != order.size(); ++i) {
+        renumbered[order[i]] = static_cast<uint32_t>(i);
+    }
+
+    std::vector<WideNode<B, kWidth>> relaid;
+    relaid.reserve(wide.size());
+    if (sources) {
+        sources->clear();
+    }
+
+    for (size_t idx : order) {
+        if (sources) {
+            sources->insert(sources->end(), slot_sources.begin() + idx * kWidth,
+                            slot_sources.begin() + (idx + 1) * kWidth);
+        }
+
+        relaid.push_back(wide[idx]);
+        for (size_t lane = 0; lane != kWidth; ++lane) {
+            if (relaid.back().IsInner(lane)) {
+                relaid.back().child[lane] = renumbered[relaid.back().child[lane]];
+            }
+        }
+    }
+
+    return relaid;
+}
+
+} // namespace acceleration
+
+} // namespace geometry
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "wide_node.hpp"
+#include "pair_traversal.hpp"
+
+namespace geometry {
+
+namespace acceleration {
+
+template <typename B, size_t kWidth>
+const WideNode<B, kWidth>& SlotNode(const WideNode<B, kWidth>* nodes, NodeIdx slot) noexcept {
+    return nodes[static_cast<size_t>(slot) / kWidth];
+}
+
+template <size_t kWidth>
+size_t SlotLane(NodeIdx slot) noexcept {
+    return static_cast<size_t>(slot) % kWidth;
+}
+
+template <typename B, size_t kWidth>
+bool IsInnerSlot(const WideNode<B, kWidth>* nodes, NodeIdx slot) noexcept {
+    return SlotNode(nodes, slot).IsInner(SlotLane<kWidth>(slot));
+}
+
+/**
+ * @brief Calls visit(pair, keep) for every pair the traversal may descend into from the pair of
+ * slots (a, b) of which at least one is inner, keep telling whether the boxes of the pair overlap
+ *
+ * A pair (s, s) stands for all pairs inside the subtree of slot s: its children are visited as
+ * such pairs and every two of them as a pair, each once. Of two different slots the larger one,
+ * by the sum of the box extents, is descended first as in ForEachChildPair. When both are split,
+ * the children of a are first tested against the box of b, and each overlapping one against all
+ * children of b, one OverlapMask each.
+ *
+ * @return the number of box pairs tested
+ */
+template <typename B, size_t kWidth, typename Visit>
+size_t ForEachWideChildPair(const WideNode<B, kWidth>* nodes, NodePair pair, Visit&& visit) {
+    const auto& a_parent = SlotNode(nodes, pair.a);
+    const auto& b_parent = SlotNode(nodes, pair.b);
+    const size_t a_lane = SlotLane<kWidth>(pair.a);
+    const size_t b_lane = SlotLane<kWidth>(pair.b);
+
+    auto First = [](const WideNode<B, kWidth>& parent, size_t lane) {
+        return static_cast<NodeIdx>(parent.child[lane] * kWidth);
+    };
+
+    if (pair.a == pair.b) {
+        const NodeIdx first = First(a_parent, a_lane);
+        const auto& node = nodes[a_parent.child[a_lane]];
+
+        for (size_t i = 0; i != kWidth; ++i) {
+            visit(NodePair{first + static_cast<NodeIdx>(i), first + static_cast<NodeIdx>(i)}, node.count[i] != 0);
+        }
+        for (size_t i = 0; i + 1 != kWidth; ++i) {
+            uint32_t mask = node.OverlapMask(node, i);
+            for (size_t j = i + 1; j != kWidth; ++j) {
+                visit(NodePair{first + static_cast<NodeIdx>(i), first + static_cast<NodeIdx>(j)}, (mask >> j) & 1);
+            }
+        }
+        return kWidth * (kWidth - 1) / 2;
+    }
+
+    bool split_a = a_parent.IsInner(a_lane);
+    bool split_b = b_parent.IsInner(b_lane);
+
+    if (split_a && split_b) {
+        auto a_size = (a_parent.max_x[a_lane] - a_parent.min_x[a_lane]) + (a_parent.max_y[a_lane] - a_parent.min_y[a_lane])
+                    + (a_parent.max_z[a_lane] - a_parent.min_z[a_lane]);
+        auto b_size = (b_parent.max_x[b_lane] - b_parent.min_x[b_lane]) + (b_parent.max_y[b_lane] - b_parent.min_y[b_lane])
+                    + (b_parent.max_z[b_lane] - b_parent.min_z[b_lane]);
+        split_a = 2 * a_size >= b_size;
+        split_b = 2 * b_size >= a_size;
+    }
+
+    if (split_a && split_b) {
+        const NodeIdx a_first = First(a_parent, a_lane);
+        const NodeIdx b_first = First(b_parent, b_lane);
+        const auto& a = nodes[a_parent.child[a_lane]];
+        const auto& b = nodes[b_parent.child[b_lane]];
+
+        // only the children of a that overlap b at all can overlap one of its children
+        uint32_t a_mask = a.OverlapMask(b_parent, b_lane);
+        size_t tests = kWidth;
+        for (; a_mask != 0; a_mask &= a_mask - 1) {
+            size_t i = std::countr_zero(a_mask);
+            uint32_t mask = b.OverlapMask(a, i);
+            tests += kWidth;
+            for (size_t j = 0; j != kWidth; ++j) {
+                visit(NodePair{a_first + static_cast<NodeIdx>(i), b_first + static_cast<NodeIdx>(j)}, (mask >> j) & 1);
+            }
+        }
+        return tests;
+    }
+
+    if (split_a) {
+        const NodeIdx a_first = First(a_parent, a_lane);
+        uint32_t mask = nodes[a_parent.child[a_lane]].OverlapMask(b_parent, b_lane);
+        for (size_t i = 0; i != kWidth; ++i) {
+            visit(NodePair{a_first + static_cast<NodeIdx>(i), pair.b}, (mask >> i) & 1);
+        }
+    } else {
+        const NodeIdx b_first = First(b_parent, b_lane);
+        uint32_t mask = nodes[b_parent.child[b_lane]].OverlapMask(a_parent, a_lane);
+        for (size_t j = 0; j != kWidth; ++j) {
+            visit(NodePair{pair.a, b_first + static_cast<NodeIdx>(j)}, (mask >> j) & 1);
+        }
+    }
+    return kWidth;
+}
+
+/**
+ * @brief Depth-first traversal of all pairs of slots below the pair root of a wide node array
+ *
+ * root is either a self pair (s, s), usually (kWideRootIdx, kWideRootIdx), or a pair of two slots
+ * with overlapping boxes. Runs on an explicit stack like TraverseNodePairs, and the pairs of
+ * ForEachWideChildPair are pushed with PushIf.
+ *
+ * Query provides:
+ * - Stopped(): whether the traversal must end now
+ * - Prune(a, b): whether the pair of slots is known to add nothing
+ * - CountBoxTests(count): called with the number of box pairs of every step
+ * - IntersectLeaves(a, b): exact tests of a pair of leaf slots, or inside one leaf for a == b
+ */
+template <typename B, size_t kWidth, typename Query>
+void TraverseWidePairs(const WideNode<B, kWidth>* nodes, NodePair root, Query& query) {
+    NodePairStack stack;
+    stack.Push(root);
+
+    while (!stack.Empty() && !query.Stopped()) {
+        NodePair pair = stack.Pop();
+        if (query.Prune(pair.a, pair.b)) {
+            continue;
+        }
+
+        if (!IsInnerSlot(nodes, pair.a) && !IsInnerSlot(nodes, pair.b)) {
+            query.IntersectLeaves(pair.a, pair.b);
+            continue;
+        }
+
+        stack.Reserve(kWidth * kWidth);
+        query.CountBoxTests(ForEachWideChildPair(nodes, pair, [&stack](NodePair child, bool keep) {
+            stack.PushIf(child, keep);
+        }));
+    }
+}
+
+} // namespace acceleration
+
+} // namespace geometry
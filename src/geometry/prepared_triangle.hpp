@@ -0,0 +1,290 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <variant>
+#include <algorithm>
+#include <type_traits>
+
+#include "triangle.hpp"
+
+namespace geometry {
+
+/**
+ * @brief Triangle with everything Triangle::Intersect derives from a single triangle computed once
+ *
+ * Holds the type and the degenerate shape, the normal and the plane offset, the edges, the
+ * coefficients of the barycentric Contains test and the projection of the triangle onto its own
+ * normal. PreparedTriangle::Intersect performs the same arithmetic as Triangle::Intersect on
+ * these cached values, so both always return the same result.
+ *
+ * IntersectMoller is an alternative engine for the case of intersecting planes, see Moller.
+ */
+template <typename T>
+requires concepts::Numeric<T>
+class PreparedTriangle {
+public:
+    Triangle<T> triangle;
+    TriangleType type;
+    Shape<T> shape;
+
+    Vector<T> normal;
+    T offset;
+    std::array<Vector<T>, 3> edges;
+
+    explicit PreparedTriangle(const Triangle<T>& t)
+        : triangle(t),
+          type(t.DetermineType()),
+          shape(t.MakeShape()),
+          normal(t.CalculateNormal()),
+          offset(-Vector<T>::Dot(normal, t.p0_.AsVector())),
+          edges{t.p1_ - t.p0_, t.p2_ - t.p1_, t.p0_ - t.p2_},
+          normal_axis_(normal.Normalized()),
+          skip_normal_axis_(normal.Length() < constants::kEpsilon),
+          normal_projection_(ProjectOnUnit(normal_axis_)),
+          to_p2_(t.p2_ - t.p0_),
+          uu_(Vector<T>::Dot(edges[0], edges[0])),
+          uv_(Vector<T>::Dot(edges[0], to_p2_)),
+          vv_(Vector<T>::Dot(to_p2_, to_p2_)),
+          denom_(uv_ * uv_ - uu_ * vv_),
+          magnitude_(std::max({std::abs(t.p0_.x), std::abs(t.p0_.y), std::abs(t.p0_.z),
+                               std::abs(t.p1_.x), std::abs(t.p1_.y), std::abs(t.p1_.z),
+                               std::abs(t.p2_.x), std::abs(t.p2_.y), std::abs(t.p2_.z)}))
+    {}
+
+    /**
+     * @brief Same result as Triangle::Intersect(t1.triangle, t2.triangle)
+     */
+    static bool Intersect(const PreparedTriangle& t1, const PreparedTriangle& t2) {
+        return IntersectWith<Sat>(t1, t2);
+    }
+
+    /**
+     * @brief Same result as Intersect, with the SAT of triangles in intersecting planes replaced
+     * by the Moller test
+     */
+    static bool IntersectMoller(const PreparedTriangle& t1, const PreparedTriangle& t2) {
+        return IntersectWith<Moller>(t1, t2);
+    }
+
+    /**
+     * @brief Moller interval test for two triangles in intersecting planes, same result as Sat
+     *
+     * A triangle whose vertices are all on one side of the other plane is rejected; otherwise
+     * both triangles cross the line where the planes meet, and they intersect if their intervals
+     * on that line overlap. Every decision is taken with a margin covering kEpsilon and the
+     * rounding errors, which makes it agree with Sat; the rare pairs that touch a plane or whose
+     * intervals do not overlap clearly are decided by Sat.
+     */
+    static bool Moller(const PreparedTriangle& a, const PreparedTriangle& b) {
+        T rounding = kRoundingFactor * (1 + std::max(a.magnitude_, b.magnitude_));
+        T tolerance = constants::kEpsilon + rounding;
+
+        auto b_distances = a.SignedDistances(b);
+        if (AllOnOneSide(b_distances, tolerance)) {
+            return false;
+        }
+
+        auto a_distances = b.SignedDistances(a);
+        if (AllOnOneSide(a_distances, tolerance)) {
+            return false;
+        }
+
+        if (TouchesPlane(a_distances, tolerance) || TouchesPlane(b_distances, tolerance)) {
+            return Sat(a, b);
+        }
+
+        Vector<T> direction = Vector<T>::Cross(a.normal, b.normal);
+        auto a_interval = a.LineInterval(a_distances, direction, rounding);
+        auto b_interval = b.LineInterval(b_distances, direction, rounding);
+
+        T overlap = std::min(a_interval.high, b_interval.high) - std::max(a_interval.low, b_interval.low);
+        if (overlap > a_interval.error + b_interval.error) {
+            return true;
+        }
+
+        return Sat(a, b);
+    }
+
+    /**
+     * @brief Triangle::Sat with cached normals, edges and self projections
+     *
+     * Every candidate axis is normalized once for both triangles instead of once per projection.
+     */
+    static bool Sat(const PreparedTriangle& a, const PreparedTriangle& b) {
+        auto Overlap = [](const std::pair<T, T>& pa, const std::pair<T, T>& pb) {
+            return !(pa.second < pb.first - constants::kEpsilon || pb.second < pa.first - constants::kEpsilon);
+        };
+
+        if (!a.skip_normal_axis_ && !Overlap(a.normal_projection_, b.ProjectOnUnit(a.normal_axis_))) {
+            return false;
+        }
+
+        if (!b.skip_normal_axis_ && !Overlap(a.ProjectOnUnit(b.normal_axis_), b.normal_projection_)) {
+            return false;
+        }
+
+        for (size_t i = 0; i != 9; ++i) {
+            Vector<T> axis = Vector<T>::Cross(a.edges[i / 3], b.edges[i % 3]);
+            if (axis.Length() < constants::kEpsilon) {
+                continue;
+            }
+
+            Vector<T> unit = axis.Normalized();
+            if (!Overlap(a.ProjectOnUnit(unit), b.ProjectOnUnit(unit))) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static PlanesPosition RelativePlanesPosition(const PreparedTriangle& t1, const PreparedTriangle& t2) {
+        if (!t1.normal.Collinear(t2.normal)) {
+            return PlanesPosition::kIntersect;
+        }
+
+        T distance_between_planes = (Vector<T>::Dot(t1.normal, t2.normal) > 0)
+            ? std::abs(t1.offset - t2.offset)
+            : std::abs(t1.offset + t2.offset);
+
+        return distance_between_planes < constants::kEpsilon
+            ? PlanesPosition::kCoincide
+            : PlanesPosition::kParallel;
+    }
+
+    /**
+     * @brief Triangle::Contains with the cached barycentric coefficients
+     */
+    bool Contains(const Point<T>& p) const {
+        Vector<T> W = p - triangle.p0_;
+
+        T WU = Vector<T>::Dot(W, edges[0]);
+        T WV = Vector<T>::Dot(W, to_p2_);
+
+        T beta = (uv_ * WV - vv_ * WU) / denom_;
+        T gamma = (uv_ * WU - uu_ * WV) / denom_;
+        T alpha = 1 - beta - gamma;
+
+        return alpha >= -constants::kEpsilon && beta >= -constants::kEpsilon
+            && gamma >= -constants::kEpsilon;
+    }
+
+    bool Contains(const PreparedTriangle& other) const {
+        return Contains(other.triangle.p0_) && Contains(other.triangle.p1_) && Contains(other.triangle.p2_);
+    }
+
+    /**
+     * @brief Projection interval of the triangle onto an already normalized axis
+     */
+    std::pair<T, T> ProjectOnUnit(const Vector<T>& unit) const {
+        T p0 = Vector<T>::Dot(triangle.p0_.AsVector(), unit);
+        T p1 = Vector<T>::Dot(triangle.p1_.AsVector(), unit);
+        T p2 = Vector<T>::Dot(triangle.p2_.AsVector(), unit);
+
+        return {std::min({p0, p1, p2}), std::max({p0, p1, p2})};
+    }
+
+private:
+    static constexpr T kRoundingFactor = 1024 * (std::is_floating_point_v<T> ? std::numeric_limits<T>::epsilon() : 0);
+
+    template <bool (*Test)(const PreparedTriangle&, const PreparedTriangle&)>
+    static bool IntersectWith(const PreparedTriangle& t1, const PreparedTriangle& t2) {
+        if (t1.type != TriangleType::kNormal || t2.type != TriangleType::kNormal) {
+            return std::visit([](const auto& s1, const auto& s2) {
+                return Triangle<T>::Intersect(s1, s2);
+            }, t1.shape, t2.shape);
+        }
+
+        auto relative_planes_position = RelativePlanesPosition(t1, t2);
+
+        if (relative_planes_position == PlanesPosition::kParallel) {
+            return false;
+        }
+
+        if (relative_planes_position == PlanesPosition::kCoincide) {
+            const Triangle<T>& a = t1.triangle;
+            const Triangle<T>& b = t2.triangle;
+            Segment<T> edges1[] {{a.p0_, a.p1_}, {a.p0_, a.p2_}, {a.p1_, a.p2_}};
+            Segment<T> edges2[] {{b.p0_, b.p1_}, {b.p0_, b.p2_}, {b.p1_, b.p2_}};
+
+            return Segment<T>::Intersect(edges1, edges2) || t1.Contains(t2) || t2.Contains(t1);
+        }
+
+        return Test(t1, t2);
+    }
+
+    struct LineIntervalResult {
+        T low;
+        T high;
+        T error;
+    };
+
+    /**
+     * @brief Signed distances of the vertices of other to the plane of this triangle
+     */
+    std::array<T, 3> SignedDistances(const PreparedTriangle& other) const {
+        return {
+            Vector<T>::Dot(normal, other.triangle.p0_.AsVector()) + offset,
+            Vector<T>::Dot(normal, other.triangle.p1_.AsVector()) + offset,
+            Vector<T>::Dot(normal, other.triangle.p2_.AsVector()) + offset,
+        };
+    }
+
+    static bool AllOnOneSide(const std::array<T, 3>& d, T tolerance) {
+        return (d[0] > tolerance && d[1] > tolerance && d[2] > tolerance)
+            || (d[0] < -tolerance && d[1] < -tolerance && d[2] < -tolerance);
+    }
+
+    static bool TouchesPlane(const std::array<T, 3>& d, T tolerance) {
+        return std::abs(d[0]) <= tolerance || std::abs(d[1]) <= tolerance || std::abs(d[2]) <= tolerance;
+    }
+
+    /**
+     * @brief Interval of the triangle on the line of direction where it crosses the other plane
+     *
+     * distances are the signed distances of the vertices to the other plane: none is zero and
+     * exactly one vertex is alone on its side. The error bounds the effect of the rounding of the
+     * distances on the interpolated ends.
+     */
+    LineIntervalResult LineInterval(const std::array<T, 3>& distances, const Vector<T>& direction,
+                                    T rounding) const
+    {
+        std::array<T, 3> projections {
+            Vector<T>::Dot(triangle.p0_.AsVector(), direction),
+            Vector<T>::Dot(triangle.p1_.AsVector(), direction),
+            Vector<T>::Dot(triangle.p2_.AsVector(), direction),
+        };
+
+        size_t k = ((distances[0] > 0) == (distances[1] > 0)) ? 2
+                 : ((distances[0] > 0) == (distances[2] > 0)) ? 1
+                 : 0;
+
+        T ends[2];
+        T error = 4 * rounding * direction.Length();
+        for (size_t i = 1; i != 3; ++i) {
+            size_t j = (k + i) % 3;
+            T delta = projections[j] - projections[k];
+            T span = distances[k] - distances[j];
+            ends[i - 1] = projections[k] + delta * distances[k] / span;
+            error += 4 * std::abs(delta) * rounding / std::abs(span);
+        }
+
+        return {std::min(ends[0], ends[1]), std::max(ends[0], ends[1]), error};
+    }
+
+    Vector<T> normal_axis_;
+    bool skip_normal_axis_;
+    std::pair<T, T> normal_projection_;
+
+    Vector<T> to_p2_;
+    T uu_;
+    T uv_;
+    T vv_;
+    T denom_;
+    T magnitude_;
+};
+
+} // namespace geometry
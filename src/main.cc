@@ -1,16 +1,64 @@
+#include <fstream>
 #include <iostream>
 #include <stdexcept>
 
 #include "bvh.hpp"
+#include "options.hpp"
+#include "uniform_grid.hpp"
+#include "sweep_and_prune.hpp"
 #include "parse_input.hpp"
+#include "binary_input.hpp"
+#include "pair_output.hpp"
 
 using Type = double;
 
-int main() {
+int main(int argc, char** argv) {
     try {
-        geometry::acceleration::BVH tree{app::ParseInput<Type>(std::cin)};
+        app::Options options = app::ParseOptions(argc, argv);
+
+        if (options.engine != app::Engine::kBvh) {
+            auto triangles = options.binary_input.empty()
+                ? app::ParseInput<Type>(std::cin)
+                : app::ReadBinaryInput<Type>(options.binary_input);
+            auto answer = (options.engine == app::Engine::kGrid)
+                ? geometry::acceleration::UniformGrid<Type>{std::move(triangles)}.FindIntersectingTriangles()
+                : geometry::acceleration::SweepAndPrune<Type>{std::move(triangles)}.FindIntersectingTriangles();
+            for (const auto& id : answer) {
+                std::cout << id << "\n";
+            }
+            return 0;
+        }
+
+        using Tree = geometry::acceleration::BVH<Type>;
+        Tree tree = !options.tree.empty()
+            ? Tree::Map(options.tree)
+            : Tree{
+                options.binary_input.empty()
+                    ? app::ParseInput<Type>(std::cin)
+                    : app::ReadBinaryInput<Type>(options.binary_input)
+            };
+
+        if (!options.save_tree.empty()) {
+            std::ofstream file(options.save_tree, std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Output error: cannot open " + options.save_tree);
+            }
+            tree.Save(file);
+        }
+
+        if (options.any) {
+            std::cout << tree.HasIntersections() << "\n";
+            return 0;
+        }
+
+        if (options.pairs != app::PairsFormat::kNone) {
+            app::WriteIntersectingPairs(tree, std::cout, options.pairs, options.limit);
+            return 0;
+        }
     
-        auto answer = tree.FindIntersectingTriangles();
+        auto answer = (options.limit == app::kNoLimit)
+            ? tree.FindIntersectingTriangles({.skip_flagged = true})
+            : tree.FindFirstIntersectingTriangles(options.limit);
         for (const auto& id : answer) {
             std::cout << id << "\n";
         }
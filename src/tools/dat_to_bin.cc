@@ -0,0 +1,43 @@
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "parse_input.hpp"
+#include "binary_input.hpp"
+
+// Converts the text input format into the binary one:
+//     dat_to_bin <input.dat> <output.bin> [--float32]
+
+int main(int argc, char** argv) {
+    try {
+        std::vector<std::string> args(argv, argv + argc);
+        if (args.size() != 3 && !(args.size() == 4 && args[3] == "--float32")) {
+            throw std::runtime_error("Usage: dat_to_bin <input.dat> <output.bin> [--float32]");
+        }
+
+        std::ifstream input(args[1]);
+        if (!input.is_open()) {
+            throw std::runtime_error("Cannot open file: " + args[1]);
+        }
+
+        auto triangles = app::ParseInput<double>(input);
+
+        std::ofstream output(args[2], std::ios::binary);
+        if (!output.is_open()) {
+            throw std::runtime_error("Cannot open file: " + args[2]);
+        }
+
+        app::WriteBinaryInput<double>(
+            output,
+            triangles,
+            args.size() == 4 ? app::ScalarType::kFloat32 : app::ScalarType::kFloat64
+        );
+
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,99 @@
+#include <chrono>
+#include <ctime>
+#include <random>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <iostream>
+
+#include "bvh.hpp"
+
+namespace {
+
+using geometry::Point;
+using geometry::Triangle;
+using geometry::acceleration::BVH;
+using geometry::acceleration::SplitMethod;
+using geometry::acceleration::BuildOptions;
+using geometry::acceleration::IndexedTriangle;
+
+/**
+ * Triangles spread uniformly over [-100, 100]^3, as in the traversal benchmark
+ */
+std::vector<IndexedTriangle<double>> MakeTriangles(size_t n, double size) {
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> center(-100, 100);
+    std::uniform_real_distribution<double> offset(-size, size);
+
+    std::vector<IndexedTriangle<double>> triangles;
+    triangles.reserve(n);
+    for (size_t i = 0; i != n; ++i) {
+        Point<double> c{center(gen), center(gen), center(gen)};
+        auto p = [&] { return Point<double>{c.x + offset(gen), c.y + offset(gen), c.z + offset(gen)}; };
+        triangles.emplace_back(i, Triangle<double>{p(), p(), p()});
+    }
+
+    return triangles;
+}
+
+const char* Name(SplitMethod split_method) {
+    switch (split_method) {
+        case SplitMethod::kMedian: return "median";
+        case SplitMethod::kSah:    return "sah";
+        case SplitMethod::kLbvh:   return "lbvh";
+    }
+    return "";
+}
+
+} // namespace
+
+/**
+ * Build time against query time of every builder, serial and parallel
+ *
+ * Build times are wall clock, as the parallel builds run on several threads; query times are
+ * processor time of the serial query, like in the traversal benchmark.
+ */
+int main(int argc, char** argv) {
+    size_t n = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    double size = (argc > 2) ? std::strtod(argv[2], nullptr) : 1.0;
+    size_t runs = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : 3;
+
+    const auto triangles = MakeTriangles(n, size);
+    std::cout << "triangles: " << n << ", threads: " << std::thread::hardware_concurrency() << "\n";
+
+    for (SplitMethod split_method : {SplitMethod::kMedian, SplitMethod::kSah, SplitMethod::kLbvh}) {
+        for (auto execution : {concurrency::Execution::kSerial, concurrency::Execution::kParallel}) {
+            BuildOptions options{.split_method = split_method, .execution = execution};
+
+            double best_build = 0;
+            double best_query = 0;
+            double sah_cost = 0;
+            size_t found = 0;
+            for (size_t run = 0; run != runs; ++run) {
+                auto copy = triangles;
+
+                auto start = std::chrono::steady_clock::now();
+                BVH<double> bvh(std::move(copy), options);
+                auto end = std::chrono::steady_clock::now();
+                double build = std::chrono::duration<double, std::milli>(end - start).count();
+
+                std::clock_t query_start = std::clock();
+                found = bvh.FindIntersectingTriangles().size();
+                std::clock_t query_end = std::clock();
+                double query = 1000.0 * (query_end - query_start) / CLOCKS_PER_SEC;
+
+                best_build = (run == 0) ? build : std::min(best_build, build);
+                best_query = (run == 0) ? query : std::min(best_query, query);
+                sah_cost = bvh.GetSahCost();
+            }
+
+            std::cout << Name(split_method)
+                      << (execution == concurrency::Execution::kParallel ? " parallel" : " serial")
+                      << ": build " << best_build << " ms, query " << best_query << " ms"
+                      << " (best of " << runs << "), SAH cost " << sah_cost << ", intersecting " << found << "\n";
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <ctime>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include "bvh.hpp"
+#include "uniform_grid.hpp"
+#include "parse_input.hpp"
+#include "sweep_and_prune.hpp"
+
+namespace {
+
+using geometry::Point;
+using geometry::Triangle;
+using geometry::acceleration::BVH;
+using geometry::acceleration::UniformGrid;
+using geometry::acceleration::SweepAndPrune;
+using geometry::acceleration::IndexedTriangle;
+using geometry::acceleration::IntersectionResult;
+
+/**
+ * Triangles along a pipe of the given length on x and of radius 5 around it
+ */
+std::vector<IndexedTriangle<double>> MakePipe(size_t n, double length) {
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> along(0, length);
+    std::uniform_real_distribution<double> across(-5, 5);
+    std::uniform_real_distribution<double> offset(-1, 1);
+
+    std::vector<IndexedTriangle<double>> triangles;
+    triangles.reserve(n);
+    for (size_t i = 0; i != n; ++i) {
+        Point<double> c{along(gen), across(gen), across(gen)};
+        auto p = [&] { return Point<double>{c.x + offset(gen), c.y + offset(gen), c.z + offset(gen)}; };
+        triangles.emplace_back(i, Triangle<double>{p(), p(), p()});
+    }
+
+    return triangles;
+}
+
+/**
+ * Best build and query time of the engine over the runs, the build in wall clock, the serial
+ * query in processor time, as in the build benchmark
+ */
+template <typename Engine>
+IntersectionResult Measure(const char* name, const std::vector<IndexedTriangle<double>>& triangles, size_t runs) {
+    double best_build = 0;
+    double best_query = 0;
+    IntersectionResult result(0);
+    for (size_t run = 0; run != runs; ++run) {
+        auto copy = triangles;
+
+        auto start = std::chrono::steady_clock::now();
+        Engine engine{std::move(copy)};
+        auto end = std::chrono::steady_clock::now();
+        double build = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::clock_t query_start = std::clock();
+        result = engine.FindIntersectingTriangles();
+        std::clock_t query_end = std::clock();
+        double query = 1000.0 * (query_end - query_start) / CLOCKS_PER_SEC;
+
+        best_build = (run == 0) ? build : std::min(best_build, build);
+        best_query = (run == 0) ? query : std::min(best_query, query);
+    }
+
+    std::cout << "  " << name << ": build " << best_build << " ms, query " << best_query << " ms"
+              << ", intersecting " << result.size() << "\n";
+    return result;
+}
+
+bool Compare(const char* input, const std::vector<IndexedTriangle<double>>& triangles, size_t runs) {
+    std::cout << input << " (" << triangles.size() << " triangles, best of " << runs << ")\n";
+
+    auto bvh = Measure<BVH<double>>("bvh", triangles, runs);
+    auto grid = Measure<UniformGrid<double>>("grid", triangles, runs);
+    auto sap = Measure<SweepAndPrune<double>>("sap", triangles, runs);
+
+    if (!(grid == bvh) || !(sap == bvh)) {
+        std::cerr << "Engines disagree on " << input << "\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+/**
+ * Build and query time of the BVH, the uniform grid and sweep and prune, on the e2e datasets and
+ * on a pipe of triangles stretched along one axis, which sweep and prune is meant for
+ */
+int main(int argc, char** argv) {
+    size_t n = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    double length = (argc > 2) ? std::strtod(argv[2], nullptr) : 100000.0;
+    size_t runs = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : 3;
+
+    bool agree = true;
+    for (int i = 1; i <= 10; ++i) {
+        std::string name = std::to_string(i) + ".dat";
+        std::ifstream file(std::string(TEST_DATA_DIR) + "/" + name);
+        agree = Compare(name.c_str(), app::ParseInput<double>(file), runs) && agree;
+    }
+    agree = Compare("pipe", MakePipe(n, length), runs) && agree;
+
+    return agree ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+
+#include "aabb.hpp"
+#include "prepared_triangle.hpp"
+
+namespace {
+
+using geometry::Point;
+using geometry::Triangle;
+using geometry::PreparedTriangle;
+
+/**
+ * Random triangle pairs with overlapping boxes, the pairs that reach the narrow phase of the BVH
+ */
+std::vector<std::pair<Triangle<double>, Triangle<double>>> MakePairs(size_t n) {
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> center(-100, 100);
+    std::uniform_real_distribution<double> offset(-1, 1);
+
+    std::vector<std::pair<Triangle<double>, Triangle<double>>> pairs;
+    while (pairs.size() != n) {
+        Point<double> c{center(gen), center(gen), center(gen)};
+        auto p = [&] { return Point<double>{c.x + offset(gen), c.y + offset(gen), c.z + offset(gen)}; };
+
+        Triangle<double> a{p(), p(), p()};
+        Triangle<double> b{p(), p(), p()};
+
+        if (geometry::AABB<double>::Intersects(geometry::AABB<double>(a), geometry::AABB<double>(b))) {
+            pairs.emplace_back(a, b);
+        }
+    }
+
+    return pairs;
+}
+
+template <typename Test>
+void Measure(const char* name, size_t n, Test&& test) {
+    auto start = std::chrono::steady_clock::now();
+    size_t hits = test();
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / n;
+    std::cout << name << ": " << ns << " ns/pair, " << hits << " intersecting\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t n = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    auto pairs = MakePairs(n);
+
+    std::vector<std::pair<PreparedTriangle<double>, PreparedTriangle<double>>> prepared;
+    prepared.reserve(n);
+    for (const auto& [a, b] : pairs) {
+        prepared.emplace_back(PreparedTriangle<double>(a), PreparedTriangle<double>(b));
+    }
+
+    Measure("Triangle::Intersect", n, [&] {
+        size_t hits = 0;
+        for (const auto& [a, b] : pairs) {
+            hits += Triangle<double>::Intersect(a, b);
+        }
+        return hits;
+    });
+
+    Measure("PreparedTriangle::Intersect (SAT)", n, [&] {
+        size_t hits = 0;
+        for (const auto& [a, b] : prepared) {
+            hits += PreparedTriangle<double>::Intersect(a, b);
+        }
+        return hits;
+    });
+
+    Measure("PreparedTriangle::IntersectMoller", n, [&] {
+        size_t hits = 0;
+        for (const auto& [a, b] : prepared) {
+            hits += PreparedTriangle<double>::IntersectMoller(a, b);
+        }
+        return hits;
+    });
+
+    return 0;
+}
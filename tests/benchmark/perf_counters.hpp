@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <utility>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+namespace benchmark {
+
+/**
+ * @brief Hardware cache miss counters of the calling thread, read with perf_event_open
+ *
+ * The counters exclude the kernel, so they open with the default perf_event_paranoid. Machines
+ * without a PMU, most virtual ones, have no such events: Available() is then false and Error()
+ * tells why.
+ */
+class CacheCounters final {
+public:
+    enum Event {
+        kL1DataMisses,
+        kLastLevelMisses,
+        kNumberOfEvents,
+    };
+
+    CacheCounters() {
+#if defined(__linux__)
+        const std::array<std::pair<uint32_t, uint64_t>, kNumberOfEvents> events{{
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                 | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        }};
+
+        for (size_t i = 0; i != kNumberOfEvents; ++i) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = events[i].first;
+            attr.config = events[i].second;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+
+            fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fds_[i] < 0) {
+                error_ = std::strerror(errno);
+                Close();
+                return;
+            }
+        }
+#else
+        error_ = "not supported on this platform";
+#endif
+    }
+
+    CacheCounters(const CacheCounters&) = delete;
+    CacheCounters& operator=(const CacheCounters&) = delete;
+
+    ~CacheCounters() {
+        Close();
+    }
+
+    bool Available() const noexcept {
+        return error_.empty();
+    }
+
+    const std::string& Error() const noexcept {
+        return error_;
+    }
+
+    void Start() {
+#if defined(__linux__)
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    /**
+     * @brief Stops counting and returns the counts since Start, zeros if not available
+     */
+    std::array<uint64_t, kNumberOfEvents> Stop() {
+        std::array<uint64_t, kNumberOfEvents> counts{};
+#if defined(__linux__)
+        for (size_t i = 0; i != kNumberOfEvents; ++i) {
+            if (fds_[i] >= 0) {
+                ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+                if (read(fds_[i], &counts[i], sizeof(counts[i])) != sizeof(counts[i])) {
+                    counts[i] = 0;
+                }
+            }
+        }
+#endif
+        return counts;
+    }
+
+private:
+    void Close() {
+#if defined(__linux__)
+        for (int& fd : fds_) {
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+#endif
+    }
+
+    std::array<int, kNumberOfEvents> fds_{-1, -1};
+    std::string error_;
+};
+
+} // namespace benchmark
@@ -0,0 +1,101 @@
+#include <array>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+
+#include "bvh.hpp"
+#include "perf_counters.hpp"
+
+namespace {
+
+using geometry::Point;
+using geometry::Triangle;
+using geometry::acceleration::BVH;
+using geometry::acceleration::NodeBounds;
+using geometry::acceleration::NodeOrder;
+using geometry::acceleration::IndexedTriangle;
+using geometry::acceleration::TraversalStats;
+
+/**
+ * Triangles spread uniformly over [-100, 100]^3 like tests/e2e/test_data/10.dat, with their size
+ * shrunk so that n of them overlap about as sparsely as in a real scene
+ */
+std::vector<IndexedTriangle<double>> MakeTriangles(size_t n, double size) {
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> center(-100, 100);
+    std::uniform_real_distribution<double> offset(-size, size);
+
+    std::vector<IndexedTriangle<double>> triangles;
+    triangles.reserve(n);
+    for (size_t i = 0; i != n; ++i) {
+        Point<double> c{center(gen), center(gen), center(gen)};
+        auto p = [&] { return Point<double>{c.x + offset(gen), c.y + offset(gen), c.z + offset(gen)}; };
+        triangles.emplace_back(i, Triangle<double>{p(), p(), p()});
+    }
+
+    return triangles;
+}
+
+NodeOrder ParseNodeOrder(const std::string& name) {
+    if (name == "bfs") {
+        return NodeOrder::kBreadthFirst;
+    }
+    if (name == "veb") {
+        return NodeOrder::kVanEmdeBoas;
+    }
+    return NodeOrder::kDepthFirst;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t n = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    double size = (argc > 2) ? std::strtod(argv[2], nullptr) : 1.0;
+    size_t runs = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : 5;
+    bool float_bounds = (argc > 4) && std::string(argv[4]) == "float";
+    size_t branching_factor = (argc > 5) ? std::strtoull(argv[5], nullptr, 10) : 2;
+    std::string node_order = (argc > 6) ? argv[6] : "dfs";
+
+    BVH<double> bvh(MakeTriangles(n, size), {.node_bounds = float_bounds ? NodeBounds::kFloat : NodeBounds::kNative,
+                                             .branching_factor = branching_factor,
+                                             .node_order = ParseNodeOrder(node_order)});
+
+    double best = 0;
+    size_t found = 0;
+    TraversalStats stats;
+    benchmark::CacheCounters counters;
+    std::array<uint64_t, benchmark::CacheCounters::kNumberOfEvents> misses{};
+    for (size_t run = 0; run != runs; ++run) {
+        // processor time, so that the numbers do not depend on the other load of the machine
+        std::clock_t start = std::clock();
+        counters.Start();
+        found = bvh.FindIntersectingTriangles({}, &stats).size();
+        auto counts = counters.Stop();
+        std::clock_t end = std::clock();
+
+        double ms = 1000.0 * (end - start) / CLOCKS_PER_SEC;
+        if (run == 0 || ms < best) {
+            best = ms;
+            misses = counts;
+        }
+    }
+
+    std::cout << "triangles: " << n << ", intersecting: " << found
+              << ", node bounds: " << (float_bounds ? "float" : "double")
+              << ", branching factor: " << branching_factor << ", node order: " << node_order << "\n"
+              << "query: " << best << " ms of CPU time (best of " << runs << ")\n"
+              << "aabb tests: " << stats.aabb_tests << ", triangle pairs: " << stats.triangle_pairs
+              << ", narrow phase tests: " << stats.narrow_phase_tests << "\n";
+
+    if (counters.Available()) {
+        std::cout << "L1 data misses: " << misses[benchmark::CacheCounters::kL1DataMisses]
+                  << ", last level misses: " << misses[benchmark::CacheCounters::kLastLevelMisses] << "\n";
+    } else {
+        std::cout << "cache misses: not counted, " << counters.Error() << "\n";
+    }
+
+    return 0;
+}
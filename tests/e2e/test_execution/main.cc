@@ -1,10 +1,10 @@
 #include <vector>
-#include <sstream>
 #include <fstream>
 
 #include "triangle.hpp"
 #include "bvh.hpp"
 #include "indexed_triangle.hpp"
+#include "parse_input.hpp"
 
 namespace {
 
@@ -14,48 +14,7 @@ std::vector<geometry::acceleration::IndexedTriangle<double>> ReadTrianglesFromFi
         throw std::runtime_error("File opening error");
     }
 
-    std::string line;
-
-    std::getline(file, line);
-    std::stringstream ss(line);
-    size_t number_of_triangles = 0;
-    ss >> number_of_triangles;
-
-    std::vector<geometry::acceleration::IndexedTriangle<double>> triangles;
-    triangles.reserve(number_of_triangles);
-
-    geometry::acceleration::TrIndex id = 0;
-    while (std::getline(file, line)) {
-        if (line.empty() || line[0] == '#') {
-            continue;
-        }
-
-        std::vector<double> points;
-        std::stringstream ss(line);
-        double value = 0;
-
-        while (ss >> value) {
-            points.push_back(value);
-        }
-
-        if (points.size() != 9) {
-            throw std::runtime_error(
-                "Invalid line, expected 9 numbers, got "
-                + std::to_string(points.size()) + ": " + line
-            );
-        }
-
-        triangles.emplace_back(
-            id++,
-            geometry::Triangle{
-                geometry::Point{points[0], points[1], points[2]},
-                geometry::Point{points[3], points[4], points[5]},
-                geometry::Point{points[6], points[7], points[8]}
-            }
-        );
-    }
-
-    return triangles;
+    return app::ParseInput<double>(file);
 }
 
 } // namespace
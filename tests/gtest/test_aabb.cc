@@ -284,3 +284,27 @@ TEST_F(AABBTest, ExpandWithDegenerate) {
     EXPECT_DOUBLE_EQ(normal.min.x, 0);  
     EXPECT_DOUBLE_EQ(normal.max.x, 2);  
 }
+
+// SurfaceArea -------------------------------------------------------------------------------------
+
+TEST_F(AABBTest, SurfaceAreaUnitCube) {
+    EXPECT_DOUBLE_EQ(aabb1.SurfaceArea(), 6);
+}
+
+TEST_F(AABBTest, SurfaceAreaBox) {
+    AABB<double> box(Point<double>(0, 0, 0), Point<double>(1, 2, 3));
+
+    EXPECT_DOUBLE_EQ(box.SurfaceArea(), 22);
+}
+
+TEST_F(AABBTest, SurfaceAreaFlatBox) {
+    AABB<double> flat(Point<double>(0, 0, 0), Point<double>(2, 3, 0));
+
+    EXPECT_DOUBLE_EQ(flat.SurfaceArea(), 12);
+}
+
+TEST_F(AABBTest, SurfaceAreaEmpty) {
+    AABB<double> empty;
+
+    EXPECT_DOUBLE_EQ(empty.SurfaceArea(), 0);
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "binary_input.hpp"
+
+using namespace geometry;
+using namespace geometry::acceleration;
+
+class BinaryInputTest : public ::testing::Test {
+protected:
+    std::vector<IndexedTriangle<double>> triangles {
+        IndexedTriangle<double>(0, {Point<double>{0,0,0}, Point<double>{1,0,0}, Point<double>{0,1,0}}),
+        IndexedTriangle<double>(1, {Point<double>{0.1,-2.5,3}, Point<double>{4,5.25,-6}, Point<double>{7,8,9.5}})
+    };
+
+    std::string filename = (std::filesystem::temp_directory_path() / "triangles_binary_input_test.bin").string();
+
+    void TearDown() override {
+        std::filesystem::remove(filename);
+    }
+
+    void Write(app::ScalarType scalar_type) {
+        std::ofstream file(filename, std::ios::binary);
+        app::WriteBinaryInput<double>(file, triangles, scalar_type);
+    }
+};
+
+// Round trip --------------------------------------------------------------------------------------
+
+TEST_F(BinaryInputTest, RoundTripFloat64) {
+    Write(app::ScalarType::kFloat64);
+
+    auto result = app::ReadBinaryInput<double>(filename);
+
+    ASSERT_EQ(result.size(), triangles.size());
+    for (size_t i = 0; i != triangles.size(); ++i) {
+        EXPECT_EQ(result[i].id, i);
+        for (size_t v = 0; v != 3; ++v) {
+            EXPECT_EQ(result[i].triangle[v].x, triangles[i].triangle[v].x);
+            EXPECT_EQ(result[i].triangle[v].y, triangles[i].triangle[v].y);
+            EXPECT_EQ(result[i].triangle[v].z, triangles[i].triangle[v].z);
+        }
+    }
+}
+
+TEST_F(BinaryInputTest, RoundTripFloat32) {
+    Write(app::ScalarType::kFloat32);
+
+    EXPECT_EQ(std::filesystem::file_size(filename), sizeof(app::BinaryHeader) + 2 * 9 * sizeof(float));
+
+    auto result = app::ReadBinaryInput<double>(filename);
+
+    ASSERT_EQ(result.size(), triangles.size());
+    EXPECT_DOUBLE_EQ(result[1].triangle[0].x, static_cast<float>(0.1));
+    EXPECT_DOUBLE_EQ(result[1].triangle[1].y, 5.25);
+}
+
+TEST_F(BinaryInputTest, EmptyInput) {
+    triangles.clear();
+    Write(app::ScalarType::kFloat64);
+
+    EXPECT_TRUE(app::ReadBinaryInput<double>(filename).empty());
+}
+
+// Errors ------------------------------------------------------------------------------------------
+
+TEST_F(BinaryInputTest, MissingFileThrows) {
+    EXPECT_THROW(app::ReadBinaryInput<double>(filename), std::runtime_error);
+}
+
+TEST_F(BinaryInputTest, BadMagicThrows) {
+    std::ofstream(filename) << "2\n0 0 0 1 0 0 0 1 0\n0 0 0 1 0 0 0 1 0\n";
+
+    EXPECT_THROW(app::ReadBinaryInput<double>(filename), std::runtime_error);
+}
+
+TEST_F(BinaryInputTest, TruncatedDataThrows) {
+    Write(app::ScalarType::kFloat64);
+    std::filesystem::resize_file(filename, std::filesystem::file_size(filename) - 8);
+
+    EXPECT_THROW(app::ReadBinaryInput<double>(filename), std::runtime_error);
+}
@@ -1,12 +1,66 @@
 #include <gtest/gtest.h>
 
 #include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <thread>
 
 #include "bvh.hpp"
 #include "indexed_triangle.hpp"
+#include "parse_input.hpp"
+
+#include "test_helpers.hpp"
 
 using namespace geometry;
 using namespace acceleration;
+using test_helpers::LoadAnswers;
+using test_helpers::LoadTestData;
+
+namespace {
+
+std::vector<IndexedTriangle<double>> MakeClusteredTriangles(size_t clusters, size_t per_cluster) {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> center(-1000, 1000);
+    std::uniform_real_distribution<double> offset(-3, 3);
+
+    std::vector<IndexedTriangle<double>> triangles;
+    for (size_t c = 0; c != clusters; ++c) {
+        Point<double> base{center(gen), center(gen), center(gen)};
+        for (size_t i = 0; i != per_cluster; ++i) {
+            auto vertex = [&] {
+                return Point<double>{base.x + offset(gen), base.y + offset(gen), base.z + offset(gen)};
+            };
+            triangles.emplace_back(triangles.size(), geometry::Triangle{vertex(), vertex(), vertex()});
+        }
+    }
+
+    return triangles;
+}
+
+size_t CheckSubtree(const BVH<double>& bvh, const BVHNode<double>* node, std::set<TrIndex>& ids) {
+    if (node->IsLeaf()) {
+        for (const auto& tr : node->GetTriangles()) {
+            AABB<double> aabb{tr.triangle};
+            EXPECT_LE(node->GetAABB().min.x, aabb.min.x);
+            EXPECT_GE(node->GetAABB().max.x, aabb.max.x);
+            ids.insert(tr.id);
+        }
+        return node->GetNumberOfTriangles();
+    }
+
+    for (NodeIdx child_idx : {node->GetLeftIdx(), node->GetRightIdx()}) {
+        const auto& child = bvh.GetNode(child_idx)->GetAABB();
+        EXPECT_LE(node->GetAABB().min.y, child.min.y);
+        EXPECT_GE(node->GetAABB().max.y, child.max.y);
+    }
+
+    return CheckSubtree(bvh, bvh.GetNode(node->GetLeftIdx()), ids)
+         + CheckSubtree(bvh, bvh.GetNode(node->GetRightIdx()), ids);
+}
+
+} // namespace
 
 class BVHTest : public ::testing::Test {
 protected:    
@@ -97,3 +151,1065 @@ TEST_F(BVHTest, LargeNumberOfTriangles) {
     
     EXPECT_NE(bvh.GetRoot(), nullptr);
 }
+
+// SAH builder -------------------------------------------------------------------------------------
+
+TEST_F(BVHTest, SahBuildCoversAllTriangles) {
+    BVH<double> bvh(MakeClusteredTriangles(20, 50), {.split_method = SplitMethod::kSah});
+
+    std::set<TrIndex> ids;
+    EXPECT_EQ(CheckSubtree(bvh, bvh.GetRoot(), ids), 1000u);
+    EXPECT_EQ(ids.size(), 1000u);
+}
+
+TEST_F(BVHTest, SahMatchesMedianIntersections) {
+    BVH<double> median(MakeClusteredTriangles(20, 50));
+    BVH<double> sah(MakeClusteredTriangles(20, 50), {.split_method = SplitMethod::kSah, .sah_bins = 32});
+
+    auto expected = median.FindIntersectingTriangles();
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(sah.FindIntersectingTriangles(), expected);
+}
+
+TEST_F(BVHTest, SahCostNotWorseThanMedianOnClusteredInput) {
+    BVH<double> median(MakeClusteredTriangles(20, 50));
+    BVH<double> sah(MakeClusteredTriangles(20, 50), {.split_method = SplitMethod::kSah});
+
+    EXPECT_LE(sah.GetSahCost(), median.GetSahCost());
+}
+
+TEST_F(BVHTest, SahCostOfSingleLeaf) {
+    std::vector<IndexedTriangle<double>> single_triangle = {
+        IndexedTriangle<double>(1, {Point<double>{0,0,0}, Point<double>{1,0,0}, Point<double>{0,1,0}})
+    };
+
+    BVH<double> single(std::move(single_triangle));
+
+    EXPECT_DOUBLE_EQ(single.GetSahCost(), 1.0);
+}
+
+TEST_F(BVHTest, SahInvalidBinsThrows) {
+    EXPECT_THROW(
+        BVH<double>(std::move(triangles), {.split_method = SplitMethod::kSah, .sah_bins = 4}),
+        std::invalid_argument
+    );
+}
+
+// Parallel build ----------------------------------------------------------------------------------
+
+namespace {
+
+void ExpectIdenticalTrees(const BVH<double>& expected, const BVH<double>& actual) {
+    ASSERT_EQ(expected.GetNumberOfNodes(), actual.GetNumberOfNodes());
+    EXPECT_EQ(expected.GetRoot(), expected.GetNode(expected.GetNumberOfNodes() - 1));
+    EXPECT_EQ(actual.GetRoot(), actual.GetNode(actual.GetNumberOfNodes() - 1));
+
+    for (size_t i = 0; i != expected.GetNumberOfNodes(); ++i) {
+        const auto* a = expected.GetNode(i);
+        const auto* b = actual.GetNode(i);
+
+        ASSERT_EQ(a->IsLeaf(), b->IsLeaf());
+        EXPECT_EQ(a->GetLeftIdx(), b->GetLeftIdx());
+        EXPECT_EQ(a->GetRightIdx(), b->GetRightIdx());
+        EXPECT_EQ(a->GetAABB().min.x, b->GetAABB().min.x);
+        EXPECT_EQ(a->GetAABB().max.z, b->GetAABB().max.z);
+
+        ASSERT_EQ(a->GetNumberOfTriangles(), b->GetNumberOfTriangles());
+        for (size_t j = 0; j != a->GetNumberOfTriangles(); ++j) {
+            EXPECT_EQ(a->GetTriangles()[j].id, b->GetTriangles()[j].id);
+        }
+    }
+}
+
+} // namespace
+
+TEST_F(BVHTest, ParallelMedianBuildIdenticalToSerial) {
+    BVH<double> serial(MakeClusteredTriangles(40, 100));
+    BVH<double> parallel(
+        MakeClusteredTriangles(40, 100),
+        {.execution = concurrency::Execution::kParallel, .parallel_threshold = 64}
+    );
+
+    ExpectIdenticalTrees(serial, parallel);
+}
+
+TEST_F(BVHTest, ParallelSahBuildIdenticalToSerial) {
+    BVH<double> serial(MakeClusteredTriangles(40, 100), {.split_method = SplitMethod::kSah});
+    BVH<double> parallel(
+        MakeClusteredTriangles(40, 100),
+        {
+            .split_method = SplitMethod::kSah,
+            .execution = concurrency::Execution::kParallel,
+            .parallel_threshold = 64
+        }
+    );
+
+    ExpectIdenticalTrees(serial, parallel);
+    EXPECT_EQ(parallel.FindIntersectingTriangles(), serial.FindIntersectingTriangles());
+}
+
+TEST_F(BVHTest, ParallelBuildOfSmallInput) {
+    BVH<double> bvh(std::move(triangles), {.execution = concurrency::Execution::kParallel});
+
+    std::set<TrIndex> ids;
+    EXPECT_EQ(CheckSubtree(bvh, bvh.GetRoot(), ids), 6u);
+}
+
+// Parallel query ----------------------------------------------------------------------------------
+
+TEST_F(BVHTest, ParallelQueryMatchesSerial) {
+    BVH<double> bvh(MakeClusteredTriangles(40, 100));
+
+    auto serial = bvh.FindIntersectingTriangles();
+    auto parallel = bvh.FindIntersectingTriangles({.execution = concurrency::Execution::kParallel});
+
+    EXPECT_FALSE(serial.empty());
+    EXPECT_EQ(parallel, serial);
+}
+
+TEST_F(BVHTest, ParallelQueryWithFewTasks) {
+    BVH<double> bvh(MakeClusteredTriangles(10, 30));
+
+    auto serial = bvh.FindIntersectingTriangles();
+    auto parallel = bvh.FindIntersectingTriangles(
+        {.execution = concurrency::Execution::kParallel, .tasks_per_thread = 1}
+    );
+
+    EXPECT_EQ(parallel, serial);
+}
+
+TEST_F(BVHTest, ParallelQueryOfSingleTriangle) {
+    std::vector<IndexedTriangle<double>> single_triangle {
+        IndexedTriangle<double>(1, {Point<double>{0,0,0}, Point<double>{1,0,0}, Point<double>{0,1,0}})
+    };
+
+    BVH<double> bvh(std::move(single_triangle));
+
+    EXPECT_TRUE(bvh.FindIntersectingTriangles({.execution = concurrency::Execution::kParallel}).empty());
+}
+
+TEST_F(BVHTest, ConcurrentQueriesOnSharedTree) {
+    const BVH<double> bvh(MakeClusteredTriangles(20, 50));
+    auto expected = bvh.FindIntersectingTriangles();
+
+    IntersectionResult first;
+    IntersectionResult second;
+    std::thread worker([&] { first = bvh.FindIntersectingTriangles(); });
+    second = bvh.FindIntersectingTriangles();
+    worker.join();
+
+    EXPECT_EQ(first, expected);
+    EXPECT_EQ(second, expected);
+}
+
+// Traversal counters ------------------------------------------------------------------------------
+
+namespace {
+
+/**
+ * Counters of the former traversal that recursed from (root, root) into both (left, right) and
+ * (right, left) and dropped the mirrored triangle pairs by id only in the leaves
+ */
+void CountSymmetricTraversal(const BVH<double>& bvh, const BVHNode<double>* a, const BVHNode<double>* b,
+                             TraversalStats& stats)
+{
+    ++stats.aabb_tests;
+    if (!AABB<double>::Intersects(a->GetAABB(), b->GetAABB())) {
+        return;
+    }
+
+    if (a->IsLeaf() && b->IsLeaf()) {
+        for (const auto& a_tr : a->GetTriangles()) {
+            for (const auto& b_tr : b->GetTriangles()) {
+                ++stats.triangle_pairs;
+                stats.narrow_phase_tests += (a_tr.id < b_tr.id);
+            }
+        }
+        return;
+    }
+
+    if (!a->IsLeaf() && !b->IsLeaf()) {
+        for (NodeIdx l : {a->GetLeftIdx(), a->GetRightIdx()}) {
+            for (NodeIdx r : {b->GetLeftIdx(), b->GetRightIdx()}) {
+                CountSymmetricTraversal(bvh, bvh.GetNode(l), bvh.GetNode(r), stats);
+            }
+        }
+    } else if (!a->IsLeaf()) {
+        CountSymmetricTraversal(bvh, bvh.GetNode(a->GetLeftIdx()), b, stats);
+        CountSymmetricTraversal(bvh, bvh.GetNode(a->GetRightIdx()), b, stats);
+    } else {
+        CountSymmetricTraversal(bvh, a, bvh.GetNode(b->GetLeftIdx()), stats);
+        CountSymmetricTraversal(bvh, a, bvh.GetNode(b->GetRightIdx()), stats);
+    }
+}
+
+} // namespace
+
+TEST(BVHTraversalTest, SelfTraversalHalvesWorkOnE2EData) {
+    BVH<double> bvh(LoadTestData("10.dat"));
+
+    TraversalStats stats;
+    auto result = bvh.FindIntersectingTriangles({}, &stats);
+
+    TraversalStats symmetric;
+    CountSymmetricTraversal(bvh, bvh.GetRoot(), bvh.GetRoot(), symmetric);
+
+    EXPECT_EQ(result.ToVector(), LoadAnswers("10.ans"));
+    EXPECT_LT(stats.aabb_tests * 10, symmetric.aabb_tests * 6);
+    EXPECT_LT(stats.triangle_pairs * 10, symmetric.triangle_pairs * 6);
+    EXPECT_LE(stats.narrow_phase_tests, symmetric.narrow_phase_tests);
+}
+
+TEST(BVHTraversalTest, ParallelCountersMatchSerial) {
+    BVH<double> bvh(LoadTestData("10.dat"));
+
+    TraversalStats serial;
+    TraversalStats parallel;
+    bvh.FindIntersectingTriangles({}, &serial);
+    bvh.FindIntersectingTriangles({.execution = concurrency::Execution::kParallel}, &parallel);
+
+    EXPECT_EQ(parallel.aabb_tests, serial.aabb_tests);
+    EXPECT_EQ(parallel.triangle_pairs, serial.triangle_pairs);
+    EXPECT_EQ(parallel.narrow_phase_tests, serial.narrow_phase_tests);
+}
+
+// Batched narrow phase ----------------------------------------------------------------------------
+
+TEST(BVHTraversalTest, LargeLeavesMatchAnswers) {
+    for (size_t leaf_size : {1, 8, 32}) {
+        BVH<double> bvh(LoadTestData("10.dat"), {.max_leaf_size = leaf_size});
+
+        TraversalStats stats;
+        EXPECT_EQ(bvh.FindIntersectingTriangles({}, &stats).ToVector(), LoadAnswers("10.ans"));
+        EXPECT_LE(stats.narrow_phase_tests, stats.triangle_pairs);
+    }
+}
+
+TEST(BVHTraversalTest, PlaneRejectionSkipsNarrowPhase) {
+    BVH<double> bvh(MakeClusteredTriangles(20, 50), {.max_leaf_size = 8});
+
+    TraversalStats stats;
+    bvh.FindIntersectingTriangles({}, &stats);
+
+    EXPECT_LT(stats.narrow_phase_tests, stats.triangle_pairs);
+}
+
+TEST_F(BVHTest, InvalidLeafSizeThrows) {
+    EXPECT_THROW(BVH<double>(std::move(triangles), {.max_leaf_size = 0}), std::invalid_argument);
+    EXPECT_THROW(BVH<double>(std::move(triangles), {.max_leaf_size = kMaxLeafSize + 1}), std::invalid_argument);
+}
+
+// Narrow phase engines ----------------------------------------------------------------------------
+
+TEST(BVHTraversalTest, MollerEngineMatchesAnswers) {
+    for (int i = 1; i <= 10; ++i) {
+        BVH<double> bvh(LoadTestData(std::to_string(i) + ".dat"));
+
+        EXPECT_EQ(bvh.FindIntersectingTriangles({.narrow_phase = NarrowPhase::kMoller}).ToVector(),
+                  LoadAnswers(std::to_string(i) + ".ans"));
+    }
+}
+
+TEST_F(BVHTest, MollerEngineMatchesSat) {
+    BVH<double> bvh(MakeClusteredTriangles(20, 50), {.max_leaf_size = 8});
+
+    EXPECT_EQ(bvh.FindIntersectingTriangles({.narrow_phase = NarrowPhase::kMoller}),
+              bvh.FindIntersectingTriangles({.narrow_phase = NarrowPhase::kSat}));
+}
+
+TEST(BVHTraversalTest, DeepTreeMatchesBruteForce) {
+    // a chain of triangles growing exponentially: the SAH splits off a few of the largest at a time
+    std::vector<IndexedTriangle<double>> chain;
+    for (size_t i = 0; i != 400; ++i) {
+        double x0 = std::pow(1.5, i);
+        double x1 = std::pow(1.5, i + 1);
+        chain.emplace_back(i, Triangle<double>{Point<double>{x0, 0, 0}, Point<double>{x1, 0, 0},
+                                               Point<double>{x0, 1, 0}});
+    }
+
+    std::vector<TrIndex> expected;
+    for (size_t i = 0; i != chain.size(); ++i) {
+        for (size_t j = 0; j != chain.size(); ++j) {
+            if (i != j && Triangle<double>::Intersect(chain[i].triangle, chain[j].triangle)) {
+                expected.push_back(chain[i].id);
+                break;
+            }
+        }
+    }
+
+    BVH<double> bvh(std::move(chain), {.split_method = SplitMethod::kSah, .max_leaf_size = 1});
+
+    std::function<size_t(NodeIdx)> depth = [&](NodeIdx idx) -> size_t {
+        const auto* node = bvh.GetNode(idx);
+        return node->IsLeaf() ? 1 : 1 + std::max(depth(node->GetLeftIdx()), depth(node->GetRightIdx()));
+    };
+
+    EXPECT_GT(depth(bvh.GetNumberOfNodes() - 1), 50u);
+    EXPECT_EQ(bvh.FindIntersectingTriangles().ToVector(), expected);
+    EXPECT_EQ(bvh.FindIntersectingTriangles({.execution = concurrency::Execution::kParallel}).ToVector(), expected);
+}
+
+// Pair visitor ------------------------------------------------------------------------------------
+
+TEST_F(BVHTest, PairVisitorMatchesBruteForce) {
+    auto input = MakeClusteredTriangles(10, 40);
+
+    std::set<std::pair<TrIndex, TrIndex>> expected;
+    for (size_t i = 0; i != input.size(); ++i) {
+        for (size_t j = i + 1; j != input.size(); ++j) {
+            if (Triangle<double>::Intersect(input[i].triangle, input[j].triangle)) {
+                expected.emplace(input[i].id, input[j].id);
+            }
+        }
+    }
+
+    BVH<double> bvh(std::move(input), {.max_leaf_size = 8});
+
+    std::vector<std::pair<TrIndex, TrIndex>> pairs;
+    bvh.ForEachIntersectingPair([&pairs](TrIndex a, TrIndex b) { pairs.emplace_back(a, b); });
+
+    std::set<std::pair<TrIndex, TrIndex>> unique(pairs.begin(), pairs.end());
+    EXPECT_EQ(unique.size(), pairs.size());
+    EXPECT_EQ(unique, expected);
+}
+
+TEST_F(BVHTest, PairVisitorIdsMatchIntersectingTriangles) {
+    BVH<double> bvh(MakeClusteredTriangles(20, 50));
+
+    std::set<TrIndex> ids;
+    bvh.ForEachIntersectingPair([&ids](TrIndex a, TrIndex b) {
+        EXPECT_LT(a, b);
+        ids.insert(a);
+        ids.insert(b);
+    });
+
+    auto expected = bvh.FindIntersectingTriangles().ToVector();
+    EXPECT_EQ(std::vector<TrIndex>(ids.begin(), ids.end()), expected);
+}
+
+TEST_F(BVHTest, ParallelPairVisitorMatchesSerial) {
+    BVH<double> bvh(MakeClusteredTriangles(40, 100));
+
+    std::set<std::pair<TrIndex, TrIndex>> serial;
+    TraversalStats serial_stats;
+    bvh.ForEachIntersectingPair([&](TrIndex a, TrIndex b) { serial.emplace(a, b); }, {}, &serial_stats);
+
+    std::mutex mutex;
+    std::set<std::pair<TrIndex, TrIndex>> parallel;
+    TraversalStats parallel_stats;
+    bvh.ForEachIntersectingPair(
+        [&](TrIndex a, TrIndex b) {
+            std::lock_guard lock(mutex);
+            parallel.emplace(a, b);
+        },
+        {.execution = concurrency::Execution::kParallel},
+        &parallel_stats
+    );
+
+    EXPECT_EQ(parallel, serial);
+    EXPECT_EQ(parallel_stats.narrow_phase_tests, serial_stats.narrow_phase_tests);
+}
+
+// Early exit --------------------------------------------------------------------------------------
+
+TEST_F(BVHTest, HasIntersections) {
+    BVH<double> separated(std::move(triangles));
+    BVH<double> clustered(MakeClusteredTriangles(20, 50));
+
+    EXPECT_FALSE(separated.HasIntersections());
+    EXPECT_TRUE(clustered.HasIntersections());
+    EXPECT_TRUE(clustered.HasIntersections({.execution = concurrency::Execution::kParallel}));
+}
+
+TEST(BVHTraversalTest, AnyIntersectionStopsEarly) {
+    BVH<double> bvh(LoadTestData("10.dat"));
+
+    TraversalStats full;
+    TraversalStats any;
+    bvh.FindIntersectingTriangles({}, &full);
+
+    EXPECT_TRUE(bvh.HasIntersections({}, &any));
+    EXPECT_LT(any.narrow_phase_tests * 100, full.narrow_phase_tests);
+    EXPECT_LT(any.aabb_tests * 100, full.aabb_tests);
+}
+
+TEST_F(BVHTest, FirstPairsAreIntersectingPairs) {
+    BVH<double> bvh(MakeClusteredTriangles(20, 50));
+
+    std::set<std::pair<TrIndex, TrIndex>> all;
+    bvh.ForEachIntersectingPair([&all](TrIndex a, TrIndex b) { all.emplace(a, b); });
+    ASSERT_GT(all.size(), 5u);
+
+    for (auto execution : {concurrency::Execution::kSerial, concurrency::Execution::kParallel}) {
+        auto first = bvh.FindFirstIntersectingPairs(5, {.execution = execution});
+
+        ASSERT_EQ(first.size(), 5u);
+        for (const auto& pair : first) {
+            EXPECT_TRUE(all.contains(pair));
+        }
+    }
+
+    EXPECT_EQ(bvh.FindFirstIntersectingPairs(all.size() + 10).size(), all.size());
+    EXPECT_TRUE(bvh.FindFirstIntersectingPairs(0).empty());
+}
+
+TEST_F(BVHTest, FirstIdsAreIntersectingTriangles) {
+    BVH<double> bvh(MakeClusteredTriangles(20, 50));
+    auto all = bvh.FindIntersectingTriangles();
+
+    for (auto execution : {concurrency::Execution::kSerial, concurrency::Execution::kParallel}) {
+        auto first = bvh.FindFirstIntersectingTriangles(10, {.execution = execution});
+
+        EXPECT_GE(first.size(), 10u);
+        EXPECT_LT(first.size(), all.size());
+        for (TrIndex id : first) {
+            EXPECT_TRUE(all.Contains(id));
+        }
+    }
+
+    EXPECT_EQ(bvh.FindFirstIntersectingTriangles(all.size() + 10), all);
+}
+
+TEST_F(BVHTest, VisitorReturningFalseStopsTraversal) {
+    BVH<double> bvh(MakeClusteredTriangles(20, 50));
+
+    size_t calls = 0;
+    bvh.ForEachIntersectingPair([&calls](TrIndex, TrIndex) {
+        ++calls;
+        return false;
+    });
+
+    EXPECT_EQ(calls, 1u);
+}
+
+// Skipping flagged triangles ----------------------------------------------------------------------
+
+TEST(BVHTraversalTest, SkipFlaggedMatchesAnswers) {
+    for (int i = 1; i <= 10; ++i) {
+        BVH<double> bvh(LoadTestData(std::to_string(i) + ".dat"));
+
+        EXPECT_EQ(bvh.FindIntersectingTriangles({.skip_flagged = true}).ToVector(),
+                  LoadAnswers(std::to_string(i) + ".ans"));
+    }
+}
+
+TEST(BVHTraversalTest, SkipFlaggedAvoidsNarrowPhaseTests) {
+    BVH<double> bvh(LoadTestData("10.dat"), {.max_leaf_size = 8});
+
+    TraversalStats full;
+    TraversalStats skipping;
+    bvh.FindIntersectingTriangles({}, &full);
+    bvh.FindIntersectingTriangles({.skip_flagged = true}, &skipping);
+
+    EXPECT_EQ(full.skipped_narrow_phase_tests, 0u);
+    EXPECT_GT(skipping.skipped_narrow_phase_tests, 0u);
+    EXPECT_GT(skipping.pruned_node_pairs, 0u);
+    EXPECT_LT(skipping.narrow_phase_tests, full.narrow_phase_tests);
+}
+
+TEST_F(BVHTest, ParallelSkipFlaggedMatchesSerial) {
+    BVH<double> bvh(MakeClusteredTriangles(40, 100));
+
+    auto expected = bvh.FindIntersectingTriangles();
+    EXPECT_EQ(bvh.FindIntersectingTriangles({.skip_flagged = true}), expected);
+    EXPECT_EQ(bvh.FindIntersectingTriangles({.execution = concurrency::Execution::kParallel, .skip_flagged = true}),
+              expected);
+}
+
+TEST_F(BVHTest, FullyFlaggedSubtreesArePruned) {
+    // every triangle crosses every other one, so all are flagged after the first leaf pairs
+    std::vector<IndexedTriangle<double>> fan;
+    for (size_t i = 0; i != 64; ++i) {
+        double angle = 0.05 * i;
+        fan.emplace_back(i, Triangle<double>{Point<double>{0, 0, -1},
+                                             Point<double>{std::cos(angle), std::sin(angle), 1},
+                                             Point<double>{-std::cos(angle), -std::sin(angle), 1}});
+    }
+    BVH<double> bvh(std::move(fan));
+
+    TraversalStats full;
+    TraversalStats skipping;
+    auto expected = bvh.FindIntersectingTriangles({}, &full);
+
+    EXPECT_EQ(bvh.FindIntersectingTriangles({.skip_flagged = true}, &skipping), expected);
+    EXPECT_EQ(expected.size(), 64u);
+    EXPECT_GT(skipping.pruned_node_pairs, 0u);
+    EXPECT_LT(skipping.narrow_phase_tests * 4, full.narrow_phase_tests);
+}
+
+// Node bounds -------------------------------------------------------------------------------------
+
+TEST(BVHTraversalTest, FloatBoundsMatchAnswers) {
+    for (int i = 1; i <= 10; ++i) {
+        BVH<double> bvh(LoadTestData(std::to_string(i) + ".dat"), {.node_bounds = NodeBounds::kFloat});
+
+        EXPECT_EQ(bvh.FindIntersectingTriangles().ToVector(), LoadAnswers(std::to_string(i) + ".ans"));
+    }
+}
+
+TEST_F(BVHTest, FloatBoundsMatchNative) {
+    BVH<double> native(MakeClusteredTriangles(40, 100));
+    BVH<double> rounded(MakeClusteredTriangles(40, 100), {.node_bounds = NodeBounds::kFloat});
+
+    auto expected = native.FindIntersectingTriangles();
+
+    EXPECT_EQ(rounded.FindIntersectingTriangles(), expected);
+    EXPECT_EQ(rounded.FindIntersectingTriangles({.execution = concurrency::Execution::kParallel,
+                                                 .skip_flagged = true}), expected);
+}
+
+// Wide nodes --------------------------------------------------------------------------------------
+
+TEST(BVHTraversalTest, WideTreesMatchAnswers) {
+    for (size_t branching_factor : {4, 8}) {
+        for (int i = 1; i <= 10; ++i) {
+            BVH<double> bvh(LoadTestData(std::to_string(i) + ".dat"), {.branching_factor = branching_factor});
+
+            EXPECT_EQ(bvh.FindIntersectingTriangles().ToVector(), LoadAnswers(std::to_string(i) + ".ans"))
+                << "test " << i << ", branching factor " << branching_factor;
+        }
+    }
+}
+
+TEST_F(BVHTest, WideTreesMatchBinary) {
+    auto expected = BVH<double>(MakeClusteredTriangles(40, 100)).FindIntersectingTriangles();
+
+    for (size_t branching_factor : {4, 8}) {
+        for (NodeBounds bounds : {NodeBounds::kNative, NodeBounds::kFloat}) {
+            BVH<double> bvh(MakeClusteredTriangles(40, 100),
+                            {.max_leaf_size = 4, .node_bounds = bounds, .branching_factor = branching_factor});
+
+            EXPECT_EQ(bvh.FindIntersectingTriangles(), expected);
+            EXPECT_EQ(bvh.FindIntersectingTriangles({.execution = concurrency::Execution::kParallel}), expected);
+            EXPECT_EQ(bvh.FindIntersectingTriangles({.execution = concurrency::Execution::kParallel,
+                                                     .skip_flagged = true}), expected);
+        }
+    }
+}
+
+TEST_F(BVHTest, WidePairVisitorMatchesBinary) {
+    std::set<std::pair<TrIndex, TrIndex>> binary;
+    std::set<std::pair<TrIndex, TrIndex>> wide;
+
+    BVH<double>(MakeClusteredTriangles(20, 50)).ForEachIntersectingPair(
+        [&](TrIndex a, TrIndex b) { binary.emplace(a, b); });
+    BVH<double>(MakeClusteredTriangles(20, 50), {.branching_factor = 4}).ForEachIntersectingPair(
+        [&](TrIndex a, TrIndex b) { EXPECT_TRUE(wide.emplace(a, b).second); });
+
+    EXPECT_EQ(wide, binary);
+}
+
+TEST_F(BVHTest, WideTreeOfSingleTriangle) {
+    BVH<double> bvh({triangles.front()}, {.branching_factor = 8});
+
+    EXPECT_TRUE(bvh.FindIntersectingTriangles().empty());
+}
+
+TEST_F(BVHTest, InvalidBranchingFactorThrows) {
+    EXPECT_THROW(BVH<double>(std::move(triangles), {.branching_factor = 3}), std::invalid_argument);
+}
+
+// Node order --------------------------------------------------------------------------------------
+
+TEST(BVHTraversalTest, NodeOrdersMatchAnswers) {
+    for (NodeOrder order : {NodeOrder::kBreadthFirst, NodeOrder::kVanEmdeBoas}) {
+        for (int i = 1; i <= 10; ++i) {
+            BVH<double> bvh(LoadTestData(std::to_string(i) + ".dat"), {.node_order = order});
+
+            EXPECT_EQ(bvh.FindIntersectingTriangles().ToVector(), LoadAnswers(std::to_string(i) + ".ans"))
+                << "test " << i << ", order " << static_cast<int>(order);
+        }
+    }
+}
+
+TEST_F(BVHTest, NodeOrdersMatchDepthFirst) {
+    auto expected = BVH<double>(MakeClusteredTriangles(40, 100)).FindIntersectingTriangles();
+
+    for (size_t branching_factor : {2, 4, 8}) {
+        for (NodeOrder order : {NodeOrder::kBreadthFirst, NodeOrder::kVanEmdeBoas}) {
+            BVH<double> bvh(MakeClusteredTriangles(40, 100),
+                            {.max_leaf_size = 4, .branching_factor = branching_factor, .node_order = order});
+
+            EXPECT_EQ(bvh.FindIntersectingTriangles(), expected);
+            EXPECT_EQ(bvh.FindIntersectingTriangles({.execution = concurrency::Execution::kParallel,
+                                                     .skip_flagged = true}), expected);
+        }
+    }
+}
+
+// Refit -------------------------------------------------------------------------------------------
+
+namespace {
+
+/**
+ * The triangles with every cluster shifted by its own offset and every vertex jittered, so the
+ * clusters move apart and triangles inside them change their overlaps
+ */
+std::vector<IndexedTriangle<double>> MoveTriangles(std::vector<IndexedTriangle<double>> triangles, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> shift(-200, 200);
+    std::uniform_real_distribution<double> jitter(-1, 1);
+
+    Vector<double> offset;
+    for (size_t i = 0; i != triangles.size(); ++i) {
+        if (i % 100 == 0) {
+            offset = Vector<double>{shift(gen), shift(gen), shift(gen)};
+        }
+        auto move = [&](const Point<double>& p) {
+            return Point<double>{p.x + offset.x + jitter(gen), p.y + offset.y + jitter(gen), p.z + offset.z + jitter(gen)};
+        };
+        const auto& t = triangles[i].triangle;
+        triangles[i].triangle = Triangle<double>{move(t[0]), move(t[1]), move(t[2])};
+    }
+
+    return triangles;
+}
+
+} // namespace
+
+TEST_F(BVHTest, RefitMatchesRebuild) {
+    auto moved = MoveTriangles(MakeClusteredTriangles(40, 100), 5);
+    auto expected = BVH<double>(std::vector(moved)).FindIntersectingTriangles();
+
+    for (size_t branching_factor : {2, 4}) {
+        for (NodeBounds bounds : {NodeBounds::kNative, NodeBounds::kFloat}) {
+            BVH<double> bvh(MakeClusteredTriangles(40, 100), {.node_bounds = bounds, .branching_factor = branching_factor});
+            for (const auto& tr : moved) {
+                bvh.SetTriangle(tr.id, tr.triangle);
+            }
+            bvh.Refit();
+
+            EXPECT_EQ(bvh.FindIntersectingTriangles(), expected);
+            EXPECT_EQ(bvh.FindIntersectingTriangles({.execution = concurrency::Execution::kParallel,
+                                                     .skip_flagged = true}), expected);
+        }
+    }
+}
+
+TEST_F(BVHTest, ParallelRefitMatchesSerial) {
+    auto moved = MoveTriangles(MakeClusteredTriangles(40, 100), 6);
+
+    BVH<double> serial(MakeClusteredTriangles(40, 100), {.execution = concurrency::Execution::kParallel,
+                                                         .parallel_threshold = 64});
+    BVH<double> parallel(MakeClusteredTriangles(40, 100), {.execution = concurrency::Execution::kParallel,
+                                                           .parallel_threshold = 64});
+    for (const auto& tr : moved) {
+        serial.SetTriangle(tr.id, tr.triangle);
+        parallel.SetTriangle(tr.id, tr.triangle);
+    }
+    serial.Refit();
+    parallel.Refit(concurrency::Execution::kParallel);
+
+    ASSERT_EQ(serial.GetNumberOfNodes(), parallel.GetNumberOfNodes());
+    for (NodeIdx idx = 0; idx != static_cast<NodeIdx>(serial.GetNumberOfNodes()); ++idx) {
+        EXPECT_EQ(serial.GetNode(idx)->GetAABB().min, parallel.GetNode(idx)->GetAABB().min);
+        EXPECT_EQ(serial.GetNode(idx)->GetAABB().max, parallel.GetNode(idx)->GetAABB().max);
+    }
+
+    std::set<TrIndex> ids;
+    EXPECT_EQ(CheckSubtree(parallel, parallel.GetRoot(), ids), moved.size());
+    EXPECT_EQ(parallel.FindIntersectingTriangles(), serial.FindIntersectingTriangles());
+}
+
+TEST_F(BVHTest, RefitFromArrayMatchesSetTriangle) {
+    auto moved = MoveTriangles(MakeClusteredTriangles(40, 100), 7);
+    std::vector<Triangle<double>> by_id;
+    for (const auto& tr : moved) {
+        by_id.push_back(tr.triangle);
+    }
+
+    BVH<double> one_by_one(MakeClusteredTriangles(40, 100), {.node_bounds = NodeBounds::kFloat});
+    for (const auto& tr : moved) {
+        one_by_one.SetTriangle(tr.id, tr.triangle);
+    }
+    one_by_one.Refit();
+
+    for (auto execution : {concurrency::Execution::kSerial, concurrency::Execution::kParallel}) {
+        BVH<double> bvh(MakeClusteredTriangles(40, 100), {.parallel_threshold = 100, .node_bounds = NodeBounds::kFloat});
+        bvh.Refit(by_id, execution);
+
+        EXPECT_EQ(bvh.FindIntersectingTriangles(), one_by_one.FindIntersectingTriangles());
+        EXPECT_DOUBLE_EQ(bvh.GetSahCost(), one_by_one.GetSahCost());
+    }
+
+    by_id.pop_back();
+    BVH<double> bvh(MakeClusteredTriangles(40, 100));
+    EXPECT_THROW(bvh.Refit(by_id), std::invalid_argument);
+}
+
+TEST_F(BVHTest, SahCostGrowsWithMovement) {
+    auto original = MakeClusteredTriangles(40, 100);
+    BVH<double> bvh{std::vector(original)};
+    EXPECT_DOUBLE_EQ(bvh.GetSahCostGrowth(), 1.0);
+
+    // every triangle takes the place of another one far away
+    for (size_t i = 0; i != original.size(); ++i) {
+        bvh.SetTriangle(original[i].id, original[(i + original.size() / 2) % original.size()].triangle);
+    }
+    bvh.Refit();
+    EXPECT_GT(bvh.GetSahCostGrowth(), 2.0);
+
+    for (const auto& tr : original) {
+        bvh.SetTriangle(tr.id, tr.triangle);
+    }
+    bvh.Refit();
+    EXPECT_DOUBLE_EQ(bvh.GetSahCostGrowth(), 1.0);
+}
+
+TEST_F(BVHTest, SetTriangleOfUnknownIdThrows) {
+    BVH<double> bvh(std::move(triangles));
+
+    EXPECT_THROW(bvh.SetTriangle(0, triangles.front().triangle), std::invalid_argument);
+    EXPECT_THROW(bvh.SetTriangle(100, triangles.front().triangle), std::invalid_argument);
+}
+
+// Cross query -------------------------------------------------------------------------------------
+
+namespace {
+
+/**
+ * Every pair (i, j) of a triangle of a and a triangle of b that intersect
+ */
+std::set<std::pair<TrIndex, TrIndex>> BruteForceCrossPairs(const std::vector<IndexedTriangle<double>>& a,
+                                                           const std::vector<IndexedTriangle<double>>& b)
+{
+    std::set<std::pair<TrIndex, TrIndex>> pairs;
+    for (const auto& a_tr : a) {
+        for (const auto& b_tr : b) {
+            if (Triangle<double>::Intersect(a_tr.triangle, b_tr.triangle)) {
+                pairs.emplace(a_tr.id, b_tr.id);
+            }
+        }
+    }
+    return pairs;
+}
+
+std::set<std::pair<TrIndex, TrIndex>> CrossPairs(const BVH<double>& a, const BVH<double>& b,
+                                                 const QueryOptions& options = {})
+{
+    std::mutex mutex;
+    std::set<std::pair<TrIndex, TrIndex>> pairs;
+    a.ForEachIntersectingPair(b, [&](TrIndex i, TrIndex j) {
+        std::lock_guard lock(mutex);
+        EXPECT_TRUE(pairs.emplace(i, j).second);
+    }, options);
+    return pairs;
+}
+
+} // namespace
+
+TEST_F(BVHTest, CrossPairsMatchBruteForce) {
+    auto a = MakeClusteredTriangles(10, 40);
+    // the same clusters, every triangle moved a little and with ids of its own
+    auto b = MakeClusteredTriangles(10, 40);
+    for (auto& tr : b) {
+        const auto& t = tr.triangle;
+        auto shift = [](const Point<double>& p) { return Point<double>{p.x + 0.5, p.y - 0.3, p.z + 0.2}; };
+        tr.triangle = Triangle<double>{shift(t[0]), shift(t[1]), shift(t[2])};
+        tr.id = 3 * tr.id + 7;
+    }
+
+    auto expected = BruteForceCrossPairs(a, b);
+    ASSERT_FALSE(expected.empty());
+
+    BVH<double> a_tree{std::vector(a), {.max_leaf_size = 4}};
+    BVH<double> b_tree{std::vector(b), {.max_leaf_size = 2}};
+    EXPECT_EQ(CrossPairs(a_tree, b_tree), expected);
+
+    std::set<std::pair<TrIndex, TrIndex>> swapped;
+    for (auto [i, j] : CrossPairs(b_tree, a_tree)) {
+        swapped.emplace(j, i);
+    }
+    EXPECT_EQ(swapped, expected);
+}
+
+TEST_F(BVHTest, CrossQueryOfAllLayouts) {
+    auto a = MakeClusteredTriangles(20, 50);
+    auto b = MoveTriangles(MakeClusteredTriangles(20, 50), 9);
+    auto expected = BruteForceCrossPairs(a, b);
+
+    std::vector<BuildOptions> layouts;
+    for (size_t branching_factor : {2, 4, 8}) {
+        for (NodeBounds bounds : {NodeBounds::kNative, NodeBounds::kFloat}) {
+            layouts.push_back({.max_leaf_size = 4, .node_bounds = bounds, .branching_factor = branching_factor});
+        }
+    }
+
+    for (const auto& a_options : layouts) {
+        BVH<double> a_tree{std::vector(a), a_options};
+        for (const auto& b_options : layouts) {
+            BVH<double> b_tree{std::vector(b), b_options};
+            EXPECT_EQ(CrossPairs(a_tree, b_tree), expected);
+        }
+    }
+}
+
+TEST_F(BVHTest, ParallelCrossQueryMatchesSerial) {
+    auto a = MakeClusteredTriangles(40, 100);
+    auto b = MoveTriangles(MakeClusteredTriangles(40, 100), 10);
+    BVH<double> a_tree{std::vector(a)};
+    BVH<double> b_tree{std::vector(b)};
+
+    QueryOptions parallel{.execution = concurrency::Execution::kParallel};
+    EXPECT_EQ(CrossPairs(a_tree, b_tree, parallel), CrossPairs(a_tree, b_tree));
+    EXPECT_EQ(a_tree.FindIntersectingTriangles(b_tree, parallel), a_tree.FindIntersectingTriangles(b_tree));
+}
+
+TEST_F(BVHTest, CrossIdsMatchCrossPairs) {
+    auto a = MakeClusteredTriangles(20, 50);
+    auto b = MoveTriangles(MakeClusteredTriangles(20, 50), 11);
+    BVH<double> a_tree{std::vector(a)};
+    BVH<double> b_tree{std::vector(b)};
+
+    IntersectionResult a_ids(a.size());
+    IntersectionResult b_ids(b.size());
+    for (auto [i, j] : CrossPairs(a_tree, b_tree)) {
+        a_ids.Insert(i);
+        b_ids.Insert(j);
+    }
+
+    auto [a_result, b_result] = a_tree.FindIntersectingTriangles(b_tree);
+    EXPECT_EQ(a_result, a_ids);
+    EXPECT_EQ(b_result, b_ids);
+    EXPECT_EQ(a_tree.HasIntersections(b_tree), !a_ids.empty());
+}
+
+TEST_F(BVHTest, CrossQueryTestsNoPairsInsideOneTree) {
+    BVH<double> left{std::vector(triangles)};
+    for (auto& tr : triangles) {
+        const auto& t = tr.triangle;
+        auto shift = [](const Point<double>& p) { return Point<double>{p.x, p.y, p.z + 10}; };
+        tr.triangle = Triangle<double>{shift(t[0]), shift(t[1]), shift(t[2])};
+    }
+    BVH<double> right(std::move(triangles));
+
+    TraversalStats stats;
+    EXPECT_FALSE(left.HasIntersections(right, {}, &stats));
+    EXPECT_TRUE(left.FindIntersectingTriangles(right).first.empty());
+    EXPECT_EQ(stats.aabb_tests, 1u);
+    EXPECT_EQ(stats.narrow_phase_tests, 0u);
+}
+
+// Saving and mapping ------------------------------------------------------------------------------
+
+class SavedBVHTest : public ::testing::Test {
+protected:
+    std::string filename = (std::filesystem::temp_directory_path() / "triangles_saved_bvh_test.bvh").string();
+
+    void TearDown() override {
+        std::filesystem::remove(filename);
+    }
+
+    void Save(const BVH<double>& tree) {
+        std::ofstream file(filename, std::ios::binary);
+        tree.Save(file);
+    }
+
+    /**
+     * Overwrites size bytes of the saved file at offset with value
+     */
+    void Patch(size_t offset, const void* value, size_t size) {
+        std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(static_cast<std::streamoff>(offset));
+        file.write(static_cast<const char*>(value), static_cast<std::streamsize>(size));
+    }
+};
+
+TEST_F(SavedBVHTest, MappedTreeMatchesBuiltTree) {
+    auto triangles = MakeClusteredTriangles(40, 100);
+
+    for (size_t branching_factor : {2, 4, 8}) {
+        for (NodeBounds bounds : {NodeBounds::kNative, NodeBounds::kFloat}) {
+            for (NodeOrder order : {NodeOrder::kDepthFirst, NodeOrder::kVanEmdeBoas}) {
+                BVH<double> built{std::vector(triangles), {.max_leaf_size = 4, .node_bounds = bounds,
+                                                           .branching_factor = branching_factor, .node_order = order}};
+                Save(built);
+                auto mapped = BVH<double>::Map(filename);
+
+                EXPECT_TRUE(mapped.IsMapped());
+                EXPECT_FALSE(built.IsMapped());
+                EXPECT_EQ(mapped.GetNumberOfNodes(), built.GetNumberOfNodes());
+                EXPECT_DOUBLE_EQ(mapped.GetSahCost(), built.GetSahCost());
+
+                auto expected = built.FindIntersectingTriangles();
+                EXPECT_EQ(mapped.FindIntersectingTriangles(), expected);
+                EXPECT_EQ(mapped.FindIntersectingTriangles({.execution = concurrency::Execution::kParallel,
+                                                            .skip_flagged = true}), expected);
+                EXPECT_EQ(mapped.FindFirstIntersectingTriangles(5), built.FindFirstIntersectingTriangles(5));
+
+                std::set<TrIndex> ids;
+                EXPECT_EQ(CheckSubtree(mapped, mapped.GetRoot(), ids), triangles.size());
+                EXPECT_EQ(ids.size(), triangles.size());
+            }
+        }
+    }
+}
+
+TEST_F(SavedBVHTest, MappedTreeAnswersTestData) {
+    for (int i = 1; i <= 10; ++i) {
+        Save(BVH<double>(LoadTestData(std::to_string(i) + ".dat")));
+
+        EXPECT_EQ(BVH<double>::Map(filename).FindIntersectingTriangles().ToVector(),
+                  LoadAnswers(std::to_string(i) + ".ans")) << "test " << i;
+    }
+}
+
+TEST_F(SavedBVHTest, MappingsShareTheFile) {
+    auto a = MakeClusteredTriangles(20, 50);
+    auto b = MoveTriangles(MakeClusteredTriangles(20, 50), 12);
+    BVH<double> a_tree{std::vector(a)};
+    BVH<double> b_tree{std::vector(b)};
+    Save(b_tree);
+
+    auto first = BVH<double>::Map(filename);
+    auto second = BVH<double>::Map(filename);
+    EXPECT_EQ(first.FindIntersectingTriangles(), second.FindIntersectingTriangles());
+    EXPECT_EQ(CrossPairs(a_tree, first), CrossPairs(a_tree, b_tree));
+    EXPECT_EQ(CrossPairs(second, a_tree), CrossPairs(b_tree, a_tree));
+
+    // the tree keeps the mapping after the file is gone
+    std::filesystem::remove(filename);
+    EXPECT_EQ(first.FindIntersectingTriangles(), b_tree.FindIntersectingTriangles());
+}
+
+TEST_F(SavedBVHTest, MappedTreeIsReadOnly) {
+    auto triangles = MakeClusteredTriangles(5, 10);
+    Save(BVH<double>{std::vector(triangles)});
+    auto mapped = BVH<double>::Map(filename);
+
+    EXPECT_THROW(mapped.SetTriangle(0, triangles[1].triangle), std::runtime_error);
+    EXPECT_THROW(mapped.Refit(), std::runtime_error);
+    std::vector<Triangle<double>> moved;
+    for (const auto& tr : triangles) {
+        moved.push_back(tr.triangle);
+    }
+    EXPECT_THROW(mapped.Refit(moved), std::runtime_error);
+}
+
+TEST_F(SavedBVHTest, SavedTreeOfSingleTriangle) {
+    Save(BVH<double>{std::vector{IndexedTriangle<double>(3, {Point<double>{0,0,0}, Point<double>{1,0,0},
+                                                             Point<double>{0,1,0}})}});
+    auto mapped = BVH<double>::Map(filename);
+
+    EXPECT_TRUE(mapped.GetRoot()->IsLeaf());
+    EXPECT_TRUE(mapped.FindIntersectingTriangles().empty());
+}
+
+TEST_F(SavedBVHTest, WrongMagicThrows) {
+    Save(BVH<double>{MakeClusteredTriangles(5, 10)});
+    Patch(0, "NOTATREE", 8);
+
+    EXPECT_THROW(BVH<double>::Map(filename), std::runtime_error);
+}
+
+TEST_F(SavedBVHTest, WrongVersionThrows) {
+    Save(BVH<double>{MakeClusteredTriangles(5, 10)});
+    uint32_t version = kBvhFileVersion + 1;
+    Patch(offsetof(BvhFileHeader, version), &version, sizeof(version));
+
+    EXPECT_THROW(BVH<double>::Map(filename), std::runtime_error);
+}
+
+TEST_F(SavedBVHTest, WrongScalarTypeThrows) {
+    Save(BVH<double>{MakeClusteredTriangles(5, 10)});
+
+    EXPECT_THROW(BVH<float>::Map(filename), std::runtime_error);
+}
+
+TEST_F(SavedBVHTest, TruncatedFileThrows) {
+    Save(BVH<double>{MakeClusteredTriangles(5, 10)});
+
+    std::filesystem::resize_file(filename, std::filesystem::file_size(filename) - 8);
+    EXPECT_THROW(BVH<double>::Map(filename), std::runtime_error);
+
+    std::filesystem::resize_file(filename, sizeof(BvhFileHeader) - 1);
+    EXPECT_THROW(BVH<double>::Map(filename), std::runtime_error);
+}
+
+TEST_F(SavedBVHTest, CorruptNodeThrows) {
+    Save(BVH<double>{MakeClusteredTriangles(5, 10)});
+
+    BvhFileHeader header;
+    std::ifstream(filename, std::ios::binary).read(reinterpret_cast<char*>(&header), sizeof(header));
+    int64_t root = header.sections[static_cast<size_t>(BvhSection::kNodes)].count;
+    Patch(offsetof(BvhFileHeader, root), &root, sizeof(root));
+
+    EXPECT_THROW(BVH<double>::Map(filename), std::runtime_error);
+}
+
+TEST_F(SavedBVHTest, MissingFileThrows) {
+    EXPECT_THROW(BVH<double>::Map(filename), std::runtime_error);
+}
+
+// LBVH builder ------------------------------------------------------------------------------------
+
+TEST(BVHTraversalTest, LbvhMatchesAnswers) {
+    for (int i = 1; i <= 10; ++i) {
+        BVH<double> bvh(LoadTestData(std::to_string(i) + ".dat"), {.split_method = SplitMethod::kLbvh});
+
+        EXPECT_EQ(bvh.FindIntersectingTriangles().ToVector(), LoadAnswers(std::to_string(i) + ".ans"))
+            << "test " << i;
+    }
+}
+
+TEST_F(BVHTest, LbvhBuildCoversAllTriangles) {
+    for (size_t max_leaf_size : {1, 3, 8}) {
+        BVH<double> bvh(MakeClusteredTriangles(20, 50),
+                        {.split_method = SplitMethod::kLbvh, .max_leaf_size = max_leaf_size});
+
+        std::set<TrIndex> ids;
+        EXPECT_EQ(CheckSubtree(bvh, bvh.GetRoot(), ids), 1000u);
+        EXPECT_EQ(ids.size(), 1000u);
+        EXPECT_EQ(bvh.GetRoot(), bvh.GetNode(bvh.GetNumberOfNodes() - 1));
+    }
+}
+
+TEST_F(BVHTest, LbvhMatchesMedianIntersections) {
+    BVH<double> median(MakeClusteredTriangles(40, 100));
+    BVH<double> lbvh(MakeClusteredTriangles(40, 100), {.split_method = SplitMethod::kLbvh});
+
+    auto expected = median.FindIntersectingTriangles();
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(lbvh.FindIntersectingTriangles(), expected);
+}
+
+TEST_F(BVHTest, ParallelLbvhBuildIdenticalToSerial) {
+    BuildOptions options{.split_method = SplitMethod::kLbvh};
+    BVH<double> serial(MakeClusteredTriangles(40, 100), options);
+
+    options.execution = concurrency::Execution::kParallel;
+    options.parallel_threshold = 64;
+    BVH<double> parallel(MakeClusteredTriangles(40, 100), options);
+
+    ExpectIdenticalTrees(serial, parallel);
+}
+
+TEST_F(BVHTest, LbvhOfEqualCentroids) {
+    // every code equal, so the ranges are split in the middle
+    std::vector<IndexedTriangle<double>> stacked;
+    for (TrIndex i = 0; i != 100; ++i) {
+        double d = 0.01 * i;
+        stacked.emplace_back(i, Triangle<double>{Point<double>{-1 - d, 0, 0}, Point<double>{1 + d, 0, 0},
+                                                 Point<double>{0, 3, 0}});
+    }
+
+    BVH<double> bvh(std::move(stacked), {.split_method = SplitMethod::kLbvh, .max_leaf_size = 1});
+
+    std::set<TrIndex> ids;
+    EXPECT_EQ(CheckSubtree(bvh, bvh.GetRoot(), ids), 100u);
+    EXPECT_EQ(bvh.GetNumberOfNodes(), 199u);
+    EXPECT_EQ(bvh.FindIntersectingTriangles().size(), 100u);
+}
+
+TEST_F(BVHTest, LbvhRefitMatchesRebuild) {
+    BuildOptions options{.split_method = SplitMethod::kLbvh};
+    BVH<double> bvh(MakeClusteredTriangles(40, 100), options);
+
+    auto moved = MoveTriangles(MakeClusteredTriangles(40, 100), 13);
+    for (const auto& tr : moved) {
+        bvh.SetTriangle(tr.id, tr.triangle);
+    }
+    bvh.Refit(concurrency::Execution::kParallel);
+
+    EXPECT_EQ(bvh.FindIntersectingTriangles(), BVH<double>(std::move(moved), options).FindIntersectingTriangles());
+}
@@ -0,0 +1,306 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+#include "bvh.hpp"
+#include "dynamic_bvh.hpp"
+#include "indexed_triangle.hpp"
+
+#include "test_helpers.hpp"
+
+using namespace geometry;
+using namespace geometry::acceleration;
+using test_helpers::MakeTriangle;
+using test_helpers::MakeTriangles;
+
+namespace {
+
+using Pairs = std::set<std::pair<TrIndex, TrIndex>>;
+
+/**
+ * Intersecting pairs of the triangles present, at least one of them in only if only is not empty
+ */
+Pairs BruteForcePairs(const std::vector<std::optional<Triangle<double>>>& triangles,
+                      const std::set<TrIndex>& only = {})
+{
+    Pairs pairs;
+    for (TrIndex i = 0; i != triangles.size(); ++i) {
+        for (TrIndex j = i + 1; j != triangles.size(); ++j) {
+            if (!triangles[i] || !triangles[j]) {
+                continue;
+            }
+            if (!only.empty() && !only.contains(i) && !only.contains(j)) {
+                continue;
+            }
+            if (Triangle<double>::Intersect(*triangles[i], *triangles[j])) {
+                pairs.emplace(i, j);
+            }
+        }
+    }
+    return pairs;
+}
+
+Pairs AllPairs(const DynamicBVH<double>& tree) {
+    Pairs pairs;
+    tree.ForEachIntersectingPair([&pairs](TrIndex a, TrIndex b) {
+        EXPECT_LT(a, b);
+        EXPECT_TRUE(pairs.emplace(a, b).second);
+    });
+    return pairs;
+}
+
+Pairs TouchedPairs(DynamicBVH<double>& tree, TraversalStats* stats = nullptr) {
+    Pairs pairs;
+    tree.ForEachTouchedPair([&pairs](TrIndex a, TrIndex b) {
+        EXPECT_LT(a, b);
+        EXPECT_TRUE(pairs.emplace(a, b).second);
+    }, stats);
+    return pairs;
+}
+
+/**
+ * Checks the links, boxes and heights of the subtree idx and returns the number of its leaves
+ */
+size_t CheckSubtree(const DynamicBVH<double>& tree, NodeIdx idx, NodeIdx parent) {
+    const auto* node = tree.GetNode(idx);
+    EXPECT_EQ(node->parent, parent);
+    if (node->IsLeaf()) {
+        EXPECT_EQ(node->height, 0u);
+        return 1;
+    }
+
+    const auto* left = tree.GetNode(node->left);
+    const auto* right = tree.GetNode(node->right);
+    for (const auto* child : {left, right}) {
+        EXPECT_LE(node->aabb.min.x, child->aabb.min.x);
+        EXPECT_LE(node->aabb.min.y, child->aabb.min.y);
+        EXPECT_GE(node->aabb.max.z, child->aabb.max.z);
+    }
+    EXPECT_EQ(node->height, 1 + std::max(left->height, right->height));
+
+    return CheckSubtree(tree, node->left, idx) + CheckSubtree(tree, node->right, idx);
+}
+
+void CheckTree(const DynamicBVH<double>& tree) {
+    if (tree.Size() == 0) {
+        EXPECT_EQ(tree.GetRoot(), nullptr);
+        return;
+    }
+
+    const auto* root = tree.GetRoot();
+    ASSERT_NE(root, nullptr);
+    EXPECT_EQ(root->parent, invalid_idx);
+    if (root->IsLeaf()) {
+        EXPECT_EQ(tree.Size(), 1u);
+        return;
+    }
+
+    NodeIdx root_idx = tree.GetNode(root->left)->parent;
+    ASSERT_EQ(tree.GetNode(root_idx), root);
+    EXPECT_EQ(CheckSubtree(tree, root_idx, invalid_idx), tree.Size());
+}
+
+} // namespace
+
+// Construction ------------------------------------------------------------------------------------
+
+TEST(DynamicBVHTest, EmptyTree) {
+    DynamicBVH<double> tree;
+
+    EXPECT_EQ(tree.Size(), 0u);
+    EXPECT_EQ(tree.GetRoot(), nullptr);
+    EXPECT_EQ(tree.GetHeight(), 0u);
+    EXPECT_TRUE(tree.FindIntersectingTriangles().empty());
+    EXPECT_TRUE(TouchedPairs(tree).empty());
+}
+
+TEST(DynamicBVHTest, MatchesBuiltTree) {
+    auto triangles = MakeTriangles(2000, 60, 3, 1);
+    DynamicBVH<double> tree(triangles);
+    BVH<double> bvh{std::vector(triangles)};
+
+    CheckTree(tree);
+    EXPECT_EQ(tree.Size(), triangles.size());
+    EXPECT_EQ(tree.FindIntersectingTriangles(), bvh.FindIntersectingTriangles());
+
+    Pairs expected;
+    bvh.ForEachIntersectingPair([&expected](TrIndex a, TrIndex b) { expected.emplace(a, b); });
+    EXPECT_EQ(AllPairs(tree), expected);
+}
+
+TEST(DynamicBVHTest, SortedInsertionKeepsTreeShallow) {
+    DynamicBVH<double> tree;
+    for (TrIndex i = 0; i != 4096; ++i) {
+        double x = 2.0 * i;
+        tree.Insert(i, Triangle<double>{Point<double>{x, 0, 0}, Point<double>{x + 1, 0, 0}, Point<double>{x, 1, 0}});
+    }
+
+    CheckTree(tree);
+    // a list would be 4095 levels deep
+    EXPECT_LE(tree.GetHeight(), 4 * 12u);
+    EXPECT_TRUE(tree.FindIntersectingTriangles().empty());
+}
+
+TEST(DynamicBVHTest, SahCostCloseToBuiltTree) {
+    auto triangles = MakeTriangles(4000, 200, 3, 2);
+    DynamicBVH<double> tree(triangles);
+    BVH<double> bvh{std::vector(triangles), {.split_method = SplitMethod::kSah, .max_leaf_size = 1}};
+
+    EXPECT_LE(tree.GetSahCost(), 1.5 * bvh.GetSahCost());
+}
+
+// Edits -------------------------------------------------------------------------------------------
+
+TEST(DynamicBVHTest, RandomEditsMatchBruteForce) {
+    std::mt19937 gen(3);
+    std::vector<std::optional<Triangle<double>>> present(300);
+    DynamicBVH<double> tree;
+
+    for (size_t step = 0; step != 2000; ++step) {
+        TrIndex id = std::uniform_int_distribution<TrIndex>(0, present.size() - 1)(gen);
+        if (!present[id]) {
+            present[id] = MakeTriangle(gen, 25, 3);
+            tree.Insert(id, *present[id]);
+        } else if (gen() % 2) {
+            present[id] = MakeTriangle(gen, 25, 3);
+            tree.Update(id, *present[id]);
+        } else {
+            present[id].reset();
+            tree.Remove(id);
+        }
+
+        if (step % 250 == 0) {
+            CheckTree(tree);
+            EXPECT_EQ(AllPairs(tree), BruteForcePairs(present));
+        }
+    }
+
+    size_t count = std::count_if(present.begin(), present.end(), [](const auto& tr) { return tr.has_value(); });
+    EXPECT_EQ(tree.Size(), count);
+    for (TrIndex id = 0; id != present.size(); ++id) {
+        EXPECT_EQ(tree.Contains(id), present[id].has_value());
+    }
+    CheckTree(tree);
+    EXPECT_EQ(AllPairs(tree), BruteForcePairs(present));
+}
+
+TEST(DynamicBVHTest, RemoveEverything) {
+    auto triangles = MakeTriangles(100, 10, 3, 4);
+    DynamicBVH<double> tree(triangles);
+
+    for (const auto& tr : triangles) {
+        tree.Remove(tr.id);
+    }
+
+    EXPECT_EQ(tree.Size(), 0u);
+    EXPECT_EQ(tree.GetRoot(), nullptr);
+    EXPECT_TRUE(AllPairs(tree).empty());
+
+    // the nodes are reused
+    tree.Insert(7, triangles[7].triangle);
+    EXPECT_TRUE(tree.Contains(7));
+    EXPECT_EQ(tree.Size(), 1u);
+}
+
+TEST(DynamicBVHTest, DuplicateInsertThrows) {
+    DynamicBVH<double> tree(MakeTriangles(3, 10, 3, 5));
+
+    EXPECT_THROW(tree.Insert(1, MakeTriangles(1, 10, 3, 6)[0].triangle), std::invalid_argument);
+    EXPECT_EQ(tree.Size(), 3u);
+}
+
+TEST(DynamicBVHTest, UnknownIdThrows) {
+    DynamicBVH<double> tree(MakeTriangles(3, 10, 3, 5));
+    auto triangle = MakeTriangles(1, 10, 3, 6)[0].triangle;
+
+    EXPECT_THROW(tree.Remove(3), std::invalid_argument);
+    EXPECT_THROW(tree.Update(100, triangle), std::invalid_argument);
+
+    tree.Remove(1);
+    EXPECT_THROW(tree.Remove(1), std::invalid_argument);
+    EXPECT_THROW(tree.Update(1, triangle), std::invalid_argument);
+}
+
+// Touched triangles -------------------------------------------------------------------------------
+
+TEST(DynamicBVHTest, FirstTouchedQueryReportsAllPairs) {
+    auto triangles = MakeTriangles(500, 20, 3, 7);
+    DynamicBVH<double> tree(triangles);
+
+    Pairs all = AllPairs(tree);
+    EXPECT_EQ(TouchedPairs(tree), all);
+    EXPECT_TRUE(TouchedPairs(tree).empty());
+}
+
+TEST(DynamicBVHTest, TouchedPairsMatchBruteForce) {
+    std::mt19937 gen(8);
+    std::vector<std::optional<Triangle<double>>> present(400);
+    DynamicBVH<double> tree;
+    for (TrIndex id = 0; id != present.size(); ++id) {
+        present[id] = MakeTriangle(gen, 25, 3);
+        tree.Insert(id, *present[id]);
+    }
+    TouchedPairs(tree);
+
+    for (size_t round = 0; round != 20; ++round) {
+        std::set<TrIndex> touched;
+        for (size_t edit = 0; edit != 10; ++edit) {
+            TrIndex id = std::uniform_int_distribution<TrIndex>(0, present.size() - 1)(gen);
+            if (!present[id]) {
+                present[id] = MakeTriangle(gen, 25, 3);
+                tree.Insert(id, *present[id]);
+                touched.insert(id);
+            } else if (gen() % 4) {
+                present[id] = MakeTriangle(gen, 25, 3);
+                tree.Update(id, *present[id]);
+                touched.insert(id);
+            } else {
+                present[id].reset();
+                tree.Remove(id);
+                touched.erase(id);
+            }
+        }
+
+        Pairs expected = touched.empty() ? Pairs{} : BruteForcePairs(present, touched);
+        EXPECT_EQ(TouchedPairs(tree), expected);
+    }
+}
+
+TEST(DynamicBVHTest, TouchedQueryDoesLessWork) {
+    auto triangles = MakeTriangles(20000, 150, 3, 9);
+    DynamicBVH<double> tree(triangles);
+    TouchedPairs(tree);
+
+    std::mt19937 gen(10);
+    for (TrIndex id = 0; id != 10; ++id) {
+        tree.Update(id * 1000, MakeTriangle(gen, 150, 3));
+    }
+
+    TraversalStats full;
+    tree.ForEachIntersectingPair([](TrIndex, TrIndex) {}, &full);
+    TraversalStats touched;
+    TouchedPairs(tree, &touched);
+
+    EXPECT_GT(touched.aabb_tests, 0u);
+    EXPECT_LT(touched.aabb_tests * 100, full.aabb_tests);
+}
+
+TEST(DynamicBVHTest, VisitorReturningFalseStopsTouchedQuery) {
+    auto triangles = MakeTriangles(500, 10, 3, 11);
+    DynamicBVH<double> tree(triangles);
+
+    size_t calls = 0;
+    tree.ForEachTouchedPair([&calls](TrIndex, TrIndex) {
+        ++calls;
+        return false;
+    });
+    EXPECT_EQ(calls, 1u);
+
+    // the touched triangles are forgotten all the same
+    EXPECT_TRUE(TouchedPairs(tree).empty());
+}
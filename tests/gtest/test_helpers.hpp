@@ -0,0 +1,100 @@
+#pragma once
+
+#include <random>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+#include "triangle.hpp"
+#include "parse_input.hpp"
+#include "indexed_triangle.hpp"
+#include "intersection_result.hpp"
+
+namespace test_helpers {
+
+using geometry::Point;
+using geometry::Triangle;
+using geometry::acceleration::TrIndex;
+using geometry::acceleration::IndexedTriangle;
+using geometry::acceleration::IntersectionResult;
+
+/**
+ * Row of count disjoint unit triangles along x, two units apart
+ */
+inline std::vector<IndexedTriangle<double>> MakeRow(size_t count) {
+    std::vector<IndexedTriangle<double>> triangles;
+    for (size_t i = 0; i != count; ++i) {
+        double x = 2.0 * i;
+        triangles.emplace_back(i, Triangle<double>{Point<double>{x, 0, 0}, Point<double>{x + 1, 0, 0},
+                                                   Point<double>{x, 1, 0}});
+    }
+    return triangles;
+}
+
+/**
+ * Triangle with its vertices within size of a center in [-extent, extent]^3
+ */
+inline Triangle<double> MakeTriangle(std::mt19937& gen, double extent, double size) {
+    std::uniform_real_distribution<double> center(-extent, extent);
+    std::uniform_real_distribution<double> offset(-size, size);
+
+    Point<double> c{center(gen), center(gen), center(gen)};
+    auto p = [&] { return Point<double>{c.x + offset(gen), c.y + offset(gen), c.z + offset(gen)}; };
+    return Triangle<double>{p(), p(), p()};
+}
+
+/**
+ * count triangles of MakeTriangle with the ids 0, 1, ...
+ */
+inline std::vector<IndexedTriangle<double>> MakeTriangles(size_t count, double extent, double size, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::vector<IndexedTriangle<double>> triangles;
+    for (size_t i = 0; i != count; ++i) {
+        triangles.emplace_back(i, MakeTriangle(gen, extent, size));
+    }
+    return triangles;
+}
+
+/**
+ * Ids of all intersecting triangles by testing every pair
+ */
+inline IntersectionResult BruteForce(const std::vector<IndexedTriangle<double>>& triangles) {
+    TrIndex capacity = 0;
+    for (const auto& tr : triangles) {
+        capacity = std::max(capacity, tr.id + 1);
+    }
+
+    IntersectionResult result(capacity);
+    for (size_t i = 0; i != triangles.size(); ++i) {
+        for (size_t j = i + 1; j != triangles.size(); ++j) {
+            if (Triangle<double>::Intersect(triangles[i].triangle, triangles[j].triangle)) {
+                result.Insert(triangles[i].id);
+                result.Insert(triangles[j].id);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * Triangles of an e2e dataset in TEST_DATA_DIR
+ */
+inline std::vector<IndexedTriangle<double>> LoadTestData(const std::string& name) {
+    std::ifstream file(std::string(TEST_DATA_DIR) + "/" + name);
+    return app::ParseInput<double>(file);
+}
+
+/**
+ * Expected ids of an e2e dataset in TEST_DATA_DIR
+ */
+inline std::vector<TrIndex> LoadAnswers(const std::string& name) {
+    std::ifstream file(std::string(TEST_DATA_DIR) + "/" + name);
+    std::vector<TrIndex> answers;
+    for (TrIndex id = 0; file >> id;) {
+        answers.push_back(id);
+    }
+    return answers;
+}
+
+} // namespace test_helpers
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "intersection_result.hpp"
+
+using namespace geometry::acceleration;
+
+// Insert and lookup -------------------------------------------------------------------------------
+
+TEST(IntersectionResultTest, EmptyResult) {
+    IntersectionResult empty;
+    IntersectionResult sized(1000);
+
+    EXPECT_TRUE(empty.empty());
+    EXPECT_TRUE(sized.empty());
+    EXPECT_EQ(sized.size(), 0u);
+    EXPECT_EQ(sized.begin(), sized.end());
+    EXPECT_FALSE(sized.Contains(5));
+    EXPECT_FALSE(sized.Contains(5000));
+}
+
+TEST(IntersectionResultTest, IteratesSortedWithoutDuplicates) {
+    IntersectionResult result(200);
+    for (TrIndex id : {130, 0, 63, 64, 199, 63, 1}) {
+        result.Insert(id);
+    }
+
+    EXPECT_EQ(result.size(), 6u);
+    EXPECT_FALSE(result.empty());
+    EXPECT_EQ(result.ToVector(), (std::vector<TrIndex>{0, 1, 63, 64, 130, 199}));
+    EXPECT_TRUE(result.Contains(64));
+    EXPECT_FALSE(result.Contains(65));
+}
+
+TEST(IntersectionResultTest, EqualityComparesIds) {
+    IntersectionResult a(100);
+    IntersectionResult b(1000);
+    a.Insert(7);
+    b.Insert(7);
+
+    EXPECT_EQ(a, b);
+
+    b.Insert(500);
+    EXPECT_FALSE(a == b);
+}
+
+// Concurrency -------------------------------------------------------------------------------------
+
+TEST(IntersectionResultTest, ConcurrentAtomicInserts) {
+    const size_t n = 100000;
+    IntersectionResult result(n);
+
+    // neighbouring ids share a word, so the threads race on every word
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t != 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t id = t; id < n; id += 4) {
+                result.AtomicInsert(id);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(result.size(), n);
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+#include "morton.hpp"
+
+using namespace geometry;
+using namespace geometry::acceleration;
+
+namespace {
+
+/**
+ * Morton code of the cells (x, y, z) interleaved one bit at a time
+ */
+template <typename Code>
+Code InterleaveBits(Code x, Code y, Code z) {
+    Code code = 0;
+    for (unsigned bit = 0; bit != kMortonBitsPerAxis<Code>; ++bit) {
+        code |= ((x >> bit) & 1) << (3 * bit + 2);
+        code |= ((y >> bit) & 1) << (3 * bit + 1);
+        code |= ((z >> bit) & 1) << (3 * bit);
+    }
+    return code;
+}
+
+template <typename Key>
+void ExpectSortedLikeStableSort(std::vector<Key> keys, bool parallel, size_t chunk) {
+    std::vector<size_t> values(keys.size());
+    std::iota(values.begin(), values.end(), 0);
+
+    std::vector<size_t> expected = values;
+    std::stable_sort(expected.begin(), expected.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+
+    RadixSortByKey(keys, values, parallel, chunk);
+
+    EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+    EXPECT_EQ(values, expected);
+}
+
+} // namespace
+
+// Morton codes ------------------------------------------------------------------------------------
+
+TEST(MortonTest, SpreadMatchesInterleaving) {
+    std::mt19937 gen(1);
+
+    std::uniform_int_distribution<uint32_t> cell32(0, (1u << 10) - 1);
+    for (size_t i = 0; i != 1000; ++i) {
+        uint32_t x = cell32(gen), y = cell32(gen), z = cell32(gen);
+        EXPECT_EQ((SpreadMortonBits(x) << 2) | (SpreadMortonBits(y) << 1) | SpreadMortonBits(z),
+                  InterleaveBits(x, y, z));
+    }
+
+    std::uniform_int_distribution<uint64_t> cell64(0, (uint64_t{1} << 21) - 1);
+    for (size_t i = 0; i != 1000; ++i) {
+        uint64_t x = cell64(gen), y = cell64(gen), z = cell64(gen);
+        EXPECT_EQ((SpreadMortonBits(x) << 2) | (SpreadMortonBits(y) << 1) | SpreadMortonBits(z),
+                  InterleaveBits(x, y, z));
+    }
+}
+
+TEST(MortonTest, CodeWidths) {
+    AABB<double> bounds{Point<double>{0, 0, 0}, Point<double>{1, 1, 1}};
+    AABB<float> float_bounds{Point<float>{0, 0, 0}, Point<float>{1, 1, 1}};
+
+    EXPECT_EQ(EncodeMorton(Point<double>{0, 0, 0}, bounds), 0u);
+    EXPECT_EQ(EncodeMorton(Point<double>{1, 1, 1}, bounds), (uint64_t{1} << 63) - 1);
+    EXPECT_EQ(EncodeMorton(Point<float>{1, 1, 1}, float_bounds), (1u << 30) - 1);
+
+    // the point is clamped into the bounds
+    EXPECT_EQ(EncodeMorton(Point<double>{-5, 0.5, 7}, bounds),
+              InterleaveBits<uint64_t>(0, uint64_t{1} << 20, (uint64_t{1} << 21) - 1));
+}
+
+TEST(MortonTest, FlatBoundsGiveZeroCells) {
+    AABB<double> flat{Point<double>{0, 2, 0}, Point<double>{1, 2, 1}};
+
+    EXPECT_EQ(EncodeMorton(Point<double>{1, 2, 0}, flat), InterleaveBits<uint64_t>((uint64_t{1} << 21) - 1, 0, 0));
+}
+
+TEST(MortonTest, CodesFollowTheCurve) {
+    AABB<double> bounds{Point<double>{0, 0, 0}, Point<double>{8, 8, 8}};
+
+    // the eight octants in z-order
+    uint64_t previous = 0;
+    for (int octant = 0; octant != 8; ++octant) {
+        Point<double> p{(octant & 4) ? 6.0 : 2.0, (octant & 2) ? 6.0 : 2.0, (octant & 1) ? 6.0 : 2.0};
+        uint64_t code = EncodeMorton(p, bounds);
+        EXPECT_EQ(code >> 60, static_cast<uint64_t>(octant));
+        EXPECT_GE(code, previous);
+        previous = code;
+    }
+}
+
+// Radix sort --------------------------------------------------------------------------------------
+
+TEST(RadixSortTest, MatchesStableSort) {
+    std::mt19937 gen(2);
+    std::vector<uint64_t> wide(10000);
+    std::vector<uint32_t> narrow(10000);
+    for (size_t i = 0; i != wide.size(); ++i) {
+        wide[i] = std::uniform_int_distribution<uint64_t>()(gen);
+        // few distinct keys, so that the stability shows
+        narrow[i] = std::uniform_int_distribution<uint32_t>(0, 50)(gen) << 12;
+    }
+
+    ExpectSortedLikeStableSort(wide, false, 0);
+    ExpectSortedLikeStableSort(narrow, false, 0);
+}
+
+TEST(RadixSortTest, ParallelMatchesSerial) {
+    std::mt19937 gen(3);
+    std::vector<uint64_t> keys(20011);
+    for (auto& key : keys) {
+        key = std::uniform_int_distribution<uint64_t>(0, 1000)(gen) * 0x100000001ull;
+    }
+
+    for (size_t chunk : {64, 1000, 100000}) {
+        ExpectSortedLikeStableSort(keys, true, chunk);
+    }
+}
+
+TEST(RadixSortTest, EmptyAndEqualKeys) {
+    ExpectSortedLikeStableSort(std::vector<uint32_t>{}, true, 4);
+    ExpectSortedLikeStableSort(std::vector<uint32_t>(100, 0xdeadbeef), true, 4);
+    ExpectSortedLikeStableSort(std::vector<uint64_t>{3, 2, 1}, false, 1);
+}
@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+#include "node_order.hpp"
+#include "wide_node.hpp"
+
+#include "test_helpers.hpp"
+
+using namespace geometry;
+using namespace geometry::acceleration;
+using test_helpers::MakeRow;
+
+namespace {
+
+/**
+ * Children of a complete binary tree of count nodes in heap order, node i having 2i + 1 and 2i + 2
+ */
+auto HeapChildren(size_t count) {
+    return [count](size_t node, std::vector<size_t>& out) {
+        for (size_t child : {2 * node + 1, 2 * node + 2}) {
+            if (child < count) {
+                out.push_back(child);
+            }
+        }
+    };
+}
+
+/**
+ * Checks that order holds every node of the tree once, each after its parent
+ */
+template <typename Children>
+void ExpectParentsFirst(const std::vector<size_t>& order, size_t count, Children children) {
+    std::vector<size_t> rank(count, count);
+    for (size_t i = 0; i != order.size(); ++i) {
+        ASSERT_LT(order[i], count);
+        EXPECT_EQ(rank[order[i]], count) << "node " << order[i] << " twice";
+        rank[order[i]] = i;
+    }
+
+    for (size_t node : order) {
+        std::vector<size_t> below;
+        children(node, below);
+        for (size_t child : below) {
+            EXPECT_LT(rank[node], rank[child]);
+        }
+    }
+}
+
+} // namespace
+
+// Orders ------------------------------------------------------------------------------------------
+
+TEST(NodeOrderTest, DepthFirstIsPreorder) {
+    EXPECT_EQ(OrderNodes(7, 0, NodeOrder::kDepthFirst, HeapChildren(7)),
+              (std::vector<size_t>{0, 1, 3, 4, 2, 5, 6}));
+}
+
+TEST(NodeOrderTest, BreadthFirstIsLevelOrder) {
+    EXPECT_EQ(OrderNodes(7, 0, NodeOrder::kBreadthFirst, HeapChildren(7)),
+              (std::vector<size_t>{0, 1, 2, 3, 4, 5, 6}));
+}
+
+TEST(NodeOrderTest, VanEmdeBoasSplitsLevelsInHalves) {
+    // two top levels, then the four subtrees of two levels below them
+    EXPECT_EQ(OrderNodes(15, 0, NodeOrder::kVanEmdeBoas, HeapChildren(15)),
+              (std::vector<size_t>{0, 1, 2, 3, 7, 8, 4, 9, 10, 5, 11, 12, 6, 13, 14}));
+}
+
+TEST(NodeOrderTest, SingleNode) {
+    for (NodeOrder order : {NodeOrder::kDepthFirst, NodeOrder::kBreadthFirst, NodeOrder::kVanEmdeBoas}) {
+        EXPECT_EQ(OrderNodes(1, 0, order, HeapChildren(1)), std::vector<size_t>{0});
+    }
+}
+
+TEST(NodeOrderTest, UnbalancedTreesKeepParentsFirst) {
+    std::mt19937 gen(3);
+
+    for (size_t round = 0; round != 20; ++round) {
+        // random binary tree: every new node hangs below a random node with a free child
+        std::vector<std::vector<size_t>> tree(1);
+        for (size_t node = 1; node != 300; ++node) {
+            size_t parent = 0;
+            do {
+                parent = std::uniform_int_distribution<size_t>(0, node - 1)(gen);
+            } while (tree[parent].size() == 2);
+            tree[parent].push_back(node);
+            tree.emplace_back();
+        }
+
+        auto children = [&tree](size_t node, std::vector<size_t>& out) {
+            out.insert(out.end(), tree[node].begin(), tree[node].end());
+        };
+
+        for (NodeOrder order : {NodeOrder::kDepthFirst, NodeOrder::kBreadthFirst, NodeOrder::kVanEmdeBoas}) {
+            auto nodes = OrderNodes(tree.size(), 0, order, children);
+            EXPECT_EQ(nodes.size(), tree.size());
+            ExpectParentsFirst(nodes, tree.size(), children);
+        }
+    }
+}
+
+// Layouts -----------------------------------------------------------------------------------------
+
+namespace {
+
+/**
+ * Post-order tree with one triangle per leaf; every right child switches between halving its
+ * triangles and splitting off the first one, so the subtrees have very different depths
+ */
+NodeIdx BuildTree(std::vector<BVHNode<double>>& nodes, const std::vector<IndexedTriangle<double>>& triangles,
+                  size_t start, size_t end, bool halves)
+{
+    AABB<double> box{triangles[start].triangle};
+    for (size_t i = start + 1; i != end; ++i) {
+        box.Expand(triangles[i].triangle);
+    }
+
+    if (end - start == 1) {
+        nodes.emplace_back(box, std::span<const IndexedTriangle<double>>(triangles.data() + start, 1));
+        return nodes.size() - 1;
+    }
+
+    size_t mid = halves ? start + (end - start) / 2 : start + 1;
+    NodeIdx left = BuildTree(nodes, triangles, start, mid, halves);
+    NodeIdx right = BuildTree(nodes, triangles, mid, end, !halves);
+    nodes.emplace_back(box, left, right);
+    return nodes.size() - 1;
+}
+
+/**
+ * Triangle positions below the packed node idx, left to right
+ */
+void CollectPacked(const std::vector<PackedNode<float>>& packed, NodeIdx idx, std::vector<size_t>& positions) {
+    const auto& node = packed[idx];
+    if (node.IsLeaf()) {
+        positions.push_back(node.GetFirstTriangle());
+        return;
+    }
+
+    EXPECT_GT(node.GetLeftIdx(), idx);
+    CollectPacked(packed, node.GetLeftIdx(), positions);
+    CollectPacked(packed, node.GetRightIdx(), positions);
+}
+
+} // namespace
+
+TEST(NodeOrderTest, PackedLayoutsHoldTheSameTree) {
+    auto triangles = MakeRow(200);
+    std::vector<BVHNode<double>> nodes;
+    NodeIdx root = BuildTree(nodes, triangles, 0, triangles.size(), true);
+
+    std::vector<size_t> expected(triangles.size());
+    std::iota(expected.begin(), expected.end(), 0);
+
+    auto depth_first = PackNodes<float>(nodes, root, triangles.data());
+    for (NodeOrder order : {NodeOrder::kDepthFirst, NodeOrder::kBreadthFirst, NodeOrder::kVanEmdeBoas}) {
+        auto packed = PackNodes<float>(nodes, root, triangles.data(), order);
+        ASSERT_EQ(packed.size(), depth_first.size());
+
+        std::vector<size_t> positions;
+        CollectPacked(packed, kPackedRootIdx, positions);
+        EXPECT_EQ(positions, expected);
+    }
+
+    // level by level, the children of the two children of the root come next
+    auto breadth_first = PackNodes<float>(nodes, root, triangles.data(), NodeOrder::kBreadthFirst);
+    EXPECT_EQ(breadth_first[kPackedRootIdx].GetLeftIdx(), 2);
+    EXPECT_EQ(breadth_first[2].GetLeftIdx(), 4);
+    EXPECT_EQ(breadth_first[3].GetLeftIdx(), 6);
+}
+
+TEST(NodeOrderTest, WideLayoutsHoldTheSameTree) {
+    auto triangles = MakeRow(200);
+    std::vector<BVHNode<double>> nodes;
+    NodeIdx root = BuildTree(nodes, triangles, 0, triangles.size(), true);
+
+    auto depth_first = CollapseNodes<float, 4>(nodes, root, triangles.data());
+    for (NodeOrder order : {NodeOrder::kBreadthFirst, NodeOrder::kVanEmdeBoas}) {
+        auto wide = CollapseNodes<float, 4>(nodes, root, triangles.data(), order);
+        ASSERT_EQ(wide.size(), depth_first.size());
+
+        // the same nodes, the boxes of every lane agreeing once matched through the root
+        std::vector<std::pair<size_t, size_t>> stack{{0, 0}};
+        size_t visited = 0;
+        while (!stack.empty()) {
+            auto [a, b] = stack.back();
+            stack.pop_back();
+            ++visited;
+
+            for (size_t lane = 0; lane != 4; ++lane) {
+                EXPECT_EQ(wide[a].min_x[lane], depth_first[b].min_x[lane]);
+                EXPECT_EQ(wide[a].max_x[lane], depth_first[b].max_x[lane]);
+                EXPECT_EQ(wide[a].count[lane], depth_first[b].count[lane]);
+                if (wide[a].IsInner(lane)) {
+                    EXPECT_GT(wide[a].child[lane], a);
+                    stack.emplace_back(wide[a].child[lane], depth_first[b].child[lane]);
+                } else {
+                    EXPECT_EQ(wide[a].child[lane], depth_first[b].child[lane]);
+                }
+            }
+        }
+        EXPECT_EQ(visited, wide.size());
+    }
+}
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include <set>
+#include <vector>
+
+#include "packed_node.hpp"
+
+using namespace geometry;
+using namespace geometry::acceleration;
+
+class PackedNodeTest : public ::testing::Test {
+protected:
+    std::vector<IndexedTriangle<double>> triangles {
+        IndexedTriangle<double>(1, {Point<double>{0,0,0}, Point<double>{1,0,0}, Point<double>{0,1,0}}),
+        IndexedTriangle<double>(2, {Point<double>{2,0,0}, Point<double>{3,0,0}, Point<double>{2,1,0}}),
+        IndexedTriangle<double>(3, {Point<double>{4,0,0}, Point<double>{5,0,0}, Point<double>{4,1,0}}),
+        IndexedTriangle<double>(4, {Point<double>{6,0,0}, Point<double>{7,0,0}, Point<double>{6,1,0}})
+    };
+
+    /**
+     * Post-order tree ((t0, t1), (t2, t3)) with one triangle per leaf
+     */
+    std::vector<BVHNode<double>> MakeNodes() const {
+        std::vector<BVHNode<double>> nodes;
+        auto leaf = [&](size_t i) {
+            nodes.emplace_back(AABB<double>{triangles[i].triangle},
+                               std::span<const IndexedTriangle<double>>(triangles.data() + i, 1));
+        };
+        auto inner = [&](NodeIdx left, NodeIdx right) {
+            AABB<double> box = nodes[left].GetAABB();
+            box.Expand(nodes[right].GetAABB());
+            nodes.emplace_back(box, left, right);
+        };
+
+        leaf(0);
+        leaf(1);
+        inner(0, 1);
+        leaf(2);
+        leaf(3);
+        inner(3, 4);
+        inner(2, 5);
+        return nodes;
+    }
+};
+
+// Layout ------------------------------------------------------------------------------------------
+
+TEST(PackedNodeLayoutTest, SizeAndAlignment) {
+    EXPECT_EQ(sizeof(PackedNode<float>), 32u);
+    EXPECT_EQ(alignof(PackedNode<float>), 32u);
+    EXPECT_EQ(sizeof(PackedNode<double>), 64u);
+    EXPECT_EQ(alignof(PackedNode<double>), 64u);
+}
+
+TEST(PackedNodeLayoutTest, LeafAndInnerShareTheIndexField) {
+    AABB<float> box{Point<float>{0, 0, 0}, Point<float>{1, 1, 1}};
+
+    PackedNode<float> leaf(box, 10, 3);
+    EXPECT_TRUE(leaf.IsLeaf());
+    EXPECT_EQ(leaf.GetFirstTriangle(), 10u);
+    EXPECT_EQ(leaf.GetNumberOfTriangles(), 3u);
+
+    PackedNode<float> inner(box, 6);
+    EXPECT_FALSE(inner.IsLeaf());
+    EXPECT_EQ(inner.GetLeftIdx(), 6);
+    EXPECT_EQ(inner.GetRightIdx(), 7);
+    EXPECT_EQ(inner.GetNumberOfTriangles(), 0u);
+
+    PackedNode<float> empty(box, 0, 0);
+    EXPECT_TRUE(empty.IsLeaf());
+}
+
+// Bounds ------------------------------------------------------------------------------------------
+
+TEST(PackedNodeBoundsTest, FloatBoundsRoundOutwards) {
+    AABB<double> box{Point<double>{0.1, -0.1, 1e-30}, Point<double>{0.3, 1e30, 2.0 / 3}};
+    AABB<float> inflated = InflateBounds<float>(box);
+
+    for (size_t axis = 0; axis != 3; ++axis) {
+        EXPECT_LT(inflated.min[axis], box.min[axis]);
+        EXPECT_GT(inflated.max[axis], box.max[axis]);
+    }
+}
+
+TEST(PackedNodeBoundsTest, HugeBoundsStayConservative) {
+    AABB<double> box{Point<double>{-1e300, 0, 0}, Point<double>{1e300, 1, 1}};
+    AABB<float> inflated = InflateBounds<float>(box);
+
+    EXPECT_EQ(inflated.min.x, -std::numeric_limits<float>::infinity());
+    EXPECT_EQ(inflated.max.x, std::numeric_limits<float>::infinity());
+}
+
+TEST(PackedNodeBoundsTest, OverlapMatchesIntersects) {
+    AABB<double> base{Point<double>{0, 0, 0}, Point<double>{1, 1, 1}};
+
+    for (double gap : {-0.5, 0.0, 0.5e-12, 2e-12, 1e-6, 0.5}) {
+        AABB<double> other{Point<double>{1 + gap, 0, 0}, Point<double>{2, 1, 1}};
+        PackedNode<double> a(InflateBounds<double>(base), 0, 1);
+        PackedNode<double> b(InflateBounds<double>(other), 1, 1);
+
+        EXPECT_EQ(PackedNode<double>::Overlap(a, b), AABB<double>::Intersects(base, other)) << "gap " << gap;
+    }
+}
+
+TEST(PackedNodeBoundsTest, EmptyBoxOverlapsNothing) {
+    PackedNode<float> empty;
+    PackedNode<float> all(InflateBounds<float>(AABB<double>{Point<double>{-1e9, -1e9, -1e9},
+                                                            Point<double>{1e9, 1e9, 1e9}}), 0, 1);
+
+    EXPECT_FALSE(PackedNode<float>::Overlap(empty, all));
+}
+
+// Packing -----------------------------------------------------------------------------------------
+
+TEST_F(PackedNodeTest, SiblingsAreAdjacent) {
+    auto nodes = MakeNodes();
+    auto packed = PackNodes<float>(nodes, nodes.size() - 1, triangles.data());
+
+    ASSERT_EQ(packed.size(), nodes.size() + 1);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(packed.data()) % 32, 0u);
+
+    std::set<size_t> positions;
+    for (size_t idx = 0; idx != packed.size(); ++idx) {
+        if (!packed[idx].IsLeaf()) {
+            EXPECT_EQ(packed[idx].GetLeftIdx() % 2, 0);
+            EXPECT_GT(packed[idx].GetLeftIdx(), static_cast<NodeIdx>(idx));
+        } else if (packed[idx].GetNumberOfTriangles() != 0) {
+            positions.insert(packed[idx].GetFirstTriangle());
+        }
+    }
+
+    EXPECT_EQ(positions, (std::set<size_t>{0, 1, 2, 3}));
+}
+
+TEST_F(PackedNodeTest, ChildrenContainTheirLeaves) {
+    auto nodes = MakeNodes();
+    auto packed = PackNodes<double>(nodes, nodes.size() - 1, triangles.data());
+
+    const auto& root = packed[kPackedRootIdx];
+    ASSERT_FALSE(root.IsLeaf());
+
+    // the left subtree holds the first two triangles, depth-first
+    const auto& left = packed[root.GetLeftIdx()];
+    ASSERT_FALSE(left.IsLeaf());
+    EXPECT_EQ(packed[left.GetLeftIdx()].GetFirstTriangle(), 0u);
+    EXPECT_EQ(packed[left.GetRightIdx()].GetFirstTriangle(), 1u);
+    EXPECT_EQ(left.GetLeftIdx(), root.GetLeftIdx() + 2);
+
+    for (size_t i = 0; i != triangles.size(); ++i) {
+        AABB<double> box{triangles[i].triangle};
+        EXPECT_LT(root.GetAABB().min.x, box.min.x);
+        EXPECT_GT(root.GetAABB().max.x, box.max.x);
+    }
+}
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#include "options.hpp"
+#include "pair_output.hpp"
+
+using namespace geometry;
+using namespace geometry::acceleration;
+
+class PairOutputTest : public ::testing::Test {
+protected:
+    BVH<double> tree {std::vector<IndexedTriangle<double>>{
+        IndexedTriangle<double>(0, {Point<double>{0,0,0}, Point<double>{2,0,0}, Point<double>{0,2,0}}),
+        IndexedTriangle<double>(1, {Point<double>{10,0,0}, Point<double>{11,0,0}, Point<double>{10,1,0}}),
+        IndexedTriangle<double>(2, {Point<double>{1,1,-1}, Point<double>{1,1,1}, Point<double>{0.5,0.5,0}})
+    }};
+};
+
+// Formats -----------------------------------------------------------------------------------------
+
+TEST_F(PairOutputTest, TextFormat) {
+    std::ostringstream stream;
+
+    EXPECT_EQ(app::WriteIntersectingPairs(tree, stream, app::PairsFormat::kText), 1u);
+    EXPECT_EQ(stream.str(), "0 2\n");
+}
+
+TEST_F(PairOutputTest, BinaryFormat) {
+    std::ostringstream stream;
+
+    EXPECT_EQ(app::WriteIntersectingPairs(tree, stream, app::PairsFormat::kBinary), 1u);
+
+    std::string bytes = stream.str();
+    ASSERT_EQ(bytes.size(), 2 * sizeof(uint64_t));
+
+    std::array<uint64_t, 2> pair;
+    std::memcpy(pair.data(), bytes.data(), sizeof(pair));
+    EXPECT_EQ(pair[0], 0u);
+    EXPECT_EQ(pair[1], 2u);
+}
+
+TEST_F(PairOutputTest, LimitStopsOutput) {
+    std::ostringstream stream;
+    BVH<double> crowded {std::vector<IndexedTriangle<double>>{
+        IndexedTriangle<double>(0, {Point<double>{0,0,0}, Point<double>{2,0,0}, Point<double>{0,2,0}}),
+        IndexedTriangle<double>(1, {Point<double>{1,1,-1}, Point<double>{1,1,1}, Point<double>{0.5,0.5,0}}),
+        IndexedTriangle<double>(2, {Point<double>{0.5,0.5,-1}, Point<double>{0.5,0.5,1}, Point<double>{0,0,0.5}})
+    }};
+
+    EXPECT_EQ(app::WriteIntersectingPairs(crowded, stream, app::PairsFormat::kText), 3u);
+    EXPECT_EQ(app::WriteIntersectingPairs(crowded, stream, app::PairsFormat::kText, 1), 1u);
+}
+
+TEST_F(PairOutputTest, FailedStreamStopsOutput) {
+    // a stream buffer that accepts nothing, so the first pair already fails the stream
+    struct FailingBuffer : std::streambuf {
+        int_type overflow(int_type) override { return traits_type::eof(); }
+    } buffer;
+    std::ostream stream(&buffer);
+
+    EXPECT_THROW(app::WriteIntersectingPairs(tree, stream, app::PairsFormat::kText), std::runtime_error);
+    EXPECT_THROW(app::WriteIntersectingPairs(tree, stream, app::PairsFormat::kBinary), std::runtime_error);
+}
+
+// Options -----------------------------------------------------------------------------------------
+
+TEST(OptionsTest, ParsesPairsFormat) {
+    const char* text[] = {"triangles_3d", "--pairs", "text"};
+    const char* binary[] = {"triangles_3d", "--binary", "in.bin", "--pairs", "binary"};
+
+    EXPECT_EQ(app::ParseOptions(3, const_cast<char**>(text)).pairs, app::PairsFormat::kText);
+
+    app::Options options = app::ParseOptions(5, const_cast<char**>(binary));
+    EXPECT_EQ(options.pairs, app::PairsFormat::kBinary);
+    EXPECT_EQ(options.binary_input, "in.bin");
+}
+
+TEST(OptionsTest, RejectsUnknownPairsFormat) {
+    const char* unknown[] = {"triangles_3d", "--pairs", "csv"};
+    const char* missing[] = {"triangles_3d", "--pairs"};
+
+    EXPECT_THROW(app::ParseOptions(3, const_cast<char**>(unknown)), std::runtime_error);
+    EXPECT_THROW(app::ParseOptions(2, const_cast<char**>(missing)), std::runtime_error);
+}
+
+TEST(OptionsTest, ParsesEarlyExitOptions) {
+    const char* limit[] = {"triangles_3d", "--limit", "10", "--any"};
+
+    app::Options options = app::ParseOptions(4, const_cast<char**>(limit));
+    EXPECT_EQ(options.limit, 10u);
+    EXPECT_TRUE(options.any);
+    EXPECT_EQ(app::ParseOptions(1, const_cast<char**>(limit)).limit, app::kNoLimit);
+
+    for (const char* value : {"0", "-1", "ten", "10x"}) {
+        const char* invalid[] = {"triangles_3d", "--limit", value};
+        EXPECT_THROW(app::ParseOptions(3, const_cast<char**>(invalid)), std::runtime_error) << value;
+    }
+}
+
+TEST(OptionsTest, ParsesEngine) {
+    const char* grid[] = {"triangles_3d", "--engine", "grid"};
+    const char* sap[] = {"triangles_3d", "--binary", "in.bin", "--engine", "sap"};
+    const char* unknown[] = {"triangles_3d", "--engine", "octree"};
+
+    EXPECT_EQ(app::ParseOptions(1, const_cast<char**>(grid)).engine, app::Engine::kBvh);
+    EXPECT_EQ(app::ParseOptions(3, const_cast<char**>(grid)).engine, app::Engine::kGrid);
+    EXPECT_EQ(app::ParseOptions(5, const_cast<char**>(sap)).engine, app::Engine::kSap);
+    EXPECT_THROW(app::ParseOptions(3, const_cast<char**>(unknown)), std::runtime_error);
+}
+
+TEST(OptionsTest, RejectsTreeOptionsWithOtherEngines) {
+    const char* any[] = {"triangles_3d", "--engine", "sap", "--any"};
+    const char* pairs[] = {"triangles_3d", "--pairs", "text", "--engine", "grid"};
+    const char* tree[] = {"triangles_3d", "--engine", "sap", "--save-tree", "tree.bvh"};
+
+    EXPECT_THROW(app::ParseOptions(4, const_cast<char**>(any)), std::runtime_error);
+    EXPECT_THROW(app::ParseOptions(5, const_cast<char**>(pairs)), std::runtime_error);
+    EXPECT_THROW(app::ParseOptions(5, const_cast<char**>(tree)), std::runtime_error);
+}
@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+
+#include <set>
+#include <vector>
+#include <cstdint>
+
+#include "pair_traversal.hpp"
+
+using namespace geometry;
+using namespace geometry::acceleration;
+
+namespace {
+
+/**
+ * Degenerate tree whose every inner node has a leaf on the left: leaf i is node i, with the box
+ * [i + shift, i + shift + 1] on x, and the inner node above leaf i is node size + i
+ */
+struct ChainTree {
+    std::vector<BVHNode<double>> nodes;
+    NodeIdx root;
+
+    ChainTree(size_t size, double shift) {
+        for (size_t i = 0; i != size; ++i) {
+            nodes.emplace_back(LeafBox(i, shift), std::span<const IndexedTriangle<double>>{});
+        }
+
+        std::vector<BVHNode<double>> inner;
+        NodeIdx below = size - 1;
+        for (size_t i = size - 1; i-- != 0;) {
+            AABB<double> box = LeafBox(i, shift);
+            box.Expand(below < static_cast<NodeIdx>(size) ? nodes[below].GetAABB() : inner.back().GetAABB());
+            inner.emplace_back(box, static_cast<NodeIdx>(i), below);
+            below = size + i;
+        }
+
+        // inner was filled from the bottom, node size + i is the one above leaf i
+        nodes.insert(nodes.end(), inner.rbegin(), inner.rend());
+        root = below;
+    }
+
+    static AABB<double> LeafBox(size_t i, double shift) {
+        return {Point<double>{i + shift, 0, 0}, Point<double>{i + shift + 1, 1, 1}};
+    }
+};
+
+/**
+ * Query over two chains that records the leaf pairs
+ */
+struct RecordingQuery {
+    const ChainTree* first;
+    const ChainTree* second;
+    std::set<std::pair<NodeIdx, NodeIdx>> leaf_pairs;
+    size_t calls = 0;
+    size_t stop_after = SIZE_MAX;
+
+    const BVHNode<double>& NodeA(NodeIdx idx) const {
+        return first->nodes[idx];
+    }
+
+    const BVHNode<double>& NodeB(NodeIdx idx) const {
+        return second->nodes[idx];
+    }
+
+    bool Stopped() const {
+        return calls >= stop_after;
+    }
+
+    bool Prune(NodeIdx, NodeIdx) const {
+        return false;
+    }
+
+    bool Overlap(NodeIdx a, NodeIdx b) const {
+        return AABB<double>::Intersects(NodeA(a).GetAABB(), NodeB(b).GetAABB());
+    }
+
+    void IntersectLeaves(NodeIdx a, NodeIdx b) {
+        ++calls;
+        EXPECT_TRUE(leaf_pairs.emplace(a, b).second) << "leaves " << a << " and " << b << " visited twice";
+    }
+};
+
+std::set<std::pair<NodeIdx, NodeIdx>> OverlappingLeaves(const ChainTree& a, const ChainTree& b, bool self) {
+    size_t a_leaves = (a.nodes.size() + 1) / 2;
+    size_t b_leaves = (b.nodes.size() + 1) / 2;
+
+    std::set<std::pair<NodeIdx, NodeIdx>> pairs;
+    for (size_t i = 0; i != a_leaves; ++i) {
+        for (size_t j = self ? i : 0; j != b_leaves; ++j) {
+            if (AABB<double>::Intersects(a.nodes[i].GetAABB(), b.nodes[j].GetAABB())) {
+                pairs.emplace(i, j);
+            }
+        }
+    }
+
+    return pairs;
+}
+
+} // namespace
+
+// Stack -------------------------------------------------------------------------------------------
+
+TEST(PairStackTest, PopsInReverseOrderAcrossSpill) {
+    PairStack<int, 8> stack;
+    for (int i = 0; i != 1000; ++i) {
+        stack.Push(i);
+    }
+
+    EXPECT_TRUE(stack.Spilled());
+    EXPECT_EQ(stack.Size(), 1000u);
+
+    for (int i = 1000; i-- != 0;) {
+        ASSERT_FALSE(stack.Empty());
+        EXPECT_EQ(stack.Pop(), i);
+    }
+    EXPECT_TRUE(stack.Empty());
+}
+
+TEST(PairStackTest, SmallStackStaysInline) {
+    PairStack<int, 8> stack;
+    for (int i = 0; i != 8; ++i) {
+        stack.Push(i);
+    }
+
+    EXPECT_FALSE(stack.Spilled());
+    EXPECT_EQ(stack.Pop(), 7);
+}
+
+TEST(PairStackTest, PushIfKeepsOnlySelectedEntries) {
+    PairStack<int, 4> stack;
+    for (int i = 0; i != 20; ++i) {
+        stack.Reserve(1);
+        stack.PushIf(i, i % 3 == 0);
+    }
+
+    std::vector<int> popped;
+    while (!stack.Empty()) {
+        popped.push_back(stack.Pop());
+    }
+    EXPECT_EQ(popped, (std::vector<int>{18, 15, 12, 9, 6, 3, 0}));
+}
+
+// Traversal ---------------------------------------------------------------------------------------
+
+TEST(PairTraversalTest, TwoTreesMatchBruteForce) {
+    ChainTree first(300, 0);
+    ChainTree second(200, 0.5);
+    RecordingQuery query{&first, &second, {}, 0, SIZE_MAX};
+
+    NodePairStack stack;
+    TraverseNodePairs({first.root, second.root}, query, stack);
+
+    EXPECT_EQ(query.leaf_pairs, OverlappingLeaves(first, second, false));
+    EXPECT_TRUE(stack.Empty());
+}
+
+TEST(PairTraversalTest, DeepTreesSpillTheStack) {
+    // every level of the two chains leaves the pairs with its leaves on the stack
+    ChainTree first(5000, 0);
+    ChainTree second(5000, 0.25);
+    RecordingQuery query{&first, &second, {}, 0, SIZE_MAX};
+
+    NodePairStack stack;
+    TraverseNodePairs({first.root, second.root}, query, stack);
+
+    EXPECT_TRUE(stack.Spilled());
+    EXPECT_EQ(query.leaf_pairs, OverlappingLeaves(first, second, false));
+}
+
+TEST(PairTraversalTest, SelfPairsMatchBruteForce) {
+    ChainTree chain(3000, 0);
+    RecordingQuery query{&chain, &chain, {}, 0, SIZE_MAX};
+
+    TraverseSelfPairs(chain.root, query);
+
+    // each leaf with itself and with its neighbours, every unordered pair once
+    EXPECT_EQ(query.calls, 2 * 3000u - 1);
+    EXPECT_EQ(query.leaf_pairs, OverlappingLeaves(chain, chain, true));
+}
+
+TEST(PairTraversalTest, StoppedQueryEndsTraversal) {
+    ChainTree first(100, 0);
+    ChainTree second(100, 0);
+    RecordingQuery query{&first, &second, {}, 0, 5};
+
+    TraverseNodePairs({first.root, second.root}, query);
+
+    EXPECT_EQ(query.calls, 5u);
+}
+
+TEST(PairTraversalTest, LargerNodeIsSplitFirst) {
+    ChainTree chain(64, 0);
+    BVHNode<double> leaf(AABB<double>{Point<double>{0, 0, 0}, Point<double>{1, 1, 1}},
+                         std::span<const IndexedTriangle<double>>{});
+
+    std::vector<std::pair<NodeIdx, NodeIdx>> visited;
+    auto record = [&visited](NodeIdx a, NodeIdx b) { visited.emplace_back(a, b); };
+
+    // the root spans 64 units, the inner node above the last two leaves 2: only the root is split
+    const auto& root = chain.nodes[chain.root];
+    NodeIdx small = chain.nodes.size() - 1;
+    ForEachChildPair(chain.root, root, small, chain.nodes[small], record);
+    EXPECT_EQ(visited, (std::vector<std::pair<NodeIdx, NodeIdx>>{
+        {root.GetLeftIdx(), small}, {root.GetRightIdx(), small}}));
+
+    // a leaf is never split
+    visited.clear();
+    ForEachChildPair(0, leaf, chain.root, root, record);
+    EXPECT_EQ(visited, (std::vector<std::pair<NodeIdx, NodeIdx>>{
+        {0, root.GetLeftIdx()}, {0, root.GetRightIdx()}}));
+}
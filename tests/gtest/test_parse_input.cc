@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "parse_input.hpp"
+
+using namespace geometry;
+using namespace geometry::acceleration;
+
+namespace {
+
+std::string MakeInput(size_t n) {
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> distr(-100, 100);
+
+    std::ostringstream out;
+    out << n << "\n";
+    out.precision(17);
+    for (size_t i = 0; i != n; ++i) {
+        for (size_t j = 0; j != 9; ++j) {
+            out << distr(gen) << (j == 8 ? "\n" : " ");
+        }
+    }
+    return out.str();
+}
+
+std::string InputError(const std::string& input, concurrency::Execution execution) {
+    try {
+        app::ParseInput<double>(input, execution);
+    } catch (const std::runtime_error& e) {
+        return e.what();
+    }
+    return "";
+}
+
+} // namespace
+
+// Valid input -------------------------------------------------------------------------------------
+
+TEST(ParseInputTest, ParsesTriangles) {
+    std::istringstream input("2\n0 0 0 1 0 0 0 1 0\n-1.5 +2 3e2 4 5 6 7 8 9\n");
+
+    auto triangles = app::ParseInput<double>(input);
+
+    ASSERT_EQ(triangles.size(), 2u);
+    EXPECT_EQ(triangles[0].id, 0u);
+    EXPECT_EQ(triangles[1].id, 1u);
+    EXPECT_DOUBLE_EQ(triangles[0].triangle[1].x, 1);
+    EXPECT_DOUBLE_EQ(triangles[1].triangle[0].x, -1.5);
+    EXPECT_DOUBLE_EQ(triangles[1].triangle[0].y, 2);
+    EXPECT_DOUBLE_EQ(triangles[1].triangle[0].z, 300);
+    EXPECT_DOUBLE_EQ(triangles[1].triangle[2].z, 9);
+}
+
+TEST(ParseInputTest, ArbitraryWhitespaceAndNoTrailingNewline) {
+    auto triangles = app::ParseInput<double>("  1\t0 0 0\r\n1 0 0   0 1 0");
+
+    ASSERT_EQ(triangles.size(), 1u);
+    EXPECT_DOUBLE_EQ(triangles[0].triangle[2].y, 1);
+}
+
+TEST(ParseInputTest, ZeroTriangles) {
+    EXPECT_TRUE(app::ParseInput<double>("0\n").empty());
+}
+
+TEST(ParseInputTest, ParallelMatchesSerial) {
+    std::string input = MakeInput(50000);
+    ASSERT_GE(input.size(), app::detail::kParallelParseMinSize);
+
+    auto serial = app::ParseInput<double>(input);
+    auto parallel = app::ParseInput<double>(input, concurrency::Execution::kParallel);
+
+    ASSERT_EQ(parallel.size(), serial.size());
+    for (size_t i = 0; i != serial.size(); ++i) {
+        for (size_t v = 0; v != 3; ++v) {
+            EXPECT_EQ(parallel[i].triangle[v].x, serial[i].triangle[v].x);
+            EXPECT_EQ(parallel[i].triangle[v].z, serial[i].triangle[v].z);
+        }
+    }
+}
+
+// Errors ------------------------------------------------------------------------------------------
+
+TEST(ParseInputTest, MissingCount) {
+    EXPECT_EQ(InputError("", concurrency::Execution::kSerial), "Input error: expected number of triangles");
+    EXPECT_EQ(InputError("abc", concurrency::Execution::kSerial), "Input error: expected number of triangles");
+}
+
+TEST(ParseInputTest, MalformedCoordinate) {
+    EXPECT_EQ(
+        InputError("2\n0 0 0 1 0 0 0 1 0\n0 0 0 1 x 0 0 1 0\n", concurrency::Execution::kSerial),
+        "Input error on the triangle 1"
+    );
+}
+
+TEST(ParseInputTest, TruncatedInput) {
+    EXPECT_EQ(
+        InputError("3\n0 0 0 1 0 0 0 1 0\n0 0 0 1 0 0 0 1 0\n0 0 0\n", concurrency::Execution::kSerial),
+        "Input error on the triangle 2"
+    );
+}
+
+TEST(ParseInputTest, ParallelReportsFirstError) {
+    std::string input = MakeInput(50000);
+
+    size_t line_start = 0;
+    for (size_t line = 0; line != 30001; ++line) {
+        line_start = input.find('\n', line_start) + 1;
+    }
+    input[line_start] = 'x';
+    input[input.size() - 5] = 'y';
+
+    EXPECT_EQ(InputError(input, concurrency::Execution::kParallel), "Input error on the triangle 30000");
+    EXPECT_EQ(InputError(input, concurrency::Execution::kSerial), "Input error on the triangle 30000");
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "prepared_triangle.hpp"
+
+using namespace geometry;
+
+class PreparedTriangleTest : public ::testing::Test {
+protected:
+    Triangle<double> triangle {Point<double>{0, 0, 0}, Point<double>{1, 0, 0}, Point<double>{0, 1, 0}};
+
+    static void ExpectSameAsTriangle(const std::vector<Triangle<double>>& triangles) {
+        std::vector<PreparedTriangle<double>> prepared;
+        for (const auto& t : triangles) {
+            prepared.emplace_back(t);
+        }
+
+        for (size_t i = 0; i != triangles.size(); ++i) {
+            for (size_t j = 0; j != triangles.size(); ++j) {
+                bool expected = Triangle<double>::Intersect(triangles[i], triangles[j]);
+                EXPECT_EQ(PreparedTriangle<double>::Intersect(prepared[i], prepared[j]), expected)
+                    << "triangles " << i << " and " << j;
+                EXPECT_EQ(PreparedTriangle<double>::IntersectMoller(prepared[i], prepared[j]), expected)
+                    << "Moller, triangles " << i << " and " << j;
+            }
+        }
+    }
+};
+
+// Cache -------------------------------------------------------------------------------------------
+
+TEST_F(PreparedTriangleTest, CachesPlaneAndEdges) {
+    PreparedTriangle<double> prepared(triangle);
+
+    EXPECT_EQ(prepared.type, TriangleType::kNormal);
+    EXPECT_DOUBLE_EQ(std::abs(prepared.normal.z), 1);
+    EXPECT_DOUBLE_EQ(prepared.offset, 0);
+    EXPECT_DOUBLE_EQ(prepared.edges[0].x, 1);
+    EXPECT_DOUBLE_EQ(prepared.edges[1].y, 1);
+    EXPECT_DOUBLE_EQ(prepared.edges[2].y, -1);
+}
+
+TEST_F(PreparedTriangleTest, CachesDegenerateShape) {
+    PreparedTriangle<double> segment({Point<double>{0, 0, 0}, Point<double>{1, 1, 1}, Point<double>{2, 2, 2}});
+    PreparedTriangle<double> point({Point<double>{3, 3, 3}, Point<double>{3, 3, 3}, Point<double>{3, 3, 3}});
+
+    EXPECT_EQ(segment.type, TriangleType::kSegment);
+    ASSERT_TRUE(std::holds_alternative<Segment<double>>(segment.shape));
+    EXPECT_EQ(std::get<Segment<double>>(segment.shape).p1, (Point<double>{2, 2, 2}));
+
+    EXPECT_EQ(point.type, TriangleType::kPoint);
+    EXPECT_TRUE(std::holds_alternative<Point<double>>(point.shape));
+}
+
+TEST_F(PreparedTriangleTest, ContainsMatchesTriangle) {
+    PreparedTriangle<double> prepared(triangle);
+
+    for (double x = -0.5; x <= 1.5; x += 0.25) {
+        for (double y = -0.5; y <= 1.5; y += 0.25) {
+            Point<double> p{x, y, 0};
+            EXPECT_EQ(prepared.Contains(p), triangle.Contains(p));
+        }
+    }
+}
+
+// Intersect ---------------------------------------------------------------------------------------
+
+TEST_F(PreparedTriangleTest, SpecialCasesMatchTriangle) {
+    ExpectSameAsTriangle({
+        triangle,
+        {Point<double>{0, 0, 1}, Point<double>{1, 0, 1}, Point<double>{0, 1, 1}},             // parallel
+        {Point<double>{0.2, 0.2, 0}, Point<double>{2, 0.2, 0}, Point<double>{0.2, 2, 0}},     // coplanar
+        {Point<double>{0.1, 0.1, 0}, Point<double>{0.3, 0.1, 0}, Point<double>{0.1, 0.3, 0}}, // nested
+        {Point<double>{0.2, 0.2, -1}, Point<double>{0.2, 0.2, 1}, Point<double>{0.3, 0.1, 0}},// crossing
+        {Point<double>{1, 0, 0}, Point<double>{2, 0, 0}, Point<double>{1, 0, 1}},             // shared vertex
+        {Point<double>{0, 0, 0}, Point<double>{0.5, 0.5, 0}, Point<double>{1, 1, 0}},         // segment
+        {Point<double>{0.5, 0, -1}, Point<double>{0.5, 0, 0}, Point<double>{0.5, 0, 1}},      // segment
+        {Point<double>{0.2, 0.2, 0}, Point<double>{0.2, 0.2, 0}, Point<double>{0.2, 0.2, 0}}, // point
+        {Point<double>{5, 5, 5}, Point<double>{5, 5, 5}, Point<double>{5, 5, 5}},             // point
+    });
+}
+
+TEST_F(PreparedTriangleTest, RandomTrianglesMatchTriangle) {
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<double> distr(-3, 3);
+    auto p = [&] { return Point<double>{distr(gen), distr(gen), distr(gen)}; };
+
+    std::vector<Triangle<double>> triangles;
+    for (size_t i = 0; i != 150; ++i) {
+        triangles.emplace_back(p(), p(), p());
+    }
+    // triangles sharing a vertex or lying in one plane
+    for (size_t i = 0; i != 50; ++i) {
+        triangles.emplace_back(triangles[i].p0_, p(), p());
+        triangles.emplace_back(Point<double>{distr(gen), distr(gen), 1}, Point<double>{distr(gen), distr(gen), 1},
+                               Point<double>{distr(gen), distr(gen), 1});
+    }
+
+    ExpectSameAsTriangle(triangles);
+}
+
+TEST_F(PreparedTriangleTest, TouchingTrianglesMatchTriangle) {
+    std::vector<Triangle<double>> triangles {triangle};
+    // crossing, touching and barely missing the edge x + y = 1 of triangle from above and below
+    for (double shift : {-1e-3, -1e-13, 0.0, 1e-13, 1e-3}) {
+        double c = 0.5 + shift;
+        triangles.push_back({Point<double>{c, c, -1}, Point<double>{c, c, 1}, Point<double>{c + 1, c - 1, 0}});
+        triangles.push_back({Point<double>{0.2, 0.2, shift}, Point<double>{0.4, 0.2, 1}, Point<double>{0.2, 0.4, 1}});
+    }
+
+    ExpectSameAsTriangle(triangles);
+}
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "sat_kernel.hpp"
+
+using namespace geometry;
+using namespace geometry::acceleration;
+
+class SatKernelTest : public ::testing::Test {
+protected:
+    std::vector<IndexedTriangle<double>> triangles {
+        IndexedTriangle<double>(7, {Point<double>{0,0,0}, Point<double>{1,0,0}, Point<double>{0,1,0}}),
+        IndexedTriangle<double>(8, {Point<double>{0,0,1}, Point<double>{1,0,1}, Point<double>{0,1,1}}),
+        IndexedTriangle<double>(9, {Point<double>{0.2,0.2,-1}, Point<double>{0.2,0.2,1}, Point<double>{0.3,0.1,0}}),
+        IndexedTriangle<double>(10, {Point<double>{0,0,2}, Point<double>{1,1,2}, Point<double>{2,2,2}})
+    };
+
+    static std::vector<SimdLevel> SupportedLevels() {
+        std::vector<SimdLevel> levels {SimdLevel::kScalar};
+        if (DetectSimdLevel() >= SimdLevel::kAvx2) {
+            levels.push_back(SimdLevel::kAvx2);
+        }
+        if (DetectSimdLevel() >= SimdLevel::kAvx512) {
+            levels.push_back(SimdLevel::kAvx512);
+        }
+        return levels;
+    }
+
+    static std::vector<IndexedTriangle<double>> MakeRandomTriangles(size_t n, unsigned seed, double range) {
+        std::mt19937 gen(seed);
+        std::uniform_real_distribution<double> distr(-range, range);
+
+        std::vector<IndexedTriangle<double>> random;
+        for (size_t i = 0; i != n; ++i) {
+            auto p = [&] { return Point<double>{distr(gen), distr(gen), distr(gen)}; };
+            Point<double> a = p();
+            Point<double> b = p();
+            // every third triangle touches the previous one in a shared vertex
+            random.emplace_back(i, Triangle<double>{(i % 3 == 0 && i) ? random.back().triangle.p2_ : a, b, p()});
+        }
+        return random;
+    }
+};
+
+// Candidates --------------------------------------------------------------------------------------
+
+TEST_F(SatKernelTest, RejectsParallelPlanes) {
+    TriangleSoA<double> soa(triangles);
+
+    for (SimdLevel level : SupportedLevels()) {
+        uint8_t candidates[1];
+        EXPECT_EQ(SelectCandidates(soa, 0, 1, 2, candidates, level), 0u);
+        EXPECT_EQ(candidates[0], 0);
+    }
+}
+
+TEST_F(SatKernelTest, KeepsCrossingTriangles) {
+    TriangleSoA<double> soa(triangles);
+
+    for (SimdLevel level : SupportedLevels()) {
+        uint8_t candidates[1];
+        EXPECT_EQ(SelectCandidates(soa, 0, 2, 3, candidates, level), 1u);
+        EXPECT_EQ(candidates[0], 1);
+    }
+}
+
+TEST_F(SatKernelTest, KeepsDegenerateTriangles) {
+    TriangleSoA<double> soa(triangles);
+
+    for (SimdLevel level : SupportedLevels()) {
+        uint8_t candidates[3];
+        EXPECT_EQ(SelectCandidates(soa, 3, 0, 3, candidates, level), 3u);
+        EXPECT_EQ(candidates[0], 1);
+        EXPECT_EQ(candidates[1], 1);
+        EXPECT_EQ(candidates[2], 1);
+
+        uint8_t candidate;
+        EXPECT_EQ(SelectCandidates(soa, 0, 3, 4, &candidate, level), 1u);
+    }
+}
+
+// Instruction sets --------------------------------------------------------------------------------
+
+TEST_F(SatKernelTest, LevelsAgree) {
+    // odd sizes leave a tail after the full vector blocks
+    auto random = MakeRandomTriangles(301, 5, 3);
+    TriangleSoA<double> soa(random);
+
+    std::vector<uint8_t> expected(random.size());
+    std::vector<uint8_t> candidates(random.size());
+
+    for (size_t i = 0; i != random.size(); ++i) {
+        size_t count = SelectCandidates(soa, i, i % 7, random.size(), expected.data(), SimdLevel::kScalar);
+
+        for (SimdLevel level : SupportedLevels()) {
+            EXPECT_EQ(SelectCandidates(soa, i, i % 7, random.size(), candidates.data(), level), count);
+            EXPECT_EQ(candidates, expected);
+        }
+    }
+}
+
+TEST_F(SatKernelTest, RejectedPairsNeverIntersect) {
+    auto random = MakeRandomTriangles(300, 3, 10);
+    TriangleSoA<double> soa(random);
+    std::vector<uint8_t> candidates(random.size());
+
+    for (SimdLevel level : SupportedLevels()) {
+        for (size_t i = 0; i != random.size(); ++i) {
+            SelectCandidates(soa, i, 0, random.size(), candidates.data(), level);
+            for (size_t j = 0; j != random.size(); ++j) {
+                if (!candidates[j]) {
+                    EXPECT_FALSE(Triangle<double>::Intersect(random[i].triangle, random[j].triangle));
+                }
+            }
+        }
+    }
+}
+
+TEST_F(SatKernelTest, FloatLevelsAgree) {
+    std::vector<IndexedTriangle<float>> random;
+    for (const auto& tr : MakeRandomTriangles(203, 7, 3)) {
+        auto p = [](const Point<double>& q) {
+            return Point<float>{static_cast<float>(q.x), static_cast<float>(q.y), static_cast<float>(q.z)};
+        };
+        random.emplace_back(tr.id, Triangle<float>{p(tr.triangle.p0_), p(tr.triangle.p1_), p(tr.triangle.p2_)});
+    }
+
+    TriangleSoA<float> soa(random);
+    std::vector<uint8_t> expected(random.size());
+    std::vector<uint8_t> candidates(random.size());
+
+    for (size_t i = 0; i != random.size(); ++i) {
+        SelectCandidates(soa, i, 0, random.size(), expected.data(), SimdLevel::kScalar);
+        for (SimdLevel level : SupportedLevels()) {
+            SelectCandidates(soa, i, 0, random.size(), candidates.data(), level);
+            EXPECT_EQ(candidates, expected);
+        }
+    }
+}
+
+TEST_F(SatKernelTest, TwoSoAsMatchOneSoA) {
+    // the second SoA is far larger, so its tolerance is the one taken
+    auto first = MakeRandomTriangles(100, 11, 10);
+    auto second = MakeRandomTriangles(100, 12, 10);
+    second.front().triangle = Triangle<double>{Point<double>{1e6, 0, 0}, Point<double>{1e6, 1, 0}, Point<double>{1e6, 0, 1}};
+
+    auto all = first;
+    all.insert(all.end(), second.begin(), second.end());
+
+    TriangleSoA<double> first_soa(first);
+    TriangleSoA<double> second_soa(second);
+    TriangleSoA<double> all_soa(all);
+    std::vector<uint8_t> expected(second.size());
+    std::vector<uint8_t> candidates(second.size());
+
+    for (SimdLevel level : SupportedLevels()) {
+        for (size_t i = 0; i != first.size(); ++i) {
+            SelectCandidates(all_soa, i, first.size(), all.size(), expected.data(), level);
+            SelectCandidates(first_soa, i, second_soa, 0, second.size(), candidates.data(), level);
+            EXPECT_EQ(candidates, expected);
+        }
+    }
+}
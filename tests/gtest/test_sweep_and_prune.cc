@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bvh.hpp"
+#include "sweep_and_prune.hpp"
+
+#include "test_helpers.hpp"
+
+using namespace geometry;
+using namespace geometry::acceleration;
+using test_helpers::LoadAnswers;
+using test_helpers::LoadTestData;
+
+namespace {
+
+/**
+ * Triangles along a pipe of the given length on axis, of radius 5 around it
+ */
+std::vector<IndexedTriangle<double>> MakePipe(size_t count, double length, size_t axis, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> along(0, length);
+    std::uniform_real_distribution<double> across(-5, 5);
+    std::uniform_real_distribution<double> offset(-1, 1);
+
+    std::vector<IndexedTriangle<double>> triangles;
+    for (size_t i = 0; i != count; ++i) {
+        Point<double> c{across(gen), across(gen), across(gen)};
+        c[axis] = along(gen);
+        auto p = [&] { return Point<double>{c.x + offset(gen), c.y + offset(gen), c.z + offset(gen)}; };
+        triangles.emplace_back(i, Triangle<double>{p(), p(), p()});
+    }
+    return triangles;
+}
+
+} // namespace
+
+// Construction ------------------------------------------------------------------------------------
+
+TEST(SweepAndPruneTest, EmptyInput) {
+    SweepAndPrune<double> sap({});
+
+    EXPECT_EQ(sap.Size(), 0u);
+    EXPECT_TRUE(sap.FindIntersectingTriangles().empty());
+}
+
+TEST(SweepAndPruneTest, SweepsAlongTheLongAxis) {
+    for (size_t axis : {0, 1, 2}) {
+        SweepAndPrune<double> sap(MakePipe(1000, 1000, axis, 1));
+        EXPECT_EQ(sap.GetAxis(), axis);
+    }
+}
+
+// Queries -----------------------------------------------------------------------------------------
+
+TEST(SweepAndPruneTest, MatchesAnswers) {
+    for (int i = 1; i <= 10; ++i) {
+        SweepAndPrune<double> sap(LoadTestData(std::to_string(i) + ".dat"));
+
+        EXPECT_EQ(sap.FindIntersectingTriangles().ToVector(), LoadAnswers(std::to_string(i) + ".ans"))
+            << "test " << i;
+    }
+}
+
+TEST(SweepAndPruneTest, MatchesBVHOnPipe) {
+    auto triangles = MakePipe(20000, 20000, 0, 2);
+    SweepAndPrune<double> sap{std::vector(triangles)};
+    BVH<double> bvh{std::vector(triangles)};
+
+    auto expected = bvh.FindIntersectingTriangles();
+    ASSERT_FALSE(expected.empty());
+    EXPECT_EQ(sap.FindIntersectingTriangles(), expected);
+    EXPECT_EQ(sap.FindIntersectingTriangles({.narrow_phase = NarrowPhase::kMoller}), expected);
+}
+
+TEST(SweepAndPruneTest, NearlyTouchingPairAcrossSweepAxis) {
+    // the second triangle starts 5e-13 after the first ends on the sweep axis x, stretched by a
+    // far triangle so that x is chosen
+    std::vector<IndexedTriangle<double>> triangles{
+        IndexedTriangle<double>(0, {Point<double>{0, 0, 0}, Point<double>{1, 0, 0}, Point<double>{0, 1, 0}}),
+        IndexedTriangle<double>(1, {Point<double>{1 + 5e-13, 0, 0}, Point<double>{2, 0, 0}, Point<double>{1.5, 1, 0}}),
+        IndexedTriangle<double>(2, {Point<double>{100, 0, 0}, Point<double>{101, 0, 0}, Point<double>{100, 1, 0}})
+    };
+    ASSERT_TRUE(Triangle<double>::Intersect(triangles[0].triangle, triangles[1].triangle));
+
+    SweepAndPrune<double> sap{std::vector(triangles)};
+    BVH<double> bvh{std::vector(triangles)};
+
+    ASSERT_EQ(sap.GetAxis(), 0u);
+    for (SimdLevel level : {SimdLevel::kScalar, SimdLevel::kAvx2, SimdLevel::kAvx512}) {
+        if (static_cast<int>(level) > static_cast<int>(DetectSimdLevel())) {
+            continue;
+        }
+        EXPECT_EQ(sap.FindIntersectingTriangles({}, nullptr, level).ToVector(), (std::vector<TrIndex>{0, 1}));
+    }
+    EXPECT_EQ(sap.FindIntersectingTriangles(), bvh.FindIntersectingTriangles());
+}
+
+TEST(SweepAndPruneTest, SimdLevelsAgree) {
+    auto triangles = MakePipe(5000, 2000, 1, 3);
+    SweepAndPrune<double> sap{std::vector(triangles)};
+
+    TraversalStats scalar_stats;
+    auto expected = sap.FindIntersectingTriangles({}, &scalar_stats, SimdLevel::kScalar);
+
+    for (SimdLevel level : {SimdLevel::kAvx2, SimdLevel::kAvx512}) {
+        if (static_cast<int>(level) > static_cast<int>(DetectSimdLevel())) {
+            continue;
+        }
+
+        TraversalStats stats;
+        EXPECT_EQ(sap.FindIntersectingTriangles({}, &stats, level), expected);
+        EXPECT_EQ(stats.triangle_pairs, scalar_stats.triangle_pairs);
+        EXPECT_EQ(stats.narrow_phase_tests, scalar_stats.narrow_phase_tests);
+    }
+}
+
+TEST(SweepAndPruneTest, OtherAxesPruneTheActiveList) {
+    auto triangles = MakePipe(5000, 500, 2, 4);
+    SweepAndPrune<double> sap{std::vector(triangles)};
+
+    TraversalStats stats;
+    sap.FindIntersectingTriangles({}, &stats);
+
+    EXPECT_GT(stats.triangle_pairs, 0u);
+    EXPECT_LT(stats.triangle_pairs * 2, stats.aabb_tests);
+    EXPECT_EQ(stats.narrow_phase_tests, stats.triangle_pairs);
+}
+
+TEST(SweepAndPruneTest, ParallelMatchesSerial) {
+    auto triangles = MakePipe(20000, 5000, 0, 5);
+    SweepAndPrune<double> serial{std::vector(triangles)};
+    SweepAndPrune<double> parallel{std::vector(triangles),
+                                   {.execution = concurrency::Execution::kParallel, .parallel_threshold = 100}};
+
+    auto expected = serial.FindIntersectingTriangles();
+    EXPECT_EQ(serial.FindIntersectingTriangles({.execution = concurrency::Execution::kParallel}), expected);
+    EXPECT_EQ(parallel.FindIntersectingTriangles({.execution = concurrency::Execution::kParallel,
+                                                  .skip_flagged = true}), expected);
+}
+
+TEST(SweepAndPruneTest, SkipFlaggedAvoidsNarrowPhaseTests) {
+    auto triangles = MakePipe(3000, 100, 0, 6);
+    SweepAndPrune<double> sap{std::vector(triangles)};
+
+    TraversalStats all;
+    TraversalStats skipped;
+    auto expected = sap.FindIntersectingTriangles({}, &all);
+    EXPECT_EQ(sap.FindIntersectingTriangles({.skip_flagged = true}, &skipped), expected);
+
+    EXPECT_GT(skipped.skipped_narrow_phase_tests, 0u);
+    EXPECT_EQ(skipped.narrow_phase_tests + skipped.skipped_narrow_phase_tests, all.narrow_phase_tests);
+}
+
+TEST(SweepAndPruneTest, NegativeAndEqualStarts) {
+    // the same box many times, at negative coordinates, so the sort keys tie and cross zero
+    std::vector<IndexedTriangle<double>> triangles;
+    for (TrIndex i = 0; i != 40; ++i) {
+        double x = (i % 2) ? -3.0 : -1.0;
+        triangles.emplace_back(i, Triangle<double>{Point<double>{x, 0, 0}, Point<double>{x + 2.5, 0, 0},
+                                                   Point<double>{x, 1, 0}});
+    }
+
+    EXPECT_EQ(SweepAndPrune<double>{std::vector(triangles)}.FindIntersectingTriangles().size(), 40u);
+    EXPECT_EQ(detail::OrderedKey(-2.0) < detail::OrderedKey(-1.0), true);
+    EXPECT_EQ(detail::OrderedKey(-0.5) < detail::OrderedKey(0.0), true);
+    EXPECT_EQ(detail::OrderedKey(0.0) < detail::OrderedKey(1e-300), true);
+}
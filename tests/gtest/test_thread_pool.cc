@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+using namespace concurrency;
+
+namespace {
+
+long long ParallelSum(const std::vector<int>& values, size_t begin, size_t end, ThreadPool& pool) {
+    if (end - begin <= 16) {
+        return std::accumulate(values.begin() + begin, values.begin() + end, 0LL);
+    }
+
+    size_t mid = begin + (end - begin) / 2;
+    long long left = 0;
+
+    TaskGroup group(pool);
+    group.Run([&] { left = ParallelSum(values, begin, mid, pool); });
+    long long right = ParallelSum(values, mid, end, pool);
+    group.Wait();
+
+    return left + right;
+}
+
+} // namespace
+
+// Execution ---------------------------------------------------------------------------------------
+
+TEST(ThreadPoolTest, RunsAllTasks) {
+    ThreadPool pool(4);
+    std::atomic<int> counter{0};
+
+    TaskGroup group(pool);
+    for (int i = 0; i != 1000; ++i) {
+        group.Run([&] { ++counter; });
+    }
+    group.Wait();
+
+    EXPECT_EQ(counter.load(), 1000);
+}
+
+TEST(ThreadPoolTest, NestedGroupsDoNotDeadlock) {
+    std::vector<int> values(10000);
+    std::iota(values.begin(), values.end(), 0);
+
+    ThreadPool pool(3);
+
+    EXPECT_EQ(ParallelSum(values, 0, values.size(), pool), 49995000LL);
+}
+
+TEST(ThreadPoolTest, PoolWithoutWorkersRunsOnCaller) {
+    std::vector<int> values(1000, 1);
+
+    ThreadPool pool(0);
+
+    EXPECT_EQ(pool.GetNumberOfThreads(), 0u);
+    EXPECT_EQ(ParallelSum(values, 0, values.size(), pool), 1000LL);
+}
+
+// Errors ------------------------------------------------------------------------------------------
+
+TEST(ThreadPoolTest, WaitRethrowsTaskException) {
+    ThreadPool pool(2);
+
+    TaskGroup group(pool);
+    group.Run([] { throw std::runtime_error("task failed"); });
+    group.Run([] {});
+
+    EXPECT_THROW(group.Wait(), std::runtime_error);
+}
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "triangle_soa.hpp"
+
+using namespace geometry;
+using namespace geometry::acceleration;
+
+class TriangleSoATest : public ::testing::Test {
+protected:
+    std::vector<IndexedTriangle<double>> triangles {
+        IndexedTriangle<double>(7, {Point<double>{0,0,0}, Point<double>{1,0,0}, Point<double>{0,1,0}}),
+        IndexedTriangle<double>(8, {Point<double>{0,0,1}, Point<double>{1,0,1}, Point<double>{0,1,1}}),
+        IndexedTriangle<double>(9, {Point<double>{0.2,0.2,-1}, Point<double>{0.2,0.2,1}, Point<double>{0.3,0.1,0}}),
+        IndexedTriangle<double>(10, {Point<double>{0,0,2}, Point<double>{1,1,2}, Point<double>{2,2,2}})
+    };
+};
+
+// Layout ------------------------------------------------------------------------------------------
+
+TEST_F(TriangleSoATest, ComponentsFollowSourceOrder) {
+    TriangleSoA<double> soa(triangles);
+
+    ASSERT_EQ(soa.Size(), 4u);
+    EXPECT_EQ(soa.ids[0], 7u);
+    EXPECT_EQ(soa.ids[3], 10u);
+    EXPECT_DOUBLE_EQ(soa.vertices[1].x[0], 1);
+    EXPECT_DOUBLE_EQ(soa.vertices[2].z[1], 1);
+    EXPECT_DOUBLE_EQ(soa.edges[0].x[0], 1);
+    EXPECT_DOUBLE_EQ(soa.edges[2].y[0], -1);
+    EXPECT_DOUBLE_EQ(std::abs(soa.normals.z[0]), 1);
+}
+
+TEST_F(TriangleSoATest, DegenerateFlags) {
+    TriangleSoA<double> soa(triangles);
+
+    EXPECT_FALSE(soa.degenerate[0]);
+    EXPECT_FALSE(soa.degenerate[2]);
+    EXPECT_TRUE(soa.degenerate[3]);
+}
+
+TEST_F(TriangleSoATest, SetTriangleReplacesOnePosition) {
+    TriangleSoA<double> soa(triangles);
+    double tolerance = soa.GetTolerance();
+
+    double scale = soa.SetTriangle(3, Triangle<double>{Point<double>{100,0,0}, Point<double>{101,0,0},
+                                                       Point<double>{100,1,0}});
+    EXPECT_DOUBLE_EQ(scale, 101);
+    EXPECT_DOUBLE_EQ(soa.GetTolerance(), tolerance);
+    soa.GrowTolerances(scale);
+
+    EXPECT_EQ(soa.ids[3], 10u);
+    EXPECT_FALSE(soa.degenerate[3]);
+    EXPECT_DOUBLE_EQ(soa.vertices[0].x[3], 100);
+    EXPECT_DOUBLE_EQ(soa.edges[0].x[3], 1);
+    EXPECT_DOUBLE_EQ(soa.vertices[1].x[0], 1);
+    EXPECT_GT(soa.GetTolerance(), tolerance);
+
+    // moving back in does not shrink the tolerance of the others
+    double grown = soa.GetTolerance();
+    soa.GrowTolerances(soa.SetTriangle(3, triangles[0].triangle));
+    EXPECT_DOUBLE_EQ(soa.GetTolerance(), grown);
+}
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "bvh.hpp"
+#include "uniform_grid.hpp"
+
+#include "test_helpers.hpp"
+
+using namespace geometry;
+using namespace geometry::acceleration;
+using test_helpers::BruteForce;
+using test_helpers::LoadAnswers;
+using test_helpers::LoadTestData;
+using test_helpers::MakeTriangles;
+
+// Construction ------------------------------------------------------------------------------------
+
+TEST(UniformGridTest, EmptyGrid) {
+    UniformGrid<double> grid({});
+
+    EXPECT_EQ(grid.GetNumberOfCells(), 0u);
+    EXPECT_TRUE(grid.FindIntersectingTriangles().empty());
+}
+
+TEST(UniformGridTest, EveryTriangleInEveryCellItOverlaps) {
+    auto triangles = MakeTriangles(500, 50, 4, 1);
+    UniformGrid<double> grid{std::vector(triangles), {.cell_size = 3}};
+
+    std::vector<size_t> entries(triangles.size(), 0);
+    for (size_t cell = 0; cell != grid.GetNumberOfCells(); ++cell) {
+        ASSERT_FALSE(grid.GetCell(cell).empty());
+        for (uint32_t i : grid.GetCell(cell)) {
+            ++entries[i];
+        }
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i != triangles.size(); ++i) {
+        EXPECT_GE(entries[i], 1u);
+        total += entries[i];
+    }
+    EXPECT_EQ(total, grid.GetNumberOfEntries());
+    EXPECT_GT(grid.GetNumberOfEntries(), triangles.size());
+}
+
+TEST(UniformGridTest, EstimatedCellSizeFollowsTriangleSize) {
+    UniformGrid<double> small(MakeTriangles(2000, 10, 1, 2));
+    UniformGrid<double> large(MakeTriangles(2000, 10, 10, 2));
+
+    EXPECT_GT(large.GetCellSize(), 5 * small.GetCellSize());
+    // a few entries per triangle
+    EXPECT_LT(small.GetNumberOfEntries(), 16 * 2000u);
+    EXPECT_LT(large.GetNumberOfEntries(), 16 * 2000u);
+
+    // tiny triangles still share cells
+    UniformGrid<double> tiny(MakeTriangles(2000, 100, 0.01, 2));
+    EXPECT_LT(tiny.GetNumberOfCells(), 2000u);
+}
+
+TEST(UniformGridTest, NegativeCellSizeThrows) {
+    EXPECT_THROW(UniformGrid<double>(MakeTriangles(10, 10, 1, 3), {.cell_size = -1}), std::invalid_argument);
+}
+
+// Queries -----------------------------------------------------------------------------------------
+
+TEST(UniformGridTest, MatchesAnswers) {
+    for (int i = 1; i <= 10; ++i) {
+        UniformGrid<double> grid(LoadTestData(std::to_string(i) + ".dat"));
+
+        EXPECT_EQ(grid.FindIntersectingTriangles().ToVector(), LoadAnswers(std::to_string(i) + ".ans"))
+            << "test " << i;
+    }
+}
+
+TEST(UniformGridTest, NearlyTouchingPairAcrossCellBoundary) {
+    // the first triangle ends just before x = 1, the second starts at it: no cell holds both boxes
+    std::vector<IndexedTriangle<double>> triangles{
+        IndexedTriangle<double>(0, {Point<double>{0, 0, 0}, Point<double>{1 - 5e-13, 0, 0}, Point<double>{0, 1, 0}}),
+        IndexedTriangle<double>(1, {Point<double>{1, 0, 0}, Point<double>{2, 0, 0}, Point<double>{1, 1, 0}})
+    };
+    ASSERT_TRUE(Triangle<double>::Intersect(triangles[0].triangle, triangles[1].triangle));
+
+    UniformGrid<double> grid{std::vector(triangles), {.cell_size = 1}};
+    BVH<double> bvh{std::vector(triangles)};
+
+    EXPECT_EQ(grid.FindIntersectingTriangles().ToVector(), (std::vector<TrIndex>{0, 1}));
+    EXPECT_EQ(grid.FindIntersectingTriangles(), bvh.FindIntersectingTriangles());
+}
+
+TEST(UniformGridTest, MatchesBruteForceForAnyCellSize) {
+    auto triangles = MakeTriangles(800, 30, 3, 4);
+    auto expected = BruteForce(triangles);
+    ASSERT_FALSE(expected.empty());
+
+    for (double cell_size : {0.0, 0.5, 2.0, 7.0, 100.0}) {
+        UniformGrid<double> grid{std::vector(triangles), {.cell_size = cell_size}};
+        EXPECT_EQ(grid.FindIntersectingTriangles(), expected) << "cell size " << cell_size;
+    }
+}
+
+TEST(UniformGridTest, MatchesBVH) {
+    auto triangles = MakeTriangles(20000, 100, 1.5, 5);
+    UniformGrid<double> grid{std::vector(triangles)};
+    BVH<double> bvh{std::vector(triangles)};
+
+    EXPECT_EQ(grid.FindIntersectingTriangles(), bvh.FindIntersectingTriangles());
+}
+
+TEST(UniformGridTest, EachPairTestedOnce) {
+    auto triangles = MakeTriangles(1000, 20, 3, 6);
+    UniformGrid<double> coarse{std::vector(triangles), {.cell_size = 1000}};
+    UniformGrid<double> fine{std::vector(triangles), {.cell_size = 1}};
+
+    TraversalStats coarse_stats;
+    TraversalStats fine_stats;
+    coarse.FindIntersectingTriangles({}, &coarse_stats);
+    fine.FindIntersectingTriangles({}, &fine_stats);
+
+    // a single cell tests every pair with overlapping boxes once
+    EXPECT_EQ(coarse.GetNumberOfCells(), 1u);
+    EXPECT_EQ(fine_stats.narrow_phase_tests, coarse_stats.narrow_phase_tests);
+    EXPECT_LT(fine_stats.triangle_pairs, coarse_stats.triangle_pairs);
+}
+
+TEST(UniformGridTest, ParallelMatchesSerial) {
+    auto triangles = MakeTriangles(20000, 100, 1.5, 7);
+    UniformGrid<double> serial{std::vector(triangles)};
+    UniformGrid<double> parallel{std::vector(triangles),
+                                 {.execution = concurrency::Execution::kParallel, .parallel_threshold = 100}};
+
+    ASSERT_EQ(parallel.GetNumberOfCells(), serial.GetNumberOfCells());
+    for (size_t cell = 0; cell != serial.GetNumberOfCells(); ++cell) {
+        auto a = serial.GetCell(cell);
+        auto b = parallel.GetCell(cell);
+        ASSERT_TRUE(std::equal(a.begin(), a.end(), b.begin(), b.end()));
+    }
+
+    auto expected = serial.FindIntersectingTriangles();
+    EXPECT_EQ(serial.FindIntersectingTriangles({.execution = concurrency::Execution::kParallel}), expected);
+    EXPECT_EQ(parallel.FindIntersectingTriangles({.execution = concurrency::Execution::kParallel,
+                                                  .skip_flagged = true}), expected);
+}
+
+TEST(UniformGridTest, SkipFlaggedAvoidsNarrowPhaseTests) {
+    auto triangles = MakeTriangles(2000, 10, 2, 8);
+    UniformGrid<double> grid{std::vector(triangles)};
+
+    TraversalStats all;
+    TraversalStats skipped;
+    auto expected = grid.FindIntersectingTriangles({}, &all);
+    EXPECT_EQ(grid.FindIntersectingTriangles({.skip_flagged = true}, &skipped), expected);
+
+    EXPECT_GT(skipped.skipped_narrow_phase_tests, 0u);
+    EXPECT_EQ(skipped.narrow_phase_tests + skipped.skipped_narrow_phase_tests, all.narrow_phase_tests);
+}
+
+TEST(UniformGridTest, FlatAndPointInputs) {
+    std::vector<IndexedTriangle<double>> flat;
+    for (TrIndex i = 0; i != 50; ++i) {
+        double x = 1.5 * i;
+        flat.emplace_back(i, Triangle<double>{Point<double>{x, 0, 0}, Point<double>{x + 2, 0, 0},
+                                              Point<double>{x, 1, 0}});
+    }
+    auto expected = BruteForce(flat);
+    EXPECT_EQ(UniformGrid<double>(std::move(flat)).FindIntersectingTriangles(), expected);
+
+    std::vector<IndexedTriangle<double>> points;
+    for (TrIndex i = 0; i != 3; ++i) {
+        points.emplace_back(i, Triangle<double>{Point<double>{1, 1, 1}, Point<double>{1, 1, 1},
+                                                Point<double>{1, 1, 1}});
+    }
+    EXPECT_EQ(UniformGrid<double>(std::move(points)).FindIntersectingTriangles().size(), 3u);
+}
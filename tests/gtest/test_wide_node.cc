@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+
+#include <set>
+#include <random>
+#include <numeric>
+#include <vector>
+
+#include "wide_traversal.hpp"
+
+#include "test_helpers.hpp"
+
+using namespace geometry;
+using namespace geometry::acceleration;
+using test_helpers::MakeRow;
+
+namespace {
+
+/**
+ * Median split post-order tree over the triangles, like BVH::RecursiveBuild with leaves of one
+ */
+NodeIdx BuildTree(std::vector<BVHNode<double>>& nodes, const std::vector<IndexedTriangle<double>>& triangles,
+                  size_t start, size_t end)
+{
+    AABB<double> box{triangles[start].triangle};
+    for (size_t i = start + 1; i != end; ++i) {
+        box.Expand(triangles[i].triangle);
+    }
+
+    if (end - start == 1) {
+        nodes.emplace_back(box, std::span<const IndexedTriangle<double>>(triangles.data() + start, 1));
+        return nodes.size() - 1;
+    }
+
+    size_t mid = start + (end - start) / 2;
+    NodeIdx left = BuildTree(nodes, triangles, start, mid);
+    NodeIdx right = BuildTree(nodes, triangles, mid, end);
+    nodes.emplace_back(box, left, right);
+    return nodes.size() - 1;
+}
+
+/**
+ * Collects the triangle positions below slot, checking that every child box lies in its parent's
+ */
+template <size_t kWidth>
+void CollectSlot(const std::vector<WideNode<float, kWidth>>& wide, NodeIdx slot, std::vector<size_t>& positions) {
+    const auto& parent = SlotNode(wide.data(), slot);
+    const size_t lane = SlotLane<kWidth>(slot);
+
+    if (!parent.IsInner(lane)) {
+        for (size_t i = 0; i != parent.count[lane]; ++i) {
+            positions.push_back(parent.child[lane] + i);
+        }
+        return;
+    }
+
+    const auto& node = wide[parent.child[lane]];
+    EXPECT_GT(parent.child[lane], static_cast<size_t>(slot) / kWidth);
+
+    for (size_t child = 0; child != kWidth; ++child) {
+        if (node.count[child] == 0) {
+            continue;
+        }
+        EXPECT_LE(parent.min_x[lane], node.min_x[child]);
+        EXPECT_GE(parent.max_x[lane], node.max_x[child]);
+        CollectSlot(wide, static_cast<NodeIdx>(parent.child[lane] * kWidth + child), positions);
+    }
+}
+
+} // namespace
+
+// Box tests ---------------------------------------------------------------------------------------
+
+TEST(WideNodeTest, EmptyNodeOverlapsNothing) {
+    WideNode<float, 4> empty;
+    WideNode<float, 4> box;
+    box.SetChild(0, AABB<float>{Point<float>{-1e9, -1e9, -1e9}, Point<float>{1e9, 1e9, 1e9}}, 0, 1);
+
+    EXPECT_EQ(empty.OverlapMask(box, 0), 0u);
+    EXPECT_EQ(box.OverlapMask(empty, 1), 0u);
+}
+
+TEST(WideNodeTest, OverlapMaskMatchesScalarTest) {
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> coordinate(-10, 10);
+    std::uniform_real_distribution<double> extent(0, 4);
+
+    auto random_box = [&] {
+        Point<double> min{coordinate(gen), coordinate(gen), coordinate(gen)};
+        return AABB<double>{min, Point<double>{min.x + extent(gen), min.y + extent(gen), min.z + extent(gen)}};
+    };
+
+    for (size_t round = 0; round != 100; ++round) {
+        WideNode<double, 8> node;
+        WideNode<double, 8> other;
+        std::vector<AABB<double>> boxes;
+        for (size_t lane = 0; lane != 8; ++lane) {
+            boxes.push_back(random_box());
+            node.SetChild(lane, InflateBounds<double>(boxes.back()), 0, 1);
+        }
+        AABB<double> query = random_box();
+        other.SetChild(3, InflateBounds<double>(query), 0, 1);
+
+        uint32_t expected = 0;
+        for (size_t lane = 0; lane != 8; ++lane) {
+            expected |= static_cast<uint32_t>(AABB<double>::Intersects(boxes[lane], query)) << lane;
+        }
+        EXPECT_EQ(node.OverlapMask(other, 3), expected);
+    }
+}
+
+// Collapsing --------------------------------------------------------------------------------------
+
+TEST(WideNodeTest, CollapseKeepsEveryTriangleOnce) {
+    auto triangles = MakeRow(100);
+    std::vector<BVHNode<double>> nodes;
+    NodeIdx root = BuildTree(nodes, triangles, 0, triangles.size());
+
+    auto wide = CollapseNodes<float, 4>(nodes, root, triangles.data());
+
+    std::vector<size_t> positions;
+    CollectSlot(wide, kWideRootIdx, positions);
+
+    std::vector<size_t> expected(triangles.size());
+    std::iota(expected.begin(), expected.end(), 0);
+    EXPECT_EQ(positions, expected);
+
+    // 99 binary inner nodes; the wide nodes above the lowest level replace three of them each
+    EXPECT_LT(wide.size(), nodes.size() / 3);
+}
+
+TEST(WideNodeTest, SingleLeafIsTheRootSlot) {
+    auto triangles = MakeRow(1);
+    std::vector<BVHNode<double>> nodes;
+    NodeIdx root = BuildTree(nodes, triangles, 0, triangles.size());
+
+    auto wide = CollapseNodes<float, 8>(nodes, root, triangles.data());
+
+    ASSERT_EQ(wide.size(), 1u);
+    EXPECT_FALSE(IsInnerSlot(wide.data(), kWideRootIdx));
+    EXPECT_EQ(wide[0].count[0], 1u);
+}
+
+// Traversal ---------------------------------------------------------------------------------------
+
+namespace {
+
+struct RecordingQuery {
+    const WideNode<float, 4>* nodes;
+    std::set<std::pair<size_t, size_t>> leaf_pairs;
+    size_t box_tests = 0;
+
+    bool Stopped() const {
+        return false;
+    }
+
+    bool Prune(NodeIdx, NodeIdx) const {
+        return false;
+    }
+
+    void CountBoxTests(size_t count) {
+        box_tests += count;
+    }
+
+    void IntersectLeaves(NodeIdx a, NodeIdx b) {
+        size_t first_a = SlotNode(nodes, a).child[SlotLane<4>(a)];
+        size_t first_b = SlotNode(nodes, b).child[SlotLane<4>(b)];
+        EXPECT_TRUE(leaf_pairs.emplace(std::min(first_a, first_b), std::max(first_a, first_b)).second);
+    }
+};
+
+} // namespace
+
+TEST(WideTraversalTest, SelfPairsMatchBruteForce) {
+    // every triangle overlaps the next two: each spans 2.5 units with a step of 1
+    std::vector<IndexedTriangle<double>> triangles;
+    for (size_t i = 0; i != 500; ++i) {
+        triangles.emplace_back(i, Triangle<double>{Point<double>{1.0 * i, 0, 0}, Point<double>{i + 2.5, 0, 0},
+                                                   Point<double>{1.0 * i, 1, 0}});
+    }
+    std::vector<BVHNode<double>> nodes;
+    NodeIdx root = BuildTree(nodes, triangles, 0, triangles.size());
+    auto wide = CollapseNodes<float, 4>(nodes, root, triangles.data());
+
+    RecordingQuery query{wide.data(), {}, 0};
+    TraverseWidePairs(wide.data(), {kWideRootIdx, kWideRootIdx}, query);
+
+    std::set<std::pair<size_t, size_t>> expected;
+    for (size_t i = 0; i != triangles.size(); ++i) {
+        for (size_t j = i; j != triangles.size() && j <= i + 2; ++j) {
+            expected.emplace(i, j);
+        }
+    }
+    EXPECT_EQ(query.leaf_pairs, expected);
+    EXPECT_GT(query.box_tests, 0u);
+}